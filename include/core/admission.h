@@ -0,0 +1,121 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <string>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include "router.h"
+
+// Priority classes for API requests, most important first
+enum class RequestPriority {
+    CONSENSUS = 0,     // Block submission, mining and peer management
+    TRANSACTION = 1,   // Transaction submission and signing
+    READ = 2           // Explorer and wallet reads
+};
+
+// Which pool an accepted connection was counted against
+enum class ConnectionSlot {
+    REFUSED,    // Both pools full; answer 503 and close
+    GENERAL,    // Any traffic
+    RESERVED    // Held back for consensus requests only
+};
+
+// Queueing limits for one priority class
+struct AdmissionClassLimits {
+    size_t maxQueued;                 // Waiting requests beyond this are shed at once
+    std::chrono::milliseconds maxWait;   // Waiting longer than this is shed too
+};
+
+// Bounds the number of requests being handled at once. Requests over the
+// limit wait in a bounded queue for their priority class; a freed slot is
+// handed to the oldest waiter of the highest non-empty class. A full queue or
+// an expired wait sheds the request so the caller can answer 503 quickly.
+class AdmissionController {
+public:
+    static constexpr size_t CLASS_COUNT = 3;
+
+private:
+    // A request blocked in acquire(), living on that thread's stack
+    struct Waiter {
+        bool granted = false;
+        std::condition_variable cv;
+    };
+
+    struct ClassState {
+        AdmissionClassLimits limits;
+        std::deque<Waiter*> waiters;   // Oldest first
+
+        // Statistics
+        std::atomic<uint64_t> admitted{0};
+        std::atomic<uint64_t> shedQueueFull{0};
+        std::atomic<uint64_t> shedTimeout{0};
+        LatencyHistogram queueTime;
+    };
+
+    std::array<ClassState, CLASS_COUNT> classes;
+    size_t maxInFlight;
+    size_t inFlight;
+    size_t maxConnections;
+    size_t reservedConnections;   // Part of maxConnections kept for consensus traffic
+    std::atomic<size_t> connections{0};
+    std::atomic<size_t> reservedInUse{0};
+    std::atomic<uint64_t> connectionsShed{0};
+    std::atomic<double> averageServiceSeconds{0.01};   // EWMA of slot hold time
+    mutable std::mutex admissionMutex;
+
+    void release(std::chrono::steady_clock::time_point admittedAt);
+
+public:
+    // Holds a slot for the lifetime of the request
+    class Permit {
+    private:
+        AdmissionController* controller;
+        std::chrono::steady_clock::time_point admittedAt;
+
+    public:
+        Permit() : controller(nullptr) {}
+        Permit(AdmissionController* controller, std::chrono::steady_clock::time_point admittedAt)
+            : controller(controller), admittedAt(admittedAt) {}
+        Permit(Permit&& other) noexcept;
+        Permit& operator=(Permit&& other) noexcept;
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+        ~Permit();
+
+        bool granted() const { return controller != nullptr; }
+    };
+
+    AdmissionController(size_t maxInFlight, size_t maxConnections = 1024, size_t reservedConnections = 64);
+
+    // Wait for a slot. An empty permit means the request was shed;
+    // retryAfterSeconds (if given) is then set to a suggested back-off.
+    Permit acquire(RequestPriority priority, double* retryAfterSeconds = nullptr);
+
+    // Connection-level bound, checked before a handler thread is started.
+    // Event streams and idle keep-alive sockets can fill the general pool,
+    // and no request has been read at accept to tell them apart, so the
+    // last reservedConnections slots go to connections that must then
+    // carry consensus requests only.
+    ConnectionSlot tryOpenConnection();
+    void closeConnection(ConnectionSlot slot);
+    void recordConnectionShed() { connectionsShed.fetch_add(1, std::memory_order_relaxed); }
+
+    void setMaxInFlight(size_t maxInFlight);
+    void setClassLimits(RequestPriority priority, AdmissionClassLimits limits);
+
+    size_t getInFlight() const;
+    size_t getQueued(RequestPriority priority) const;
+    uint64_t getShed(RequestPriority priority) const;
+    uint64_t getConnectionsShed() const { return connectionsShed; }
+
+    static const char* priorityName(RequestPriority priority);
+
+    // Queue depth, admission, shed and queue-time metrics in Prometheus format
+    std::string renderMetrics() const;
+};
+
+#endif // ADMISSION_H
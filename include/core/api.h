@@ -3,6 +3,14 @@
 
 #include "blockchain.h"
 #include "mining.h"
+#include "http_parser.h"
+#include "block_cache.h"
+#include "event_stream.h"
+#include "router.h"
+#include "rate_limiter.h"
+#include "admission.h"
+#include "rpc.h"
+#include <functional>
 #include <thread>
 #include <atomic>
 #include <sys/socket.h>
@@ -12,13 +20,57 @@ class API {
 private:
     Blockchain& blockchain;
     MiningEngine miningEngine;
+    
+    // POST /mine runs here, off the request thread
+    MiningJobQueue miningJobs;
     std::atomic<bool> running;
     std::thread server_thread;
     int server_fd;
     
+    // Serialized confirmed blocks, filled as blocks are connected
+    BlockResponseCache blockCache;
+    size_t blockListenerId;
+    
+    // Push stream of chain events for /events subscribers
+    EventBroadcaster events;
+    
+    // JSON-RPC 2.0 endpoint (POST /rpc)
+    JsonRpcServer rpc;
+    
+    // Token-bucket limits per client IP (all requests) and per transaction sender
+    RateLimiter ipLimiter;
+    RateLimiter senderLimiter;
+    
+    // Bounded handler slots with per-priority queues; overload is answered with 503
+    AdmissionController admission;
+    
+    // Route table, built once in the constructor
+    Router router;
+    
+    using JsonHandler = std::function<void(RouteContext& ctx, nlohmann::json& response, std::string& status)>;
+    
     void serverLoop();
-    void handleClient(int client_fd, struct sockaddr_in client_addr);
-    std::string generateResponse(const std::string& method, const std::string& path, const std::string& body);
+    void handleClient(int client_fd, struct sockaddr_in client_addr, ConnectionSlot slot);
+    void registerRoutes();
+    void addRoute(const std::string& method, const std::string& pattern, Router::Handler handler);
+    void addJsonRoute(const std::string& method, const std::string& pattern, JsonHandler handler);
+    std::string routeRequest(RouteContext& ctx);
+    std::string buildRateLimitedResponse(double retryAfterSeconds, bool keepAlive);
+    std::string buildOverloadedResponse(double retryAfterSeconds, bool keepAlive);
+    std::string buildMetrics();
+    
+    // Response helpers
+    std::string buildHttpResponse(const std::string& status, const std::string& body, bool keepAlive,
+                                  const std::string& extraHeaders = "",
+                                  const std::string& contentType = "application/json");
+    std::string buildEncodedResponse(const HttpRequestView& request, const std::string& status,
+                                     const std::string& body, bool keepAlive);
+    std::shared_ptr<const CachedBlockResponse> getBlockResponse(uint64_t index);
+    std::string buildBlockResponse(const CachedBlockResponse& entry, const HttpRequestView& request,
+                                   bool keepAlive, bool immutable);
+    std::string buildChainResponse(const HttpRequestView& request, bool keepAlive);
+    bool streamBlockRange(RouteContext& ctx);
+    void streamEvents(RouteContext& ctx);
 
 public:
     API(Blockchain& blockchain);
@@ -27,6 +79,12 @@ public:
     void start(int port);
     void stop();
     bool isRunning() const { return running; }
+    
+    // Requests per second and burst size for each limiter
+    void setRateLimits(double ipRate, double ipBurst, double senderRate, double senderBurst);
+    
+    // Number of requests handled concurrently before new ones queue by priority
+    void setMaxInFlight(size_t maxInFlight);
 };
 
 #endif // API_H
\ No newline at end of file
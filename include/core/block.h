@@ -7,6 +7,7 @@
 #include <sstream>
 #include <iomanip>
 #include "transaction.h"
+#include "json_writer.h"
 #include "utils.h"
 
 class Block {
@@ -104,8 +105,9 @@ public:
     std::string getPreviousHash() const { return previousHash; }
     time_t getTimestamp() const { return timestamp; }
     std::string getHash() const { return hash; }
-    std::vector<Transaction> getTransactions() const { return transactions; }
+    const std::vector<Transaction>& getTransactions() const { return transactions; }
     std::string getMerkleRoot() const { return merkleRoot; }
+    uint64_t getNonce() const { return nonce; }
     
     // PoS related methods
     void setValidator(const std::string& validatorAddress) { validator = validatorAddress; }
@@ -128,28 +130,40 @@ public:
         return std::string(buffer);
     }
     
-    // Serialize block to JSON
-    std::string serialize() const {
-        nlohmann::json j;
-        j["index"] = index;
-        j["timestamp"] = timestamp;
-        j["previousHash"] = previousHash;
-        j["hash"] = hash;
-        j["nonce"] = nonce;
-        j["merkleRoot"] = merkleRoot;
+    // Write as a JSON object; keys in sorted order, matching nlohmann output.
+    // Transactions are embedded as their indented JSON text, as they always
+    // have been on the wire and on disk.
+    void writeJson(JsonWriter& json) const {
+        json.beginObject();
+        json.key("hash").hex(hash);
+        json.key("index").value(index);
+        json.key("merkleRoot").hex(merkleRoot);
+        json.key("nonce").value(nonce);
+        json.key("previousHash").hex(previousHash);
+        json.key("signature").hex(signature);
+        json.key("timestamp").value(timestamp);
         
-        // PoS fields
-        j["validator"] = validator;
-        j["signature"] = signature;
-        
-        // Transactions
-        nlohmann::json tx_array = nlohmann::json::array();
+        json.key("transactions").beginArray();
+        std::string text;
         for (const auto& tx : transactions) {
-            tx_array.push_back(tx.serialize());
+            text.clear();
+            JsonWriter txJson(text, 4);
+            tx.writeJson(txJson);
+            json.value(text);
         }
-        j["transactions"] = tx_array;
+        json.endArray();
         
-        return j.dump(4);
+        // PoS fields
+        json.key("validator").value(validator);
+        json.endObject();
+    }
+    
+    // Serialize block to JSON
+    std::string serialize() const {
+        std::string out;
+        JsonWriter json(out, 4);
+        writeJson(json);
+        return out;
     }
     
     // Deserialize block from JSON
@@ -173,9 +187,10 @@ public:
             block.signature = j["signature"].get<std::string>();
         }
         
-        // Transactions
+        // Transactions; serialize() embeds each one as JSON text
         for (const auto& tx_json : j["transactions"]) {
-            block.transactions.push_back(Transaction::deserialize(tx_json.dump()));
+            block.transactions.push_back(Transaction::deserialize(
+                tx_json.is_string() ? tx_json.get<std::string>() : tx_json.dump()));
         }
         
         return block;
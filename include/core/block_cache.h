@@ -0,0 +1,61 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "block.h"
+
+// Serialized response for one confirmed block. Immutable once built, so it
+// can be shared between connections without copying.
+struct CachedBlockResponse {
+    uint64_t index;
+    std::string hash;
+    std::string etag;   // Strong validator, quoted as sent on the wire
+    std::string body;   // Compact JSON
+
+    // Pre-compressed variant for clients sending Accept-Encoding: gzip.
+    // Empty when the body is below the compression threshold.
+    std::string gzipBody;
+    std::string gzipEtag;
+};
+
+// Bounded LRU cache of serialized block responses, keyed by height.
+// Blocks are serialized once when connected; explorer reads of historical
+// blocks then only copy the cached bytes into the socket.
+class BlockResponseCache {
+private:
+    using Entry = std::shared_ptr<const CachedBlockResponse>;
+
+    size_t capacity;
+    std::list<Entry> lru;   // Most recently used at the front
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> entries;
+    mutable std::mutex cacheMutex;
+
+    // Statistics
+    uint64_t hits;
+    uint64_t misses;
+
+public:
+    explicit BlockResponseCache(size_t capacity = 4096);
+
+    // Serialize a block into a cache entry (no locking, no insertion).
+    // Transient entries for one-off streaming can skip compression.
+    static Entry build(const Block& block, bool compress = true);
+
+    Entry put(const Block& block);
+    Entry get(uint64_t index);
+    void clear();
+
+    size_t size() const;
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+
+    // True if an If-None-Match header value matches the given entity tag
+    static bool etagMatches(std::string_view ifNoneMatch, const std::string& etag);
+};
+
+#endif // BLOCK_CACHE_H
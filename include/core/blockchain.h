@@ -3,19 +3,44 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <fstream>
 #include <mutex>
 #include <deque>
+#include <functional>
 #include "json.hpp"
 #include "block.h"
 #include "transaction.h"
 #include "logger.h"
 
+// Read-only view of chain state handed out by Blockchain::readConsistent().
+// References are only valid inside the callback.
+struct ChainView {
+    const std::vector<Block>& chain;
+    const std::map<std::string, double>& balances;
+    const std::deque<Transaction>& pendingTransactions;
+    const std::unordered_map<std::string, std::pair<size_t, size_t>>& transactionIndex;   // Hash -> (height, position)
+    uint64_t difficulty;
+    double miningReward;
+};
+
+// Callbacks for chain events. Any member may be left empty. They are invoked
+// on the thread that caused the event, after the chain locks are released.
+struct ChainListener {
+    std::function<void(const Block&)> onBlockConnected;
+    std::function<void(const Transaction&)> onTransactionAdded;
+    std::function<void(size_t newHeight)> onChainReset;   // Chain replaced (reorg or reload)
+};
+
 class Blockchain {
 private:
     std::vector<Block> chain;
     std::deque<Transaction> pendingTransactions;
+    
+    // Confirmed transactions by hash -> (height, position in block), so
+    // lookups never scan the chain; a hash repeated later points at the newest
+    std::unordered_map<std::string, std::pair<size_t, size_t>> transactionIndex;
     uint64_t difficulty;
     double miningReward;
     
@@ -31,6 +56,41 @@ private:
     
     // Validators for PoS (address -> stake amount)
     std::map<std::string, double> validators;
+    
+    // Observers of chain events (see ChainListener)
+    std::map<size_t, ChainListener> listeners;
+    size_t nextListenerId = 0;
+    mutable std::mutex listenerMutex;
+    
+    // Append to the chain and index its transactions; chainMutex held
+    void appendBlock(const Block& block) {
+        const std::vector<Transaction>& transactions = block.getTransactions();
+        for (size_t i = 0; i < transactions.size(); i++) {
+            transactionIndex[transactions[i].getHash()] = {chain.size(), i};
+        }
+        chain.push_back(block);
+    }
+    
+    void notifyBlockConnected(const Block& block) {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        for (const auto& pair : listeners) {
+            if (pair.second.onBlockConnected) pair.second.onBlockConnected(block);
+        }
+    }
+    
+    void notifyTransactionAdded(const Transaction& tx) {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        for (const auto& pair : listeners) {
+            if (pair.second.onTransactionAdded) pair.second.onTransactionAdded(tx);
+        }
+    }
+    
+    void notifyChainReset(size_t newHeight) {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        for (const auto& pair : listeners) {
+            if (pair.second.onChainReset) pair.second.onChainReset(newHeight);
+        }
+    }
 
 public:
     // Constructor
@@ -53,7 +113,7 @@ public:
         genesis.mineBlock(1);
         
         // Add genesis block to the chain
-        chain.push_back(genesis);
+        appendBlock(genesis);
         
         // Update the balance for the genesis account
         balances["GENESIS"] = 1000.0;
@@ -73,39 +133,43 @@ public:
     
     // Add a block to the chain
     bool addBlock(Block newBlock) {
-        std::lock_guard<std::mutex> lock(chainMutex);
-        
-        // Verify that the previous hash matches the hash of the latest block
-        if (newBlock.getPreviousHash() != getLatestBlock().getHash()) {
-            Logger::error("Block rejected: Invalid previous hash");
-            return false;
-        }
-        
-        // Verify that the index is sequential
-        if (newBlock.getIndex() != getLatestBlock().getIndex() + 1) {
-            Logger::error("Block rejected: Invalid block index");
-            return false;
-        }
-        
-        // Verify that the block's hash is valid based on our current difficulty
-        // Skip difficulty validation for genesis block (index 0)
-        if (newBlock.getIndex() > 0) {
-            std::string target(difficulty, '0');
-            if (newBlock.getHash().substr(0, difficulty) != target) {
-                Logger::error("Block rejected: Proof of work or stake verification failed");
+        {
+            std::lock_guard<std::mutex> lock(chainMutex);
+            
+            // Verify that the previous hash matches the hash of the latest block
+            if (newBlock.getPreviousHash() != getLatestBlock().getHash()) {
+                Logger::error("Block rejected: Invalid previous hash");
                 return false;
             }
+            
+            // Verify that the index is sequential
+            if (newBlock.getIndex() != getLatestBlock().getIndex() + 1) {
+                Logger::error("Block rejected: Invalid block index");
+                return false;
+            }
+            
+            // Verify that the block's hash is valid based on our current difficulty
+            // Skip difficulty validation for genesis block (index 0)
+            if (newBlock.getIndex() > 0) {
+                std::string target(difficulty, '0');
+                if (newBlock.getHash().substr(0, difficulty) != target) {
+                    Logger::error("Block rejected: Proof of work or stake verification failed");
+                    return false;
+                }
+            }
+            
+            // Process transactions in the block
+            for (const Transaction& tx : newBlock.getTransactions()) {
+                processTransaction(tx);
+            }
+            
+            // Add the block to the chain
+            appendBlock(newBlock);
+            Logger::info("Block added to chain at height: " + std::to_string(newBlock.getIndex()));
         }
         
-        // Process transactions in the block
-        for (const Transaction& tx : newBlock.getTransactions()) {
-            processTransaction(tx);
-        }
-        
-        // Add the block to the chain
-        chain.push_back(newBlock);
-        Logger::info("Block added to chain at height: " + std::to_string(newBlock.getIndex()));
-        
+        // Listeners run outside the chain lock so they may query the chain
+        notifyBlockConnected(newBlock);
         return true;
     }
     
@@ -169,33 +233,36 @@ public:
     
     // Add a transaction to the pending pool
     bool addTransaction(const Transaction& tx) {
-        std::lock_guard<std::mutex> lock(txMutex);
-        
-        if (!tx.isValid()) {
-            Logger::error("Invalid transaction rejected: " + tx.getHash());
-            return false;
-        }
-        
-        // For non-coinbase transactions, check if sender has enough balance
-        if (tx.getSender() != "COINBASE") {
-            const std::string& sender = tx.getSender();
+        {
+            std::lock_guard<std::mutex> lock(txMutex);
             
-            if (balances.find(sender) == balances.end() || balances[sender] < tx.getAmount()) {
-                Logger::error("Transaction rejected: Insufficient balance for " + sender);
+            if (!tx.isValid()) {
+                Logger::error("Invalid transaction rejected: " + tx.getHash());
                 return false;
             }
+            
+            // For non-coinbase transactions, check if sender has enough balance
+            if (tx.getSender() != "COINBASE") {
+                const std::string& sender = tx.getSender();
+                
+                if (balances.find(sender) == balances.end() || balances[sender] < tx.getAmount()) {
+                    Logger::error("Transaction rejected: Insufficient balance for " + sender);
+                    return false;
+                }
+            }
+            
+            pendingTransactions.push_back(tx);
+            Logger::info("Transaction added to pending pool: " + tx.getHash());
         }
         
-        pendingTransactions.push_back(tx);
-        Logger::info("Transaction added to pending pool: " + tx.getHash());
-        
+        notifyTransactionAdded(tx);
         return true;
     }
     
     // Mine pending transactions (reward goes to the provided address)
     Block minePendingTransactions(const std::string& miningRewardAddress) {
-        std::lock_guard<std::mutex> lockChain(chainMutex);
-        std::lock_guard<std::mutex> lockTx(txMutex);
+        std::unique_lock<std::mutex> lockChain(chainMutex);
+        std::unique_lock<std::mutex> lockTx(txMutex);
         
         // Create a coinbase transaction
         Transaction coinbaseTx("COINBASE", miningRewardAddress, miningReward);
@@ -226,7 +293,7 @@ public:
         newBlock.mineBlock(difficulty);
         
         // Add the block to the chain
-        chain.push_back(newBlock);
+        appendBlock(newBlock);
         
         // Process transactions
         for (const Transaction& tx : newBlock.getTransactions()) {
@@ -235,6 +302,10 @@ public:
         
         Logger::info("Block mined successfully: " + newBlock.getHash());
         
+        lockTx.unlock();
+        lockChain.unlock();
+        notifyBlockConnected(newBlock);
+        
         return newBlock;
     }
     
@@ -399,8 +470,8 @@ public:
     
     // Load the blockchain from a file
     bool loadFromFile(const std::string& filename) {
-        std::lock_guard<std::mutex> lockChain(chainMutex);
-        std::lock_guard<std::mutex> lockTx(txMutex);
+        std::unique_lock<std::mutex> lockChain(chainMutex);
+        std::unique_lock<std::mutex> lockTx(txMutex);
         
         std::ifstream file(filename);
         if (!file.is_open()) {
@@ -416,13 +487,14 @@ public:
             
             // Clear existing data
             chain.clear();
+            transactionIndex.clear();
             pendingTransactions.clear();
             balances.clear();
             validators.clear();
             
             // Load the chain
             for (const auto& block_json : blockchain_json["blocks"]) {
-                chain.push_back(Block::deserialize(block_json.dump()));
+                appendBlock(Block::deserialize(block_json.dump()));
             }
             
             // If no blocks were loaded, create genesis block
@@ -453,11 +525,21 @@ public:
             Logger::info("Blockchain loaded from file: " + filename);
             Logger::info("Chain height: " + std::to_string(chain.size()));
             
+            size_t newHeight = chain.size();
+            lockTx.unlock();
+            lockChain.unlock();
+            notifyChainReset(newHeight);
+            
             return true;
         } catch (const std::exception& e) {
             Logger::error("Failed to load blockchain: " + std::string(e.what()));
             Logger::info("Creating new blockchain with genesis block");
             createGenesisBlock();
+            
+            size_t newHeight = chain.size();
+            lockTx.unlock();
+            lockChain.unlock();
+            notifyChainReset(newHeight);
             return false;
         }
     }
@@ -467,6 +549,47 @@ public:
         return chain;
     }
     
+    // Copy a single block without copying the chain
+    bool getBlock(uint64_t index, Block& out) const {
+        std::lock_guard<std::mutex> lock(*const_cast<std::mutex*>(&chainMutex));
+        if (index >= chain.size()) {
+            return false;
+        }
+        out = chain[index];
+        return true;
+    }
+    
+    // Run fn against one consistent snapshot of the chain, balances and
+    // pending pool. Writers are blocked until fn returns, so keep it short;
+    // fn may read the view from several threads but must not call back
+    // into locking Blockchain methods.
+    void readConsistent(const std::function<void(const ChainView&)>& fn) const {
+        std::lock_guard<std::mutex> lockChain(*const_cast<std::mutex*>(&chainMutex));
+        std::lock_guard<std::mutex> lockTx(*const_cast<std::mutex*>(&txMutex));
+        ChainView view{chain, balances, pendingTransactions, transactionIndex, difficulty, miningReward};
+        fn(view);
+    }
+    
+    // Register chain event callbacks; returns an id for removeListener()
+    size_t addListener(ChainListener listener) {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        size_t id = nextListenerId++;
+        listeners[id] = std::move(listener);
+        return id;
+    }
+    
+    // Convenience wrapper for observers that only care about new blocks
+    size_t addBlockListener(std::function<void(const Block&)> onBlockConnected) {
+        ChainListener listener;
+        listener.onBlockConnected = std::move(onBlockConnected);
+        return addListener(std::move(listener));
+    }
+    
+    void removeListener(size_t id) {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listeners.erase(id);
+    }
+    
     // Get pending transactions
     std::deque<Transaction> getPendingTransactions() const {
         return pendingTransactions;
@@ -482,6 +605,11 @@ public:
         return chain.size();
     }
     
+    // Pool size without copying the pool
+    size_t getPendingTransactionCount() const {
+        return pendingTransactions.size();
+    }
+    
     // Set mining difficulty
     void setDifficulty(uint64_t newDifficulty) {
         difficulty = newDifficulty;
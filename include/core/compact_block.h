@@ -0,0 +1,79 @@
+#ifndef COMPACT_BLOCK_H
+#define COMPACT_BLOCK_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <cstdint>
+#include "block.h"
+#include "sync.h"
+#include "json.hpp"
+
+// SipHash-2-4 of data under the 128-bit key (k0, k1)
+uint64_t sipHash24(uint64_t k0, uint64_t k1, const void* data, size_t length);
+
+// A block announced as its header plus a 6-byte short ID per transaction.
+// Short IDs are SipHash-2-4 of the transaction hash, keyed from the block
+// hash and a per-announcement salt, so an attacker cannot precompute
+// colliding transactions. The coinbase, which no mempool holds, is sent in
+// full.
+class CompactBlock {
+private:
+    BlockHeader header;
+    std::string signature;
+    uint64_t salt;
+    uint64_t k0;
+    uint64_t k1;
+    size_t transactionCount;
+    std::vector<uint64_t> shortIds;   // In block order, skipping prefilled slots
+    std::vector<std::pair<size_t, Transaction>> prefilled;   // (position, transaction)
+
+    void deriveKeys();
+
+    friend class PartialBlock;
+
+public:
+    static constexpr uint64_t SHORT_ID_MASK = 0xffffffffffffULL;
+
+    CompactBlock();
+    static CompactBlock fromBlock(const Block& block, uint64_t salt);
+
+    // Short IDs travel as one hex string, 12 digits per transaction
+    nlohmann::json toJson() const;
+    static CompactBlock fromJson(const nlohmann::json& json);
+
+    uint64_t shortId(const std::string& transactionHash) const;
+    const BlockHeader& getHeader() const { return header; }
+    size_t getTransactionCount() const { return transactionCount; }
+};
+
+// Rebuilds a compact block from the local mempool, then from the
+// transactions the announcing peer sends for the slots still empty
+class PartialBlock {
+private:
+    CompactBlock compact;
+    std::vector<std::optional<Transaction>> slots;
+
+public:
+    explicit PartialBlock(CompactBlock compact);
+
+    // Fill every slot whose short ID matches exactly one pool transaction;
+    // returns the positions still missing
+    std::vector<size_t> fillFromMempool(const std::deque<Transaction>& mempool);
+
+    // Transactions for the positions getMissing() returned, in that order
+    bool fillMissing(const std::vector<Transaction>& transactions);
+
+    std::vector<size_t> getMissing() const;
+
+    // Empty every slot except the prefilled ones; returns the new missing list
+    std::vector<size_t> reset();
+    const BlockHeader& getHeader() const { return compact.header; }
+
+    // Assemble the block; fails if it does not hash to the announced header
+    // or its transactions do not produce the header's merkle root
+    bool build(Block& out) const;
+};
+
+#endif // COMPACT_BLOCK_H
@@ -0,0 +1,21 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <string>
+#include <string_view>
+
+// zlib helpers for HTTP content encoding
+class Compression {
+public:
+    // Bodies smaller than this are sent as-is; gzip framing and the CPU cost
+    // outweigh the savings on small payloads
+    static constexpr size_t GZIP_MIN_SIZE = 1024;
+
+    // Compress into a gzip member (RFC 1952). Returns an empty string on failure.
+    static std::string gzip(std::string_view data, int level = 6);
+
+    // True if an Accept-Encoding header value allows gzip (honours q=0)
+    static bool acceptsGzip(std::string_view acceptEncoding);
+};
+
+#endif // COMPRESSION_H
@@ -0,0 +1,101 @@
+#ifndef DIALER_H
+#define DIALER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include "json.hpp"
+
+struct DialerConfig {
+    size_t targetOutbound = 8;                            // Outbound peers to keep
+    size_t maxInFlight = 16;                              // Connects pending at once
+    std::chrono::milliseconds connectTimeout{5000};       // A dial still pending after this has failed
+    std::chrono::milliseconds initialBackoff{1000};       // After the first failure
+    std::chrono::milliseconds maxBackoff{600000};
+    double jitter = 0.25;                                 // Backoff is scaled by 1 +/- jitter
+    size_t maxAddresses = 2048;
+    std::string addressBookPath;                          // Known-good peers; empty to not persist
+};
+
+// Outbound dial scheduling and the address book behind it. Every tick
+// hands out as many addresses as there are free slots, so connects run in
+// parallel on the reactor and one dead address costs a slot, not the whole
+// bootstrap. Peers that completed a handshake before are tried first and
+// saved to addressBookPath for the next start. Failed addresses back off
+// exponentially with jitter, so a flapping peer is not hammered and many
+// nodes restarting together do not dial in lockstep. Addresses are
+// "address:port" like the rest of the networking code; thread-safe.
+class Dialer {
+private:
+    struct Entry {
+        std::string address;
+        uint16_t port = 0;
+        uint64_t lastSuccess = 0;    // Unix seconds of the last handshake, 0 if never
+        uint32_t failures = 0;       // Consecutive failed dials
+        std::chrono::steady_clock::time_point nextAttempt;
+    };
+
+    DialerConfig config;
+    std::map<std::string, Entry> addresses;
+    std::map<std::string, std::chrono::steady_clock::time_point> inFlight;   // By address, with start time
+    std::set<std::string> outbound;                                          // Dialed and handshaken
+    std::mt19937_64 rng;
+    mutable std::mutex dialerMutex;
+
+    // Dialer statistics
+    uint64_t dialsStarted;
+    uint64_t dialsSucceeded;
+    uint64_t dialsFailed;
+    uint64_t dialsTimedOut;
+
+    Entry& entryFor(const std::string& address, uint16_t port);
+    void backOff(Entry& entry, std::chrono::steady_clock::time_point now);
+    void trimLocked();
+
+public:
+    struct Dial {
+        std::string address;
+        uint16_t port;
+    };
+
+    // What the engine should do this tick
+    struct Plan {
+        std::vector<Dial> dials;              // Connect to these
+        std::vector<std::string> timedOut;    // Abandon these pending connects
+    };
+
+    explicit Dialer(const DialerConfig& config = DialerConfig());
+
+    // Add a candidate address; known entries keep their history
+    void addAddress(const std::string& address, uint16_t port);
+
+    // Addresses to dial now, given the peers already connected either way
+    Plan tick(const std::set<std::string>& connected);
+
+    // Outcome of a dial. started() is called for dials made outside tick()
+    // as well, so every outbound connection is accounted for.
+    void dialStarted(const std::string& address, uint16_t port);
+    void dialSucceeded(const std::string& peer);
+    void connectionClosed(const std::string& peer);
+
+    // Keep every port of a host out of tick() until the given time, and
+    // drop any of its dials still pending
+    void deferHost(const std::string& address, std::chrono::steady_clock::time_point until);
+
+    bool isDialing(const std::string& peer) const;
+    bool isOutbound(const std::string& peer) const;   // Dialed by us, pending or handshaken
+    size_t getOutboundCount() const;
+
+    // Read and write the known-good peers at addressBookPath
+    bool load();
+    bool save() const;
+
+    nlohmann::json getStats() const;
+};
+
+#endif // DIALER_H
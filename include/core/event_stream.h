@@ -0,0 +1,81 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <set>
+
+// One published event, already framed in Server-Sent Events wire format.
+// Shared by every subscriber so it is serialized exactly once.
+struct StreamEvent {
+    uint64_t id;
+    std::string type;
+    std::string frame;   // "id: ...\nevent: ...\ndata: ...\n\n"
+};
+
+using SharedStreamEvent = std::shared_ptr<const StreamEvent>;
+
+// Per-client queue with a fixed bound. A subscriber that falls more than
+// maxQueued events behind is marked dropped instead of buffering forever.
+class EventSubscriber {
+private:
+    std::deque<SharedStreamEvent> queue;
+    size_t maxQueued;
+    std::set<std::string> types;   // Empty means all event types
+    bool dropped;
+    bool closed;
+    mutable std::mutex subscriberMutex;
+    std::condition_variable subscriberCV;
+
+    friend class EventBroadcaster;
+    bool offer(const SharedStreamEvent& event);
+
+public:
+    EventSubscriber(size_t maxQueued, std::set<std::string> types);
+
+    bool wants(const std::string& type) const { return types.empty() || types.count(type) > 0; }
+
+    // Wait up to timeout for events. Returns false once the subscriber has
+    // been dropped or closed; an empty batch with true means a timeout.
+    bool next(std::vector<SharedStreamEvent>& batch, std::chrono::milliseconds timeout);
+    void close();
+    bool wasDropped() const;
+};
+
+// Fan-out hub for chain events pushed to API clients
+class EventBroadcaster {
+private:
+    std::vector<std::shared_ptr<EventSubscriber>> subscribers;
+    std::deque<SharedStreamEvent> history;   // Recent events for Last-Event-ID resume
+    size_t historySize;
+    uint64_t nextEventId;
+    mutable std::mutex broadcasterMutex;
+
+    // Statistics
+    std::atomic<uint64_t> eventsPublished{0};
+    std::atomic<uint64_t> subscribersDropped{0};
+
+public:
+    explicit EventBroadcaster(size_t historySize = 256);
+
+    // Frame the event once and queue it for every interested subscriber
+    void publish(const std::string& type, const std::string& data);
+
+    // Register a client; events newer than lastEventId are replayed if still in history
+    std::shared_ptr<EventSubscriber> subscribe(size_t maxQueued, std::set<std::string> types,
+                                               uint64_t lastEventId = 0);
+    void unsubscribe(const std::shared_ptr<EventSubscriber>& subscriber);
+    void closeAll();
+
+    size_t getSubscriberCount() const;
+    uint64_t getEventsPublished() const { return eventsPublished; }
+    uint64_t getSubscribersDropped() const { return subscribersDropped; }
+};
+
+#endif // EVENT_STREAM_H
@@ -0,0 +1,123 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <sys/types.h>
+
+// Header field as a view into the connection buffer
+struct HttpHeaderView {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Parsed HTTP request. Every view points into the connection buffer and is
+// only valid until the buffer is consumed or refilled.
+struct HttpRequestView {
+    std::string_view method;
+    std::string_view target;    // Full request-target, including the query string
+    std::string_view path;
+    std::string_view query;
+    std::string_view version;
+    std::vector<HttpHeaderView> headers;
+    std::string_view body;
+    bool keepAlive = true;
+
+    // Case-insensitive header lookup; returns an empty view if absent
+    std::string_view header(std::string_view name) const;
+};
+
+enum class HttpParseStatus {
+    INCOMPLETE,
+    COMPLETE,
+    ERROR
+};
+
+// Incremental HTTP/1.1 request parser.
+//
+// parse() is called with the unconsumed part of the connection buffer each
+// time more bytes arrive. It remembers how far it has scanned, so partial
+// reads are not rescanned. Content-Length and chunked bodies are supported;
+// chunked bodies are decoded in place so the body is always one contiguous
+// view. On COMPLETE, consumed() is the size of the request on the wire and
+// any remaining bytes belong to the next pipelined request.
+class HttpRequestParser {
+private:
+    enum class State {
+        HEADERS,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_DATA_END,
+        TRAILERS,
+        DONE,
+        FAILED
+    };
+
+    size_t maxHeaderBytes;
+    size_t maxBodyBytes;
+
+    State state;
+    size_t scanOffset;        // Read position in the input
+    size_t headerEnd;         // Offset just past the blank line ending the headers
+    size_t bodyStart;
+    size_t bodyLength;        // Decoded body bytes so far (or the Content-Length)
+    size_t chunkRemaining;
+    bool expectContinue;
+    int errorCode;
+    std::string errorText;
+
+    // Header layout recorded as offsets so it survives buffer reallocation
+    struct Span { size_t offset; size_t length; };
+    Span methodSpan, targetSpan, versionSpan;
+    std::vector<std::pair<Span, Span>> headerSpans;
+
+    HttpRequestView view;
+
+    HttpParseStatus fail(int code, const std::string& message);
+    HttpParseStatus parseHeaders(char* data, size_t size);
+    HttpParseStatus parseChunked(char* data, size_t size);
+    void buildView(const char* data);
+
+public:
+    explicit HttpRequestParser(size_t maxHeaderBytes = 16 * 1024,
+                               size_t maxBodyBytes = 8 * 1024 * 1024);
+
+    // Parse the request at the start of data. The buffer may be modified
+    // (chunked bodies are compacted in place).
+    HttpParseStatus parse(char* data, size_t size);
+    void reset();
+
+    const HttpRequestView& request() const { return view; }
+    size_t consumed() const { return scanOffset; }
+    bool headersComplete() const { return headerEnd != 0; }
+    bool expectsContinue() const { return expectContinue; }
+    int getErrorStatus() const { return errorCode; }
+    const std::string& getErrorMessage() const { return errorText; }
+};
+
+// Per-connection receive buffer. New bytes are appended at the tail and
+// completed requests are consumed from the head, so pipelined requests are
+// parsed straight out of the same allocation.
+class HttpConnectionBuffer {
+private:
+    std::string buffer;
+    size_t start;
+    size_t end;
+
+public:
+    explicit HttpConnectionBuffer(size_t initialCapacity = 8192);
+
+    char* data() { return &buffer[start]; }
+    size_t size() const { return end - start; }
+    bool empty() const { return end == start; }
+
+    // Receive up to readSize bytes from fd; returns the recv() result
+    ssize_t fill(int fd, size_t readSize = 16384);
+    void append(const char* bytes, size_t length);
+    void consume(size_t length);
+};
+
+#endif // HTTP_PARSER_H
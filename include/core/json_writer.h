@@ -0,0 +1,64 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <type_traits>
+
+// Streaming JSON writer that appends straight into a caller-owned buffer,
+// without building a DOM. Output matches nlohmann::json::dump() byte for
+// byte (compact, or pretty with indent >= 0) as long as object keys are
+// written in sorted order, which is how nlohmann orders them.
+//
+//   std::string out;
+//   JsonWriter json(out);
+//   json.beginObject().key("address").value(address).key("balance").value(balance).endObject();
+class JsonWriter {
+private:
+    std::string& out;
+    int indent;                 // -1 for compact output
+    std::vector<bool> empty;    // Per open container: nothing written yet
+    bool afterKey;
+
+    void beforeValue();
+    void newline(size_t depth);
+
+public:
+    explicit JsonWriter(std::string& out, int indent = -1);
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(bool flag);
+    JsonWriter& value(double number);
+    JsonWriter& null();
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    JsonWriter& value(T number) {
+        beforeValue();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+        return *this;
+    }
+
+    // Strings that normally need no escaping (hashes, hex keys, signatures).
+    // Copied in one append after a range check instead of escaped per byte.
+    JsonWriter& hex(std::string_view text);
+
+    // Already-serialized JSON value, copied verbatim
+    JsonWriter& raw(std::string_view json);
+
+    // Append text as a quoted JSON string, escaped like nlohmann::json
+    static void appendEscaped(std::string& out, std::string_view text);
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,126 @@
+#ifndef MESSAGE_CODEC_H
+#define MESSAGE_CODEC_H
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <sys/types.h>
+#include <zlib.h>
+
+// Wire format of a P2P frame. All integers are big-endian.
+//
+//   magic     4 bytes   first 4 bytes of SHA-256(NetworkConfig::networkMagic)
+//   type      2 bytes   MessageType
+//   flags     2 bytes   payload encoding bits, 0 for plain JSON
+//   length    4 bytes   payload size
+//   checksum  4 bytes   CRC-32 of the payload
+//   payload   length bytes
+struct FrameHeader {
+    static constexpr size_t SIZE = 16;
+    static constexpr uint16_t FLAG_COMPRESSED = 0x0001;   // Payload is a zlib stream
+
+    std::array<uint8_t, 4> magic;
+    uint16_t type;
+    uint16_t flags;
+    uint32_t length;
+    uint32_t checksum;
+};
+
+// A decoded frame. The payload points into the decoder's buffer and stays
+// valid until the next call to FrameDecoder::next() or fill().
+struct FrameView {
+    uint16_t type = 0;
+    uint16_t flags = 0;
+    std::string_view payload;
+};
+
+enum class FrameStatus {
+    INCOMPLETE,   // Need more bytes
+    FRAME,        // A complete frame is available
+    ERROR         // Stream is corrupt; the connection should be dropped
+};
+
+// Encodes frames and derives the 4-byte network magic
+class FrameCodec {
+public:
+    static std::array<uint8_t, 4> magicFor(const std::string& networkMagic);
+
+    // Append a complete frame to out
+    static void encode(std::string& out, const std::array<uint8_t, 4>& magic, uint16_t type,
+                       std::string_view payload, uint16_t flags = 0);
+
+    // Write just the header for payload, so the payload can be sent from
+    // its own buffer
+    static void encodeHeader(char* out, const std::array<uint8_t, 4>& magic, uint16_t type,
+                             std::string_view payload, uint16_t flags = 0);
+
+    // As above, with a checksum computed earlier so a payload shared by
+    // many frames is only hashed once
+    static void encodeHeader(char* out, const std::array<uint8_t, 4>& magic, uint16_t type,
+                             uint32_t length, uint32_t checksum, uint16_t flags = 0);
+
+    static uint32_t checksum(std::string_view payload);
+};
+
+// zlib streams kept for the life of a connection. Every payload is still
+// an independent zlib stream, but the streams are reset rather than
+// reallocated, which saves a few hundred KB of allocation per message.
+// Not thread-safe; each direction belongs to one thread.
+class FrameCompressor {
+private:
+    z_stream deflater;
+    z_stream inflater;
+    bool deflaterReady;
+    bool inflaterReady;
+    int level;
+
+public:
+    explicit FrameCompressor(int level = Z_DEFAULT_COMPRESSION);
+    ~FrameCompressor();
+    FrameCompressor(const FrameCompressor&) = delete;
+    FrameCompressor& operator=(const FrameCompressor&) = delete;
+
+    bool compress(std::string_view input, std::string& output);
+
+    // Fails on a corrupt or truncated stream, or as soon as the output
+    // would exceed maxSize, so a small frame cannot inflate without bound
+    bool decompress(std::string_view input, std::string& output, size_t maxSize);
+};
+
+// Per-connection reassembly buffer. Bytes are received straight into the
+// tail and complete frames are handed out as views of the head, so a
+// payload is never copied between the socket and its handler. Consumed
+// space is reclaimed by compacting, which keeps every payload contiguous.
+class FrameDecoder {
+private:
+    std::array<uint8_t, 4> magic;
+    size_t maxPayloadSize;
+    size_t initialCapacity;
+    std::string buffer;
+    size_t start;
+    size_t end;
+    size_t pendingConsume;   // Bytes of the frame last returned by next()
+    std::string error;
+
+    void reserveTail(size_t length);
+
+public:
+    FrameDecoder(const std::string& networkMagic, size_t maxPayloadSize, size_t initialCapacity = 16384);
+
+    // Receive up to readSize bytes from fd; returns the recv() result
+    ssize_t fill(int fd, size_t readSize = 65536);
+    void append(const char* bytes, size_t length);
+
+    // Decode the next frame. Magic, size and checksum are checked before
+    // the frame is returned; ERROR is sticky.
+    FrameStatus next(FrameView& frame);
+
+    // Bytes still missing before the next frame can be returned
+    size_t bytesNeeded() const;
+
+    size_t buffered() const { return end - start - pendingConsume; }
+    const std::string& getError() const { return error; }
+};
+
+#endif // MESSAGE_CODEC_H
@@ -9,6 +9,10 @@
 #include <random>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
 #include "block.h"
 #include "transaction.h"
 #include "blockchain.h"
@@ -148,7 +152,8 @@ public:
     void clearPendingTransactions();
     
     // Block mining
-    Block mineBlock(const std::string& minerAddress, uint64_t maxAttempts = 0);
+    Block mineBlock(const std::string& minerAddress, uint64_t maxAttempts = 0,
+                    const std::atomic<bool>* cancelled = nullptr);
     Block mineBlockWithTransactions(const std::string& minerAddress, 
                                    const std::vector<Transaction>& transactions);
     
@@ -229,6 +234,86 @@ public:
     void setActive(bool status) { active = status; }
 };
 
+// Lifecycle of an asynchronous mining job
+enum class MiningJobState {
+    QUEUED,
+    RUNNING,
+    COMPLETED,
+    FAILED,
+    CANCELLED
+};
+
+// Point-in-time copy of a mining job, safe to hand to request threads
+struct MiningJobInfo {
+    std::string id;
+    std::string minerAddress;
+    MiningJobState state = MiningJobState::QUEUED;
+    std::string error;
+    uint64_t blockIndex = 0;
+    std::string blockHash;
+    double reward = 0.0;
+    std::chrono::system_clock::time_point submittedAt;
+    std::chrono::system_clock::time_point finishedAt;
+    
+    bool isFinished() const {
+        return state == MiningJobState::COMPLETED || state == MiningJobState::FAILED ||
+               state == MiningJobState::CANCELLED;
+    }
+    nlohmann::json toJson() const;
+    static std::string stateName(MiningJobState state);
+};
+
+// Runs POST /mine requests on a dedicated executor thread so HTTP threads
+// return immediately with a job id. The queue is bounded; finished jobs are
+// kept for status lookups up to a fixed count.
+class MiningJobQueue {
+private:
+    struct Job {
+        MiningJobInfo info;
+        std::atomic<bool> cancelRequested{false};
+    };
+    
+    MiningEngine& miningEngine;
+    Blockchain& blockchain;
+    size_t maxQueued;
+    size_t maxRetained;
+    
+    std::deque<std::shared_ptr<Job>> queue;
+    std::map<std::string, std::shared_ptr<Job>> jobs;
+    std::deque<std::string> finishedOrder;   // Oldest finished job first
+    std::shared_ptr<Job> current;
+    uint64_t nextJobId;
+    std::function<void(const MiningJobInfo&)> onFinished;
+    
+    std::atomic<bool> running;
+    std::thread executor;
+    mutable std::mutex jobsMutex;
+    std::condition_variable jobsCV;
+    
+    void executorLoop();
+    void finish(const std::shared_ptr<Job>& job, MiningJobState state, const std::string& error);
+    
+public:
+    MiningJobQueue(MiningEngine& miningEngine, Blockchain& blockchain,
+                   size_t maxQueued = 16, size_t maxRetained = 1024);
+    ~MiningJobQueue();
+    
+    void start();
+    void stop();
+    
+    // Queue a job; returns false (and leaves id empty) when the queue is full
+    bool submit(const std::string& minerAddress, std::string& id);
+    
+    // Cancel a queued or running job; false if unknown or already finished
+    bool cancel(const std::string& id);
+    
+    bool getJob(const std::string& id, MiningJobInfo& out) const;
+    size_t getQueueDepth() const;
+    
+    // Called on the executor thread whenever a job finishes
+    void setCompletionCallback(std::function<void(const MiningJobInfo&)> callback);
+};
+
 // Consensus mechanism
 class ConsensusEngine {
 private:
@@ -0,0 +1,172 @@
+#ifndef NETSIM_H
+#define NETSIM_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include "blockchain.h"
+#include "mining.h"
+#include "networking.h"
+#include "json.hpp"
+
+// Shape of one simulated link, applied to each direction separately
+struct LinkProfile {
+    std::chrono::microseconds latency{0};              // One-way propagation delay
+    double bandwidth = 0;                              // Bytes/sec, 0 for unlimited
+    double loss = 0;                                   // Probability a 1460-byte segment is lost
+    std::chrono::milliseconds retransmitDelay{200};    // What a loss costs, like a TCP RTO
+};
+
+// A TCP relay on a loopback port that makes the connection behave like a
+// WAN link. Bytes leave at the link's bandwidth, arrive one latency later,
+// and a lost segment holds up everything behind it for retransmitDelay,
+// as TCP's in-order delivery would. Reading only at line rate leaves the
+// backlog in the sender's socket buffers, so backpressure reaches the
+// engine's write path as it would on a real link.
+class SimulatedLink {
+private:
+    struct Segment {
+        std::chrono::steady_clock::time_point deliverAt;
+        std::string bytes;
+    };
+
+    // One direction of one relayed connection
+    struct Pipe {
+        int from;
+        int to;
+        std::deque<Segment> queue;
+        std::mutex mutex;
+        std::condition_variable ready;
+        bool closed = false;
+        std::thread reader;
+        std::thread writer;
+    };
+
+    LinkProfile profile;
+    uint16_t targetPort;
+    int listener;
+    uint16_t port;
+    std::atomic<bool> running;
+    std::thread acceptor;
+    std::vector<std::unique_ptr<Pipe>> pipes;
+    std::vector<int> sockets;
+    std::mutex pipesMutex;
+    std::mt19937_64 rng;
+    std::atomic<uint64_t> bytesForwarded;
+
+    void acceptLoop();
+    void startPipe(int from, int to);
+    void readLoop(Pipe& pipe, uint64_t seed);
+    void writeLoop(Pipe& pipe);
+
+public:
+    SimulatedLink(uint16_t targetPort, const LinkProfile& profile, uint64_t seed = 1);
+    ~SimulatedLink();
+    SimulatedLink(const SimulatedLink&) = delete;
+    SimulatedLink& operator=(const SimulatedLink&) = delete;
+
+    // Listen on an ephemeral loopback port
+    bool start();
+    void stop();
+
+    uint16_t getPort() const { return port; }
+    uint64_t getBytesForwarded() const { return bytesForwarded; }
+};
+
+struct SimulationConfig {
+    size_t nodes = 8;
+    size_t outboundPerNode = 3;          // Random peers each node dials
+    uint16_t basePort = 19000;           // Node i listens on basePort + i
+    LinkProfile link;
+    uint64_t difficulty = 2;
+    uint64_t seed = 1;
+    std::chrono::seconds timeout{30};    // Per scenario step
+    NetworkConfig network;               // Template for every node; ports are overridden
+};
+
+// Nearest-rank percentiles of a set of samples, in milliseconds
+struct LatencySummary {
+    size_t count = 0;
+    size_t expected = 0;   // Samples that should have arrived
+    double mean = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+
+    static LatencySummary of(std::vector<double> samples, size_t expected);
+    nlohmann::json toJson() const;
+    std::string toString() const;
+};
+
+struct SyncResult {
+    bool completed = false;
+    uint64_t blocks = 0;
+    double seconds = 0;
+    uint64_t bytesReceived = 0;
+
+    double blocksPerSecond() const { return seconds > 0 ? blocks / seconds : 0; }
+    double bytesPerSecond() const { return seconds > 0 ? bytesReceived / seconds : 0; }
+    nlohmann::json toJson() const;
+};
+
+// N full nodes in one process, each on its own loopback port, with every
+// connection routed through a SimulatedLink. One extra node is built with
+// the others but kept offline for the sync scenario: genesis blocks are
+// timestamped, so every chain has to be created in the same second.
+class SimulatedNetwork {
+private:
+    struct Node {
+        std::unique_ptr<Blockchain> chain;
+        std::unique_ptr<MiningEngine> miner;
+        std::unique_ptr<NetworkEngine> engine;
+        uint16_t port = 0;
+    };
+
+    SimulationConfig config;
+    std::vector<std::unique_ptr<Node>> nodes;   // The last one is the standby node
+    std::vector<std::unique_ptr<SimulatedLink>> links;
+    std::mt19937_64 rng;
+    uint64_t transactionCounter;
+
+    bool buildNodes();
+    bool startNode(size_t index);
+    size_t standby() const { return nodes.size() - 1; }
+    bool waitFor(const std::function<bool()>& done, std::chrono::milliseconds timeout) const;
+    bool waitForChains(size_t height, size_t count);
+
+public:
+    explicit SimulatedNetwork(const SimulationConfig& config);
+    ~SimulatedNetwork();
+
+    // Build and start the nodes and dial the random topology
+    bool start();
+    void stop();
+
+    // Connect node from to node to through a new link
+    bool connect(size_t from, size_t to);
+
+    // Mine a block on one node carrying fresh transactions already gossiped
+    // to the others; samples are how long each other node took to connect it
+    std::vector<double> propagateBlock(size_t miner, size_t transactions);
+
+    // Submit transactions on one node; samples are per transaction per node
+    std::vector<double> propagateTransactions(size_t origin, size_t count);
+
+    // Grow the chain by blocks, let the network catch up, then bring the
+    // standby node online and time its initial sync
+    SyncResult syncNewNode(size_t blocks, size_t transactionsPerBlock);
+
+    size_t size() const { return nodes.size() - 1; }
+    uint64_t getLinkBytes() const;
+};
+
+#endif // NETSIM_H
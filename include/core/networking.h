@@ -8,7 +8,9 @@
 #include <atomic>
 #include <mutex>
 #include <queue>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <chrono>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -16,6 +18,14 @@
 #include "blockchain.h"
 #include "mining.h"
 #include "json.hpp"
+#include "message_codec.h"
+#include "reactor.h"
+#include "sync.h"
+#include "compact_block.h"
+#include "relay.h"
+#include "peer_score.h"
+#include "dialer.h"
+#include "rate_limiter.h"
 
 // Network message types
 enum class MessageType {
@@ -34,7 +44,13 @@ enum class MessageType {
     MINING_REQUEST = 12,
     MINING_RESPONSE = 13,
     CONSENSUS_REQUEST = 14,
-    CONSENSUS_RESPONSE = 15
+    CONSENSUS_RESPONSE = 15,
+    GET_HEADERS = 16,
+    HEADERS = 17,
+    COMPACT_BLOCK = 18,
+    GET_BLOCK_TXN = 19,
+    BLOCK_TXN = 20,
+    INVENTORY = 21
 };
 
 // Network message structure
@@ -50,11 +66,38 @@ struct NetworkMessage {
     NetworkMessage() : type(MessageType::HANDSHAKE), timestamp(0), sequence(0) {}
     
     std::string serialize() const;
-    static NetworkMessage deserialize(const std::string& data);
+    static NetworkMessage deserialize(std::string_view data);
     std::string calculateHash() const;
     bool isValid() const;
 };
 
+// A message serialized once into an immutable buffer that any number of
+// connections can queue. Broadcasts hand the same buffer to every peer, so
+// a block costs one serialization whatever the peer count. The checksum is
+// computed up front and the deflated form on first use, then both are
+// shared as well.
+class SerializedMessage {
+private:
+    MessageType type;
+    std::shared_ptr<const std::string> payload;
+    uint32_t checksum;
+    mutable std::once_flag compressOnce;
+    mutable std::shared_ptr<const std::string> compressed;   // Null if deflating does not shrink it
+    mutable uint32_t compressedChecksum;
+    
+public:
+    explicit SerializedMessage(const NetworkMessage& message);
+    
+    MessageType getType() const { return type; }
+    const std::shared_ptr<const std::string>& getPayload() const { return payload; }
+    uint32_t getChecksum() const { return checksum; }
+    
+    // The deflated payload, produced by the first caller's compressor, or
+    // null if it is no smaller than the original
+    const std::shared_ptr<const std::string>& getCompressed(FrameCompressor& compressor) const;
+    uint32_t getCompressedChecksum() const { return compressedChecksum; }
+};
+
 // Peer node information
 struct PeerNode {
     std::string address;
@@ -88,10 +131,23 @@ struct NetworkConfig {
     uint64_t transactionBroadcastInterval = 5;
     bool enableUPnP = true;
     bool enableNATTraversal = true;
-    std::vector<std::string> seedNodes;
+    std::vector<std::string> seedNodes;        // DNS seeds, or "host:port" to dial directly
+    uint64_t targetOutbound = 8;               // Outbound peers the dialer keeps
+    uint64_t maxDialsInFlight = 16;            // Connects pending at once
+    uint64_t dialTimeoutMillis = 5000;
+    std::string addressBookPath = "peers.json";   // Known-good peers; empty to not persist
     uint64_t maxMessageSize = 1024 * 1024; // 1MB
     uint64_t maxBlockSize = 1024 * 1024; // 1MB
-    bool enableCompression = true;
+    bool enableCompression = true;            // Offer zlib payloads in the handshake
+    uint64_t compressionThreshold = 1024;     // Smaller payloads are sent as-is
+    int compressionLevel = 6;                 // zlib level, 1 (fast) to 9 (small)
+    bool enableCompactBlocks = true;          // Announce blocks as header + short IDs
+    bool enableZeroCopy = true;               // MSG_ZEROCOPY for large payloads
+    uint64_t zeroCopyThreshold = 64 * 1024;   // Payload size that is sent zero-copy
+    uint64_t sendBufferBytes = 8 * 1024 * 1024;   // Per-peer queue; announcements are shed past half
+    uint64_t slowPeerTimeout = 30;            // Seconds a peer may sit past half its send buffer
+    uint64_t maxUploadRate = 0;               // Bytes/sec across all peers, 0 for unlimited
+    uint64_t maxDownloadRate = 0;             // Bytes/sec across all peers, 0 for unlimited
     bool enableEncryption = false;
     std::string networkMagic = "NILOTIC";
     uint32_t protocolVersion = 1;
@@ -106,32 +162,115 @@ enum class ConnectionState {
     DISCONNECTING
 };
 
-// Network connection
-class NetworkConnection {
+// Global upload and download budgets shared by every connection. Only
+// touched on the reactor thread, so the buckets need no lock. Bytes are
+// charged after each transfer and a connection waits out any debt, so the
+// long-run rate holds whatever the frame sizes.
+struct BandwidthLimits {
+    bool limitUpload;
+    bool limitDownload;
+    TokenBucket upload;
+    TokenBucket download;
+    std::atomic<uint64_t> throttledWrites;
+    std::atomic<uint64_t> throttledReads;
+    
+    BandwidthLimits(uint64_t uploadRate, uint64_t downloadRate);
+};
+
+// Network connection. All socket I/O happens on the reactor thread: reads
+// are decoded into frames as they arrive, and queued messages are flushed
+// whenever the socket is writable. sendMessage() and disconnect() may be
+// called from any thread.
+class NetworkConnection : public std::enable_shared_from_this<NetworkConnection> {
+public:
+    // Receives each frame as a view of the connection's receive buffer; the
+    // payload is only valid for the duration of the call
+    using FrameHandler = std::function<void(NetworkConnection& connection, const FrameView& frame)>;
+    using CloseHandler = std::function<void(NetworkConnection& connection)>;
+    
 private:
+    Reactor& reactor;
     int socketFd;
     std::string remoteAddress;
     uint16_t remotePort;
-    ConnectionState state;
+    std::atomic<ConnectionState> state;
     std::atomic<bool> shouldClose;
-    std::thread readThread;
-    std::thread writeThread;
-    std::queue<NetworkMessage> sendQueue;
+    std::queue<std::shared_ptr<const SerializedMessage>> sendQueue;
     std::mutex queueMutex;
-    std::condition_variable queueCV;
+    std::atomic<bool> flushScheduled;
+    
+    // Backpressure. queuedBytes counts everything accepted by sendMessage()
+    // and not yet taken by the socket, in either queue. Past half of
+    // sendBufferLimit announcements are shed; past all of it the peer is
+    // dropped, so a stalled peer costs at most sendBufferLimit of memory.
+    size_t sendBufferLimit;
+    std::chrono::milliseconds slowPeerTimeout;
+    std::atomic<size_t> queuedBytes;
+    std::atomic<int64_t> congestedSince;   // steady_clock ticks, 0 while draining
+    
+    // Global rate limits, if any; a throttled direction resumes on a timer
+    std::shared_ptr<BandwidthLimits> bandwidth;
+    bool readPaused;
+    bool writePaused;
+    std::atomic<bool> overflowed;          // Dropped for a full send buffer
+    
+    // Framing
+    std::array<uint8_t, 4> magic;
+    FrameDecoder decoder;
+    FrameHandler frameHandler;
+    CloseHandler closeHandler;
+    
+    // A serialized frame waiting in the write chain. Header and payload are
+    // separate iovecs, so the payload is never copied into a send buffer.
+    struct OutboundFrame {
+        std::array<char, FrameHeader::SIZE> header;
+        std::shared_ptr<const std::string> payload;
+        size_t offset;   // Bytes of header + payload already written
+        size_t charged;  // Counted in queuedBytes until the frame is written
+        
+        size_t size() const { return FrameHeader::SIZE + payload->size(); }
+    };
+    
+    // Frames encoded but not yet accepted by the socket (reactor thread only)
+    std::deque<OutboundFrame> writeChain;
+    bool wantWrite;
+    bool wantRead;
+    
+    // MSG_ZEROCOPY state: payloads stay referenced until the kernel reports
+    // the send that used them complete
+    bool zeroCopy;
+    size_t zeroCopyThreshold;
+    uint32_t zeroCopySequence;
+    std::deque<std::pair<uint32_t, std::shared_ptr<const std::string>>> zeroCopyPending;
+    
+    // Payload compression. Outbound frames are deflated only once the peer
+    // has advertised support; inbound compressed frames are accepted if we
+    // offered it. Both streams are used on the reactor thread only.
+    FrameCompressor compressor;
+    std::atomic<bool> compressOutbound;
+    bool acceptCompressed;
+    size_t compressionThreshold;
+    size_t maxPayloadSize;
+    std::string inflated;   // Decompressed payload of the current frame
     
     // Connection statistics
-    uint64_t bytesReceived;
-    uint64_t bytesSent;
-    uint64_t messagesReceived;
-    uint64_t messagesSent;
+    std::atomic<uint64_t> bytesReceived;
+    std::atomic<uint64_t> bytesSent;
+    std::atomic<uint64_t> messagesReceived;
+    std::atomic<uint64_t> messagesSent;
+    std::atomic<uint64_t> writeSyscalls;
+    std::atomic<uint64_t> compressionSaved;
+    std::atomic<uint64_t> messagesShed;
+    std::chrono::steady_clock::time_point connectedAt;
     std::chrono::steady_clock::time_point lastActivity;
     
 public:
-    NetworkConnection(int fd, const std::string& address, uint16_t port);
+    NetworkConnection(Reactor& reactor, int fd, const std::string& address, uint16_t port,
+                      const NetworkConfig& config = NetworkConfig());
     ~NetworkConnection();
     
-    // Connection management
+    // Connection management. connect() registers the socket with the
+    // reactor; for outbound sockets the connection completes asynchronously.
     bool connect();
     void disconnect();
     bool isConnected() const { return state == ConnectionState::CONNECTED; }
@@ -139,14 +278,35 @@ public:
     
     // Message handling
     bool sendMessage(const NetworkMessage& message);
-    bool receiveMessage(NetworkMessage& message);
+    bool sendMessage(std::shared_ptr<const SerializedMessage> message);
     void processMessage(const NetworkMessage& message);
     
+    // Must be set before connect(). Without a frame handler, frames go to
+    // processMessage() on the reactor thread.
+    void setFrameHandler(FrameHandler handler) { frameHandler = std::move(handler); }
+    void setCloseHandler(CloseHandler handler) { closeHandler = std::move(handler); }
+    void setBandwidthLimits(std::shared_ptr<BandwidthLimits> limits) { bandwidth = std::move(limits); }
+    
+    // Backpressure: congested while over half the send buffer, too slow
+    // once it has stayed there for slowPeerTimeout
+    bool isCongested() const { return queuedBytes >= sendBufferLimit / 2; }
+    bool isTooSlow() const;
+    bool hasOverflowed() const { return overflowed; }
+    
+    // Called once the peer's handshake shows it can inflate our frames
+    void setCompression(bool enabled) { compressOutbound = enabled; }
+    bool isCompressing() const { return compressOutbound; }
+    
     // Statistics
     uint64_t getBytesReceived() const { return bytesReceived; }
     uint64_t getBytesSent() const { return bytesSent; }
     uint64_t getMessagesReceived() const { return messagesReceived; }
     uint64_t getMessagesSent() const { return messagesSent; }
+    uint64_t getWriteSyscalls() const { return writeSyscalls; }
+    uint64_t getCompressionSaved() const { return compressionSaved; }
+    uint64_t getMessagesShed() const { return messagesShed; }
+    size_t getQueuedBytes() const { return queuedBytes; }
+    std::chrono::steady_clock::time_point getConnectedAt() const { return connectedAt; }
     std::chrono::steady_clock::time_point getLastActivity() const { return lastActivity; }
     
     // Getters
@@ -155,10 +315,15 @@ public:
     std::string getFullAddress() const { return remoteAddress + ":" + std::to_string(remotePort); }
     
 private:
-    void readLoop();
-    void writeLoop();
-    bool sendData(const std::string& data);
-    bool receiveData(std::string& data);
+    void handleEvents(uint32_t events);
+    void handleReadable();
+    void flush();
+    void enableZeroCopy();
+    void drainZeroCopyCompletions();
+    void updateInterest();
+    void updateCongestion();
+    bool throttle(bool upload);
+    void closeNow();
     void updateActivity();
 };
 
@@ -169,36 +334,76 @@ private:
     MiningEngine& miningEngine;
     NetworkConfig config;
     
-    // Network state
+    // Network state. One reactor thread drives every socket and the periodic
+    // discovery, sync and ping timers; message handlers run on the workers,
+    // queued by priority lane so transaction floods cannot delay blocks.
     std::atomic<bool> isRunning;
-    std::thread listenerThread;
-    std::thread discoveryThread;
-    std::thread syncThread;
-    std::thread broadcastThread;
-    std::thread messageProcessingThread;
+    Reactor reactor;
+    WorkerPool workers;
+    std::vector<Reactor::TimerId> timers;
+    
+    // Global upload and download limits; null when both are unlimited
+    std::shared_ptr<BandwidthLimits> bandwidth;
     
     // Socket management
     int listenerSocket;
-    std::vector<std::unique_ptr<NetworkConnection>> connections;
-    std::mutex connectionsMutex;
+    std::vector<std::shared_ptr<NetworkConnection>> connections;
+    mutable std::mutex connectionsMutex;
     
     // Peer management
     std::map<std::string, PeerNode> peers;
     mutable std::mutex peersMutex;
     
-    // Message handling
+    // Message handling. Protocol messages that must be answered on the
+    // connection they arrived on are dispatched with their source peer.
+    using PeerMessageHandler = std::function<void(const std::shared_ptr<NetworkConnection>&, const NetworkMessage&)>;
     std::map<MessageType, std::function<void(const NetworkMessage&)>> messageHandlers;
-    std::queue<NetworkMessage> messageQueue;
-    mutable std::mutex messageMutex;
-    std::condition_variable messageCV;
+    std::map<MessageType, PeerMessageHandler> peerMessageHandlers;
+    
+    // Per-peer RTT, throughput and misbehaviour; orders downloads, relay
+    // and eviction
+    PeerScores scores;
+    
+    // Headers-first block download
+    SyncManager sync;
+    
+    // Compact blocks waiting on transactions from the peer that announced
+    // them, by block hash
+    struct PendingCompactBlock {
+        PartialBlock block;
+        std::string peer;
+        std::chrono::steady_clock::time_point receivedAt;
+        bool requestedAll;   // Second attempt after a short ID collision
+    };
+    std::map<std::string, PendingCompactBlock> pendingCompactBlocks;
+    std::mutex compactMutex;
+    
+    // Blocks forwarded before they were connected (cut-through), so peers
+    // can fetch their transactions while validation is still running.
+    // Guarded by compactMutex.
+    std::map<std::string, Block> relayedBlocks;
+    std::deque<std::string> relayedOrder;
+    
+    // Transaction gossip
+    TransactionRelay relay;
+    
+    // Outbound connections and the address book behind them
+    Dialer dialer;
     
     // Statistics
-    uint64_t totalMessagesReceived;
-    uint64_t totalMessagesSent;
-    uint64_t totalBytesReceived;
-    uint64_t totalBytesSent;
-    uint64_t activeConnections;
-    uint64_t totalPeers;
+    std::atomic<uint64_t> totalMessagesReceived;
+    std::atomic<uint64_t> totalMessagesSent;
+    std::atomic<uint64_t> totalBytesReceived;
+    std::atomic<uint64_t> totalBytesSent;
+    std::atomic<uint64_t> activeConnections;
+    std::atomic<uint64_t> totalPeers;
+    std::atomic<uint64_t> compactBlocksReceived;
+    std::atomic<uint64_t> compactBlocksFromMempool;
+    std::atomic<uint64_t> compactTransactionsRequested;
+    std::atomic<uint64_t> blocksCutThrough;
+    std::atomic<uint64_t> invalidBlockBodies;
+    std::atomic<uint64_t> slowPeersDropped;
+    std::atomic<uint64_t> sendBufferOverflows;
     
 public:
     NetworkEngine(Blockchain& blockchain, MiningEngine& miningEngine, const NetworkConfig& config = NetworkConfig());
@@ -208,24 +413,32 @@ public:
     bool start();
     void stop();
     bool isNetworkRunning() const { return isRunning.load(); }
+    const SyncManager& getSyncManager() const { return sync; }
+    const PeerScores& getPeerScores() const { return scores; }
     
     // Peer management
     bool addPeer(const std::string& address, uint16_t port);
     bool removePeer(const std::string& address);
+    
+    // Open an outbound connection; it completes on the reactor thread
+    bool connectToPeer(const std::string& address, uint16_t port);
+    const Dialer& getDialer() const { return dialer; }
     std::vector<PeerNode> getPeers() const;
     std::vector<PeerNode> getActivePeers() const;
     bool isPeerConnected(const std::string& address) const;
     
     // Message broadcasting
-    bool broadcastMessage(const NetworkMessage& message);
+    bool broadcastMessage(const NetworkMessage& message, const NetworkConnection* except = nullptr);
     bool sendMessageToPeer(const std::string& peerAddress, const NetworkMessage& message);
-    bool broadcastBlock(const Block& block);
+    bool broadcastBlock(const Block& block, const NetworkConnection* except = nullptr);
     bool broadcastTransaction(const Transaction& transaction);
     
     // Network discovery
     void discoverPeers();
     void pingPeers();
     void syncWithPeers();
+    void relayTransactions();
+    void dialPeers();
     
     // Configuration
     void updateConfig(const NetworkConfig& newConfig);
@@ -243,30 +456,39 @@ public:
     void unregisterMessageHandler(MessageType type);
     
 private:
-    void listenerLoop();
-    void discoveryLoop();
-    void syncLoop();
-    void broadcastLoop();
-    void messageProcessingLoop();
-    
     // Helper functions
     bool acceptConnection();
     void handleNewConnection(int clientSocket, const std::string& clientAddress, uint16_t clientPort);
-    void handleMessage(const NetworkMessage& message);
-    void processMessageQueue();
+    bool registerConnection(int socket, const std::string& address, uint16_t port);
+    void handleFrame(NetworkConnection& connection, const FrameView& frame);
+    void handleConnectionClosed(NetworkConnection& connection);
+    void handleMessage(const std::shared_ptr<NetworkConnection>& source, const NetworkMessage& message);
     bool validateMessage(const NetworkMessage& message);
     std::string generateNodeId();
+    std::vector<std::shared_ptr<NetworkConnection>> rankedConnections() const;
+    void penalize(const std::shared_ptr<NetworkConnection>& peer, double points, const std::string& reason);
     
     // Message handlers
-    void handleHandshake(const NetworkMessage& message);
-    void handlePing(const NetworkMessage& message);
-    void handlePong(const NetworkMessage& message);
-    void handleGetBlocks(const NetworkMessage& message);
-    void handleBlocks(const NetworkMessage& message);
-    void handleGetTransactions(const NetworkMessage& message);
-    void handleTransactions(const NetworkMessage& message);
-    void handleNewBlock(const NetworkMessage& message);
-    void handleNewTransaction(const NetworkMessage& message);
+    void sendHandshake(const std::shared_ptr<NetworkConnection>& peer);
+    void handleHandshake(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handlePing(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handlePong(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleGetHeaders(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleHeaders(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleGetBlocks(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleBlocks(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleCompactBlock(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleGetBlockTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleBlockTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void requestBlockTransactions(const std::shared_ptr<NetworkConnection>& peer, PartialBlock block,
+                                  const std::vector<size_t>& missing, bool requestedAll);
+    void completeCompactBlock(const std::shared_ptr<NetworkConnection>& peer, PartialBlock& block, bool requestedAll);
+    void relayAndConnect(const std::shared_ptr<NetworkConnection>& peer, const Block& block);
+    void handleInventory(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleGetTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleNewBlock(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleNewTransaction(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
     void handlePeerList(const NetworkMessage& message);
     void handleAddPeer(const NetworkMessage& message);
     void handleRemovePeer(const NetworkMessage& message);
@@ -313,7 +535,8 @@ public:
     
     // Compression utilities
     static std::string compressData(const std::string& data);
-    static std::string decompressData(const std::string& compressedData);
+    // Throws if the data is not a complete zlib stream or inflates past maxSize
+    static std::string decompressData(const std::string& compressedData, size_t maxSize = 1024 * 1024);
     
     // Protocol utilities
     static std::string createHandshakeMessage(const std::string& nodeId, uint32_t version);
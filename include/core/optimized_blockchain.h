@@ -14,15 +14,26 @@
 #include "block.h"
 #include "transaction.h"
 #include "smart_contract_vm.h"
+#include "rate_limiter.h"
 
 // Performance monitoring
 struct PerformanceMetrics {
     std::atomic<uint64_t> transactionsProcessed{0};
     std::atomic<uint64_t> blocksMined{0};
-    std::atomic<uint64_t> averageResponseTime{0};
+    std::atomic<uint64_t> averageResponseTime{0};   // Mean over all samples, in ms
+    std::atomic<uint64_t> totalResponseTime{0};
+    std::atomic<uint64_t> responseSamples{0};
     std::atomic<uint64_t> memoryUsage{0};
     std::atomic<uint64_t> cpuUsage{0};
     std::chrono::steady_clock::time_point lastUpdate;
+    
+    // True running mean; halving towards each new sample only tracked the
+    // last few requests
+    void recordResponseTime(uint64_t ms) {
+        uint64_t total = totalResponseTime.fetch_add(ms) + ms;
+        uint64_t samples = responseSamples.fetch_add(1) + 1;
+        averageResponseTime = total / samples;
+    }
 };
 
 // Optimized transaction pool
@@ -130,10 +141,8 @@ private:
     // Smart contract VM
     std::unique_ptr<SmartContractVM> vm;
     
-    // Rate limiting
-    std::unordered_map<std::string, std::chrono::steady_clock::time_point> rateLimitMap;
-    std::mutex rateLimitMutex;
-    const size_t maxRequestsPerMinute = 100;
+    // Per-sender token buckets, bounded so address spraying cannot grow memory
+    RateLimiter senderLimiter{1.0, 10.0};
 
 public:
     OptimizedBlockchain() {
@@ -169,7 +178,7 @@ public:
         // Update metrics
         auto end = std::chrono::steady_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        metrics.averageResponseTime = (metrics.averageResponseTime + duration.count()) / 2;
+        metrics.recordResponseTime(duration.count());
         
         return *newBlock;
     }
@@ -262,7 +271,7 @@ public:
             // Update metrics
             auto end = std::chrono::steady_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            metrics.averageResponseTime = (metrics.averageResponseTime + duration.count()) / 2;
+            metrics.recordResponseTime(duration.count());
             
             return context.stack.empty() ? std::any() : context.stack.back();
         } catch (const std::exception& e) {
@@ -363,22 +372,7 @@ private:
     }
 
     bool checkRateLimit(const std::string& address) {
-        std::lock_guard<std::mutex> lock(rateLimitMutex);
-        
-        auto now = std::chrono::steady_clock::now();
-        auto it = rateLimitMap.find(address);
-        
-        if (it != rateLimitMap.end()) {
-            auto timeSinceLastRequest = std::chrono::duration_cast<std::chrono::seconds>(
-                now - it->second).count();
-            
-            if (timeSinceLastRequest < 60) { // 1 minute window
-                return false;
-            }
-        }
-        
-        rateLimitMap[address] = now;
-        return true;
+        return senderLimiter.allow(address);
     }
 
     void updateMetrics() {
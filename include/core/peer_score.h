@@ -0,0 +1,122 @@
+#ifndef PEER_SCORE_H
+#define PEER_SCORE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "json.hpp"
+
+class NetworkConnection;
+
+struct PeerScoreConfig {
+    double smoothing = 0.3;                          // Weight of a new RTT or throughput sample
+    double referenceThroughput = 256 * 1024;         // Bytes/sec that earns half the throughput credit
+    std::chrono::milliseconds referenceRtt{100};     // RTT that earns half the latency credit
+    double stallPenalty = 10;                        // Per request that timed out
+    std::chrono::seconds stallHalfLife{600};         // Stall penalties fade; misbehaviour does not
+    double maxStallPoints = 40;                      // Dropped as too slow past this
+    double misbehaviourLimit = 100;                  // Dropped as hostile past this
+    std::chrono::seconds evictionGracePeriod{60};    // New peers are measured before they can be evicted
+    double evictionThreshold = 25;                   // Only peers scoring below this make room for a newcomer
+    std::chrono::seconds banDuration{3600};          // Hosts dropped as hostile are refused this long
+    std::chrono::seconds historyHalfLife{1800};      // Misbehaviour a host carried away fades at this rate
+    size_t maxHosts = 4096;                          // Host histories kept after disconnect
+};
+
+// Per-peer quality, measured continuously and folded into one score:
+//
+//   score = 50 * T / (T + referenceThroughput)     throughput credit
+//         + 50 * R / (R + rtt)                     latency credit, R = referenceRtt
+//         - stall points - misbehaviour points
+//
+// An unmeasured component counts as 25, so new peers rank mid-table and
+// get tried. Block download, relay order and eviction at maxPeers all
+// read the same score. Peers are keyed by "address:port" like the rest of
+// the networking code; everything here is thread-safe.
+//
+// Reconnecting from a new port must not wipe the slate, so on disconnect
+// misbehaviour and stall points are kept per host (the address alone,
+// loopback excepted) and a new connection from that host starts with
+// them. A host dropped as hostile is banned for banDuration.
+class PeerScores {
+private:
+    struct Metrics {
+        double rttMillis = 0;       // Smoothed; 0 until the first pong
+        double throughput = 0;      // Smoothed bytes/sec of requested data; 0 until measured
+        double stallPoints = 0;     // As of stallUpdated
+        double misbehaviour = 0;
+        uint64_t stalls = 0;
+        uint64_t invalid = 0;
+        uint64_t bytesDelivered = 0;
+        uint64_t pingNonce = 0;     // Outstanding ping, 0 if none
+        std::chrono::steady_clock::time_point pingSentAt;
+        std::chrono::steady_clock::time_point stallUpdated;
+        std::chrono::steady_clock::time_point connectedAt;
+    };
+
+    // What a host's connections left behind
+    struct HostHistory {
+        double misbehaviour = 0;    // As of updated
+        double stallPoints = 0;     // As of updated
+        std::chrono::steady_clock::time_point updated;
+        std::chrono::steady_clock::time_point bannedUntil;
+    };
+
+    PeerScoreConfig config;
+    std::map<std::string, Metrics> peers;
+    std::map<std::string, HostHistory> hosts;
+    uint64_t nextNonce;
+    mutable std::mutex scoreMutex;
+
+    Metrics& metricsFor(const std::string& peer);
+    double stallPointsAt(const Metrics& metrics, std::chrono::steady_clock::time_point now) const;
+    double scoreOf(const Metrics& metrics, std::chrono::steady_clock::time_point now) const;
+    bool droppable(const Metrics& metrics, std::chrono::steady_clock::time_point now) const;
+    double decay(double points, std::chrono::steady_clock::time_point since, std::chrono::seconds halfLife,
+                 std::chrono::steady_clock::time_point now) const;
+    void trimHosts(std::chrono::steady_clock::time_point now);
+    static std::string hostOf(const std::string& peer);
+
+public:
+    explicit PeerScores(const PeerScoreConfig& config = PeerScoreConfig());
+
+    void peerConnected(const std::string& peer);
+    void peerDisconnected(const std::string& peer);
+
+    // Returns the nonce to send in a PING; only a PONG echoing it counts
+    uint64_t pingSent(const std::string& peer);
+    bool pongReceived(const std::string& peer, uint64_t nonce);
+
+    // Bytes of requested data and how long the request took to answer
+    void recordDelivery(const std::string& peer, size_t bytes, double seconds);
+    void recordStall(const std::string& peer);
+
+    // Returns true once the peer has crossed misbehaviourLimit
+    bool recordInvalid(const std::string& peer, double points);
+
+    double score(const std::string& peer) const;
+    double getThroughput(const std::string& peer) const;
+    double getRtt(const std::string& peer) const;
+
+    // Too slow or misbehaving to keep
+    bool shouldDisconnect(const std::string& peer) const;
+
+    // Whether a host (address without port) is serving a ban, and until when
+    bool isBanned(const std::string& host) const;
+    std::chrono::steady_clock::time_point bannedUntil(const std::string& host) const;
+
+    // Order connections best first
+    void rank(std::vector<std::shared_ptr<NetworkConnection>>& connections) const;
+
+    // The lowest-scoring candidate past its grace period and below
+    // evictionThreshold, or empty if none
+    std::string selectEviction(const std::vector<std::string>& candidates) const;
+
+    nlohmann::json getStats() const;
+};
+
+#endif // PEER_SCORE_H
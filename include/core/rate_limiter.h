@@ -0,0 +1,91 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
+// Classic token bucket: holds up to `burst` tokens and refills at
+// `ratePerSecond`. Refill is lazy, computed from the elapsed time whenever
+// the bucket is touched, so idle buckets cost nothing. Not thread-safe.
+class TokenBucket {
+private:
+    double ratePerSecond;
+    double burst;
+    double tokens;
+    std::chrono::steady_clock::time_point lastRefill;
+
+    void refill(std::chrono::steady_clock::time_point now);
+
+public:
+    TokenBucket(double ratePerSecond, double burst,
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Take `cost` tokens if available
+    bool tryConsume(double cost = 1.0, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Take `cost` tokens whether or not they are there. The bucket goes into
+    // debt, which refill pays off first; for charging bytes after a
+    // transfer whose size was not known in advance.
+    void charge(double cost, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Seconds until `cost` tokens will be available (0 if they already are)
+    double secondsUntilAvailable(double cost = 1.0,
+                                 std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    void setRate(double ratePerSecond, double burst);
+    double getRate() const { return ratePerSecond; }
+    double getBurst() const { return burst; }
+};
+
+// Rate limiter with one token bucket per key (client IP, sender address).
+// Keys are spread over independently locked shards, and each shard keeps at
+// most maxKeys / shardCount buckets in LRU order. Spraying new keys only
+// evicts the least recently seen buckets, so memory stays constant.
+class RateLimiter {
+private:
+    struct Entry {
+        std::string key;
+        TokenBucket bucket;
+    };
+
+    struct Shard {
+        std::mutex shardMutex;
+        std::list<Entry> lru;   // Most recently used at the front
+        std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t maxKeysPerShard;
+    std::atomic<double> ratePerSecond;
+    std::atomic<double> burst;
+
+    // Statistics
+    std::atomic<uint64_t> allowed{0};
+    std::atomic<uint64_t> limited{0};
+    std::atomic<uint64_t> evicted{0};
+
+    Shard& shardFor(const std::string& key);
+
+public:
+    RateLimiter(double ratePerSecond, double burst, size_t maxKeys = 65536, size_t shardCount = 16);
+
+    // Charge `cost` tokens to the key. When refused, retryAfterSeconds (if
+    // given) is set to the time until the request would be allowed.
+    bool allow(const std::string& key, double cost = 1.0, double* retryAfterSeconds = nullptr);
+
+    // New rate applies to buckets created afterwards and to existing ones on their next use
+    void setRate(double ratePerSecond, double burst);
+
+    size_t size();
+    uint64_t getAllowed() const { return allowed; }
+    uint64_t getLimited() const { return limited; }
+    uint64_t getEvicted() const { return evicted; }
+};
+
+#endif // RATE_LIMITER_H
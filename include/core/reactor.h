@@ -0,0 +1,165 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <condition_variable>
+
+// Single-threaded epoll event loop. Sockets register a handler that runs on
+// the loop thread with the ready epoll events; other threads hand work to
+// the loop with post(). Timers are kept in a min-heap and bound the
+// epoll_wait timeout, so the loop sleeps until the next socket event or
+// deadline. Registration and post() are thread-safe.
+class Reactor {
+public:
+    using IoHandler = std::function<void(uint32_t events)>;
+    using Task = std::function<void()>;
+    using TimerId = uint64_t;
+
+private:
+    struct Registration {
+        uint32_t generation;
+        std::shared_ptr<IoHandler> handler;
+    };
+
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        TimerId id;
+        bool operator>(const Timer& other) const { return deadline > other.deadline; }
+    };
+
+    struct TimerEntry {
+        std::chrono::milliseconds interval;   // Zero for one-shot timers
+        Task task;
+    };
+
+    int epollFd;
+    int wakeFd;   // eventfd used to interrupt epoll_wait
+    std::atomic<bool> running;
+    std::thread loopThread;
+    std::atomic<std::thread::id> loopThreadId;
+
+    // fd -> handler; the generation in each epoll event tells a stale event
+    // for a closed fd apart from one for a new socket that reused the number
+    std::unordered_map<int, Registration> handlers;
+    uint32_t nextGeneration;
+    std::mutex handlersMutex;
+
+    std::deque<Task> posted;
+    std::mutex postedMutex;
+
+    std::vector<Timer> timerHeap;
+    std::unordered_map<TimerId, TimerEntry> timers;
+    TimerId nextTimerId;
+    std::mutex timersMutex;
+
+    void loop();
+    void wake();
+    int runDueTimers();   // Returns the epoll_wait timeout until the next timer
+    void runPosted();
+
+public:
+    Reactor();
+    ~Reactor();
+
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+    bool inLoopThread() const { return std::this_thread::get_id() == loopThreadId; }
+
+    // Watch fd for the given EPOLL* events; returns false if epoll refuses it
+    bool add(int fd, uint32_t events, IoHandler handler);
+    bool modify(int fd, uint32_t events);
+    void remove(int fd);
+
+    // Run task on the loop thread
+    void post(Task task);
+
+    TimerId runAfter(std::chrono::milliseconds delay, Task task);
+    TimerId runEvery(std::chrono::milliseconds interval, Task task);
+    void cancelTimer(TimerId id);
+};
+
+// Priority classes of pool work, most urgent first
+enum class Lane {
+    CONSENSUS = 0,      // Block relay and consensus messages
+    HEADERS = 1,        // Header sync and block download
+    TRANSACTIONS = 2,   // Transaction gossip
+    HOUSEKEEPING = 3    // Handshakes, pings, discovery
+};
+
+struct LaneStats {
+    size_t queued = 0;
+    uint64_t processed = 0;
+    uint64_t dropped = 0;           // Rejected because the lane was full
+    double meanWaitMillis = 0;      // Time from submit() to a worker picking it up
+    double maxWaitMillis = 0;
+};
+
+// Fixed set of threads running submitted tasks. Message handlers run here
+// so slow work never stalls the reactor.
+//
+// Each lane is a bounded FIFO. Workers take tasks by weighted round robin:
+// in every round a lane may run up to its weight in tasks, urgent lanes
+// first, and a new round starts once every backlogged lane has used its
+// share. A consensus task therefore waits behind at most one round of
+// other lanes' work however deep the transaction lane is, and no lane
+// starves.
+class WorkerPool {
+public:
+    static constexpr size_t LANE_COUNT = 4;
+
+private:
+    struct Task {
+        std::function<void()> run;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    struct LaneQueue {
+        std::deque<Task> tasks;
+        size_t capacity;
+        unsigned weight;
+        unsigned credits;
+        uint64_t processed = 0;
+        uint64_t dropped = 0;
+        double totalWaitMillis = 0;
+        double maxWaitMillis = 0;
+    };
+
+    std::vector<std::thread> workers;
+    std::array<LaneQueue, LANE_COUNT> lanes;
+    size_t pending;
+    mutable std::mutex tasksMutex;
+    std::condition_variable tasksCV;
+    bool stopping;
+
+    void workerLoop();
+    size_t pickLane();
+
+public:
+    WorkerPool();
+    ~WorkerPool();
+
+    // Lanes may be resized and reweighted at any time; weight is at least 1
+    void configureLane(Lane lane, size_t capacity, unsigned weight);
+
+    void start(size_t threadCount);
+    void stop();   // Finishes queued tasks, then joins
+
+    // Returns false, dropping the task, if its lane is full
+    bool submit(std::function<void()> task, Lane lane = Lane::HOUSEKEEPING);
+    size_t getThreadCount() const { return workers.size(); }
+    LaneStats getLaneStats(Lane lane) const;
+};
+
+#endif // REACTOR_H
@@ -0,0 +1,117 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include "transaction.h"
+#include "blockchain.h"
+#include "json.hpp"
+
+class NetworkConnection;
+struct NetworkMessage;
+enum class MessageType;
+
+struct RelayConfig {
+    std::chrono::milliseconds meanAnnounceInterval{5000};   // Poisson mean per peer
+    size_t maxAnnouncementsPerMessage = 1000;
+    size_t maxQueuedPerPeer = 20000;          // Announcements held for a congested peer
+    size_t maxKnownPerPeer = 50000;           // Hashes remembered per peer
+    size_t maxSeen = 100000;                  // Hashes we have handled
+    size_t maxRelayPool = 10000;              // Bodies kept to answer GET_TRANSACTIONS
+    std::chrono::milliseconds requestTimeout{10000};
+};
+
+// Inventory-based transaction gossip. New transactions are not pushed;
+// their hashes are queued per peer and announced in one INVENTORY message
+// at Poisson-distributed intervals, which batches announcements and makes
+// the first relayer harder to pinpoint. Peers request bodies they lack
+// with GET_TRANSACTIONS. Each peer's known inventory (what it announced or
+// was sent) is tracked so nothing is announced or sent twice, keeping
+// bandwidth proportional to unique transactions rather than peers.
+class TransactionRelay {
+private:
+    // Insertion-ordered set that forgets its oldest entries past a limit
+    struct RollingSet {
+        std::unordered_set<std::string> entries;
+        std::deque<std::string> order;
+
+        bool contains(const std::string& hash) const { return entries.count(hash) > 0; }
+        bool insert(const std::string& hash, size_t limit);
+    };
+
+    struct PeerState {
+        std::weak_ptr<NetworkConnection> connection;
+        RollingSet known;
+        std::vector<std::string> queued;   // Announced at the next flush
+        std::chrono::steady_clock::time_point nextFlush;
+    };
+
+    struct Request {
+        std::string peer;
+        std::chrono::steady_clock::time_point sentAt;
+    };
+
+    // Requests and announcements built under the lock, sent after it
+    using Outbox = std::vector<std::pair<std::shared_ptr<NetworkConnection>, NetworkMessage>>;
+
+    Blockchain& blockchain;
+    RelayConfig config;
+    std::string nodeId;
+
+    std::map<std::string, PeerState> peers;
+    RollingSet seen;
+    std::unordered_map<std::string, Transaction> relayPool;
+    std::deque<std::string> relayOrder;
+    std::unordered_map<std::string, Request> requested;
+    std::mt19937_64 rng;
+    mutable std::mutex relayMutex;
+
+    // Relay statistics
+    uint64_t transactionsRelayed;
+    uint64_t announcementsSent;
+    uint64_t announcementsReceived;
+    uint64_t announcementsDropped;
+    uint64_t transactionsRequested;
+    uint64_t transactionsServed;
+
+    NetworkMessage makeMessage(MessageType type, nlohmann::json data) const;
+    PeerState& peerFor(const std::shared_ptr<NetworkConnection>& connection);
+    std::chrono::steady_clock::time_point nextFlushTime(std::chrono::steady_clock::time_point now);
+    bool queueLocked(const Transaction& transaction, const std::string& source);
+    void send(Outbox& outbox);
+
+public:
+    TransactionRelay(Blockchain& blockchain, const RelayConfig& config = RelayConfig());
+
+    // Queue a transaction for announcement to every peer that has not seen
+    // it. Returns false if it was already relayed.
+    bool relay(const Transaction& transaction, const std::string& sourcePeer = "");
+
+    // Flush due announcements and expire lost requests. Called periodically
+    // with the connections best first; announcements go out in that order.
+    void tick(const std::vector<std::shared_ptr<NetworkConnection>>& connections);
+
+    void handleInventory(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleGetTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+
+    // Transactions sent by a peer, requested or pushed; accepted ones are
+    // added to the pool and relayed onward
+    void handleTransactions(const std::shared_ptr<NetworkConnection>& peer, const std::vector<Transaction>& transactions);
+
+    // Register a new connection so transactions relayed before the next
+    // tick are queued for it too
+    void peerConnected(const std::shared_ptr<NetworkConnection>& peer);
+    void peerDisconnected(const std::string& peer);
+    nlohmann::json getStats() const;
+};
+
+#endif // RELAY_H
@@ -0,0 +1,118 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "http_parser.h"
+
+// Log-linear latency histogram in the style of HdrHistogram. Values are
+// microseconds; each power of two is split into 8 linear sub-buckets, so a
+// recorded value is off by at most 12.5%. Recording is lock-free.
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 8;
+    static constexpr size_t BUCKET_COUNT = 2 * SUB_BUCKETS + 60 * SUB_BUCKETS;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts;
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sumMicros{0};
+
+    static size_t bucketIndex(uint64_t micros);
+
+public:
+    LatencyHistogram();
+
+    // Largest value that falls into a bucket
+    static uint64_t bucketUpperBound(size_t index);
+
+    void record(uint64_t micros);
+    uint64_t getCount() const { return total; }
+    uint64_t getSumMicros() const { return sumMicros; }
+
+    // Value at the given quantile (0.0 - 1.0), as a bucket upper bound
+    uint64_t percentile(double quantile) const;
+
+    // Number of samples no larger than the given value
+    uint64_t countAtOrBelow(uint64_t micros) const;
+};
+
+// Counters kept for every route
+struct RouteStats {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> errors{0};      // Responses with status >= 400
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};
+    LatencyHistogram latency;
+};
+
+// Per-request state handed to route handlers. Handlers that write to the
+// socket themselves (streams) return an empty string and fill in status
+// and bytesSent.
+struct RouteContext {
+    const HttpRequestView& request;
+    std::vector<std::string_view> params;   // Values of {name} segments, in order
+    int clientFd;
+    bool keepAlive;
+    std::string& output;    // Per-connection scratch buffer for response bodies
+    int status = 0;
+    size_t bytesSent = 0;
+
+    RouteContext(const HttpRequestView& request, int clientFd, bool keepAlive, std::string& output)
+        : request(request), clientFd(clientFd), keepAlive(keepAlive), output(output) {}
+};
+
+// Request router built once at startup. Static paths are looked up in a hash
+// map; paths with {name} segments are matched through a segment trie.
+// Every route records request counts, errors, bytes and latency.
+class Router {
+public:
+    using Handler = std::function<std::string(RouteContext&)>;
+
+private:
+    struct Route {
+        std::string method;    // "*" matches any method
+        std::string pattern;
+        Handler handler;
+        RouteStats stats;
+    };
+
+    struct TrieNode {
+        std::unordered_map<std::string, std::unique_ptr<TrieNode>> children;
+        std::unique_ptr<TrieNode> param;
+        std::unordered_map<std::string, Route*> routes;   // Keyed by method
+    };
+
+    std::vector<std::unique_ptr<Route>> routes;
+    std::unordered_map<std::string, Route*> staticRoutes;   // "METHOD /path"
+    TrieNode root;
+    Route notFound;
+
+    Route* matchTrie(const TrieNode& node, std::string_view method, std::string_view path,
+                     std::vector<std::string_view>& params) const;
+    Route* match(std::string_view method, std::string_view path, std::vector<std::string_view>& params) const;
+    static void recordResult(Route& route, RouteContext& context, const std::string& response,
+                             uint64_t micros);
+
+public:
+    Router();
+
+    // Register a handler. Patterns are literal paths or contain {name}
+    // segments, e.g. "/block/{index}". Must not be called while serving.
+    void addRoute(const std::string& method, const std::string& pattern, Handler handler);
+    void setNotFoundHandler(Handler handler);
+
+    // Route the request, time the handler and record its outcome
+    std::string dispatch(RouteContext& context);
+
+    // Per-route statistics in Prometheus text exposition format
+    std::string renderMetrics() const;
+};
+
+#endif // ROUTER_H
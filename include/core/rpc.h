@@ -0,0 +1,52 @@
+#ifndef RPC_H
+#define RPC_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "blockchain.h"
+#include "block_cache.h"
+#include "json.hpp"
+
+// JSON-RPC 2.0 over POST /rpc.
+//
+// A request body is either one call object or a batch array. All calls in a
+// body run against a single consistent chain snapshot; large batches are
+// split across worker threads. Results that are already serialized (cached
+// blocks) are spliced into the response without being re-parsed.
+class JsonRpcServer {
+private:
+    Blockchain& blockchain;
+    BlockResponseCache& blockCache;
+    size_t maxBatchSize;
+
+    // Outcome of one call: raw JSON for the result, or an error
+    struct CallResult {
+        bool isNotification = false;
+        bool ok = false;
+        std::string result;         // Serialized JSON value
+        int errorCode = 0;
+        std::string errorMessage;
+        nlohmann::json id;
+    };
+
+    void execute(const nlohmann::json& call, const ChainView& view, CallResult& out);
+    std::string blockResult(const ChainView& view, uint64_t index);
+    static std::string serializeResult(const CallResult& result);
+
+public:
+    // Standard error codes
+    static const int PARSE_ERROR = -32700;
+    static const int INVALID_REQUEST = -32600;
+    static const int METHOD_NOT_FOUND = -32601;
+    static const int INVALID_PARAMS = -32602;
+    static const int INTERNAL_ERROR = -32603;
+
+    JsonRpcServer(Blockchain& blockchain, BlockResponseCache& blockCache, size_t maxBatchSize = 1000);
+
+    // Handle a request body. Returns the response body, or an empty string
+    // when every call was a notification and nothing should be sent.
+    std::string handle(std::string_view body);
+};
+
+#endif // RPC_H
@@ -0,0 +1,140 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "block.h"
+#include "blockchain.h"
+#include "peer_score.h"
+#include "json.hpp"
+
+class NetworkConnection;
+struct NetworkMessage;
+enum class MessageType;
+
+// The hashed fields of a block, without its transactions. Enough to check
+// proof of work and chain linkage before any body is downloaded.
+struct BlockHeader {
+    uint64_t index = 0;
+    std::string previousHash;
+    time_t timestamp = 0;
+    std::string merkleRoot;
+    uint64_t nonce = 0;
+    std::string validator;
+    std::string hash;
+
+    static BlockHeader fromBlock(const Block& block);
+    nlohmann::json toJson() const;
+    static BlockHeader fromJson(const nlohmann::json& json);
+
+    // Same preimage as Block::calculateHash()
+    std::string calculateHash() const;
+    bool checkProofOfWork(uint64_t difficulty) const;
+};
+
+struct SyncConfig {
+    size_t maxHeadersPerMessage = 2000;
+    size_t windowSize = 16;                  // Blocks per GET_BLOCKS request
+    size_t maxWindowsPerPeer = 8;            // In-flight requests for the fastest peer
+    size_t maxBlocksAhead = 1024;            // Download horizon past the chain tip
+    size_t maxResponseBytes = 1000 * 1000;   // Keep BLOCKS under maxMessageSize
+    std::chrono::milliseconds stallTimeout{5000};
+    std::chrono::milliseconds headerPollInterval{10000};   // Re-ask idle peers for new headers
+};
+
+// Headers-first initial block download.
+//
+// Headers are fetched and checked for linkage and proof of work first.
+// Bodies for the validated header chain are then requested in fixed
+// windows from every peer that has them: faster peers (by measured
+// bytes/sec) get more windows in flight, windows go to the best-scoring
+// peer with a free slot, and a window that is not answered within
+// stallTimeout goes to another peer. Throughput and stalls are recorded
+// in the shared PeerScores. Bodies may arrive in any order;
+// they are buffered and connected to the chain strictly by height.
+//
+// All entry points are thread-safe; message handlers run on the network
+// worker pool.
+class SyncManager {
+private:
+    struct PeerState {
+        std::weak_ptr<NetworkConnection> connection;
+        uint64_t bestHeight = 0;        // Tip height the peer last reported
+        size_t windowsInFlight = 0;
+        bool headersInFlight = false;
+        std::chrono::steady_clock::time_point headersRequestedAt;
+    };
+
+    struct Window {
+        size_t count;
+        std::string peer;   // Empty while unassigned
+        std::chrono::steady_clock::time_point requestedAt;
+        std::string lastPeer;   // Peer that stalled on it, skipped on retry
+    };
+
+    // Requests built under the lock and sent after it is released
+    using Outbox = std::vector<std::pair<std::shared_ptr<NetworkConnection>, NetworkMessage>>;
+
+    Blockchain& blockchain;
+    PeerScores& scores;
+    SyncConfig config;
+    std::string nodeId;
+
+    // Validated headers above the local chain tip, by height
+    std::map<uint64_t, BlockHeader> headers;
+
+    // Body download: windows by start height, and bodies waiting for their
+    // parent to connect
+    std::map<uint64_t, Window> windows;
+    uint64_t nextWindowHeight;
+    std::map<uint64_t, Block> downloaded;
+
+    std::map<std::string, PeerState> peers;
+    mutable std::mutex syncMutex;
+
+    // Held while connecting so blocks reach the chain in height order
+    std::mutex connectMutex;
+
+    // Sync statistics
+    uint64_t blocksConnected;
+    uint64_t blocksRejected;
+    uint64_t windowsReassigned;
+
+    NetworkMessage makeMessage(MessageType type, nlohmann::json data) const;
+    void send(Outbox& outbox);
+    bool findHeader(uint64_t height, BlockHeader& out) const;
+    PeerState& peerFor(const std::shared_ptr<NetworkConnection>& connection);
+    void planWindows();
+    void assignWindows(Outbox& outbox);
+    void releaseWindows(const std::string& peer);
+    void discardFrom(uint64_t height);
+    void connectReady();
+
+public:
+    SyncManager(Blockchain& blockchain, PeerScores& scores, const SyncConfig& config = SyncConfig());
+
+    // Ask each peer for headers past our best header, retry stalled windows
+    // and top up body requests. Called periodically.
+    void tick(const std::vector<std::shared_ptr<NetworkConnection>>& connections);
+
+    // Requests from peers
+    void handleGetHeaders(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleGetBlocks(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+
+    // Responses to our requests
+    void handleHeaders(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+    void handleBlocks(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message);
+
+    void peerDisconnected(const std::string& peer);
+
+    uint64_t getHeaderHeight() const;
+    bool isSyncing() const;
+    nlohmann::json getStats() const;
+};
+
+#endif // SYNC_H
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <vector>
 #include "json.hpp"
+#include "json_writer.h"
 #include "utils.h"
 #include "transaction_types.h"
 
@@ -134,26 +135,34 @@ public:
         return std::string(buffer);
     }
     
-    // Serialize to JSON
-    std::string serialize() const {
-        nlohmann::json j;
-        j["sender"] = sender;
-        j["recipient"] = recipient;
-        j["amount"] = amount;
-        j["timestamp"] = timestamp;
-        j["hash"] = hash;
-        j["signature"] = signature;
-        j["isOffline"] = isOffline;
+    // Write as a JSON object; keys in sorted order, matching nlohmann output
+    void writeJson(JsonWriter& json) const {
+        json.beginObject();
+        json.key("amount").value(amount);
         
         // Smart contract fields
         if (!contractCode.empty()) {
-            j["contractCode"] = contractCode;
+            json.key("contractCode").value(contractCode);
         }
         if (!contractState.empty()) {
-            j["contractState"] = contractState;
+            json.key("contractState").value(contractState);
         }
         
-        return j.dump(4);
+        json.key("hash").hex(hash);
+        json.key("isOffline").value(isOffline);
+        json.key("recipient").value(recipient);
+        json.key("sender").value(sender);
+        json.key("signature").hex(signature);
+        json.key("timestamp").value(timestamp);
+        json.endObject();
+    }
+    
+    // Serialize to JSON
+    std::string serialize() const {
+        std::string out;
+        JsonWriter json(out, 4);
+        writeJson(json);
+        return out;
     }
     
     // Deserialize from JSON
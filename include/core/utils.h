@@ -13,6 +13,7 @@
 #include <openssl/sha.h>
 #include "json.hpp"
 #include "transaction_types.h"
+#include "http_parser.h"
 
 class Utils {
 public:
@@ -202,69 +203,25 @@ public:
                                std::string& uri, 
                                std::map<std::string, std::string>& headers,
                                std::string& body) {
-        std::istringstream iss(request);
-        std::string line;
-        
-        // Parse request line
-        std::getline(iss, line);
-        std::istringstream request_line(line);
-        request_line >> method >> uri;
-        
-        // Parse headers
+        method.clear();
+        uri.clear();
         headers.clear();
-        bool headers_done = false;
-        while (std::getline(iss, line)) {
-            // Check for \r at the end of line and remove it
-            if (!line.empty() && line.back() == '\r') {
-                line.pop_back();
-            }
-            
-            // An empty line marks the end of headers and start of body
-            if (line.empty()) {
-                headers_done = true;
-                break;
-            }
-            
-            auto colon_pos = line.find(':');
-            if (colon_pos != std::string::npos) {
-                std::string header_name = line.substr(0, colon_pos);
-                std::string header_value = line.substr(colon_pos + 1);
-                
-                // Trim leading whitespace from header value
-                header_value.erase(0, header_value.find_first_not_of(" \t"));
-                
-                headers[header_name] = header_value;
-            }
+        body.clear();
+        
+        // The parser decodes chunked bodies in place, so it works on a copy
+        std::string buffer(request);
+        HttpRequestParser parser;
+        if (parser.parse(buffer.data(), buffer.size()) != HttpParseStatus::COMPLETE) {
+            return;
         }
         
-        // Parse body (if any)
-        body.clear();
-        if (headers_done) {
-            // Read the rest of the input as the body
-            std::string body_line;
-            while (std::getline(iss, body_line)) {
-                if (body.empty()) {
-                    body = body_line;
-                } else {
-                    body += "\n" + body_line;
-                }
-            }
-            
-            // If we have Content-Length, use it to extract the exact body
-            if (headers.find("Content-Length") != headers.end()) {
-                // Content-Length was found, ensure we read exactly that many bytes
-                size_t content_length = std::stoul(headers["Content-Length"]);
-                
-                // If we need more data, read it directly from the original request
-                size_t header_end = request.find("\r\n\r\n");
-                if (header_end != std::string::npos) {
-                    header_end += 4; // Move past the \r\n\r\n
-                    if (header_end + content_length <= request.size()) {
-                        body = request.substr(header_end, content_length);
-                    }
-                }
-            }
+        const HttpRequestView& view = parser.request();
+        method.assign(view.method);
+        uri.assign(view.target);
+        for (const auto& header : view.headers) {
+            headers[std::string(header.name)] = std::string(header.value);
         }
+        body.assign(view.body);
     }
     
     // Create standard HTTP response
@@ -281,7 +238,11 @@ public:
             case 401: status_text = "Unauthorized"; break;
             case 403: status_text = "Forbidden"; break;
             case 404: status_text = "Not Found"; break;
+            case 413: status_text = "Payload Too Large"; break;
+            case 431: status_text = "Request Header Fields Too Large"; break;
             case 500: status_text = "Internal Server Error"; break;
+            case 501: status_text = "Not Implemented"; break;
+            case 505: status_text = "HTTP Version Not Supported"; break;
             default: status_text = "Unknown"; break;
         }
         
@@ -298,7 +259,7 @@ public:
     
     // Create standard JSON HTTP response
     static std::string createJsonResponse(int status_code, const nlohmann::json& data) {
-        return createHttpResponse(status_code, "application/json", data.dump(4));
+        return createHttpResponse(status_code, "application/json", data.dump());
     }
     
     // Create error JSON response
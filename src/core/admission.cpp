@@ -0,0 +1,233 @@
+#include "admission.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+// AdmissionController::Permit implementation
+AdmissionController::Permit::Permit(Permit&& other) noexcept
+    : controller(other.controller), admittedAt(other.admittedAt) {
+    other.controller = nullptr;
+}
+
+AdmissionController::Permit& AdmissionController::Permit::operator=(Permit&& other) noexcept {
+    if (this != &other) {
+        if (controller) {
+            controller->release(admittedAt);
+        }
+        controller = other.controller;
+        admittedAt = other.admittedAt;
+        other.controller = nullptr;
+    }
+    return *this;
+}
+
+AdmissionController::Permit::~Permit() {
+    if (controller) {
+        controller->release(admittedAt);
+    }
+}
+
+// AdmissionController implementation
+AdmissionController::AdmissionController(size_t maxInFlight, size_t maxConnections, size_t reservedConnections)
+    : maxInFlight(std::max<size_t>(1, maxInFlight)), inFlight(0), maxConnections(maxConnections),
+      reservedConnections(std::min(reservedConnections, maxConnections)) {
+    // Consensus traffic may queue longest; reads are shed first
+    classes[static_cast<size_t>(RequestPriority::CONSENSUS)].limits = {256, std::chrono::milliseconds(5000)};
+    classes[static_cast<size_t>(RequestPriority::TRANSACTION)].limits = {128, std::chrono::milliseconds(1000)};
+    classes[static_cast<size_t>(RequestPriority::READ)].limits = {64, std::chrono::milliseconds(250)};
+}
+
+const char* AdmissionController::priorityName(RequestPriority priority) {
+    switch (priority) {
+        case RequestPriority::CONSENSUS: return "consensus";
+        case RequestPriority::TRANSACTION: return "transaction";
+        case RequestPriority::READ: return "read";
+    }
+    return "unknown";
+}
+
+AdmissionController::Permit AdmissionController::acquire(RequestPriority priority, double* retryAfterSeconds) {
+    ClassState& state = classes[static_cast<size_t>(priority)];
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(admissionMutex);
+
+    // Fast path: a free slot and nobody waiting ahead of us
+    bool anyWaiting = false;
+    for (const auto& other : classes) {
+        anyWaiting = anyWaiting || !other.waiters.empty();
+    }
+    if (inFlight < maxInFlight && !anyWaiting) {
+        inFlight++;
+        state.admitted.fetch_add(1, std::memory_order_relaxed);
+        state.queueTime.record(0);
+        return Permit(this, start);
+    }
+
+    auto shed = [&](std::atomic<uint64_t>& counter) {
+        counter.fetch_add(1, std::memory_order_relaxed);
+        if (retryAfterSeconds) {
+            // Time for the current backlog to drain at the observed service rate
+            size_t backlog = 0;
+            for (const auto& other : classes) {
+                backlog += other.waiters.size();
+            }
+            *retryAfterSeconds = (backlog + 1) * averageServiceSeconds.load() / maxInFlight;
+        }
+        return Permit();
+    };
+
+    if (state.waiters.size() >= state.limits.maxQueued) {
+        return shed(state.shedQueueFull);
+    }
+
+    Waiter waiter;
+    state.waiters.push_back(&waiter);
+    bool granted = waiter.cv.wait_for(lock, state.limits.maxWait, [&waiter] { return waiter.granted; });
+    auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    if (!granted) {
+        state.waiters.erase(std::find(state.waiters.begin(), state.waiters.end(), &waiter));
+        return shed(state.shedTimeout);
+    }
+
+    // release() handed its slot straight to us, so inFlight is unchanged
+    state.admitted.fetch_add(1, std::memory_order_relaxed);
+    state.queueTime.record(static_cast<uint64_t>(waited));
+    return Permit(this, std::chrono::steady_clock::now());
+}
+
+void AdmissionController::release(std::chrono::steady_clock::time_point admittedAt) {
+    double held = std::chrono::duration<double>(std::chrono::steady_clock::now() - admittedAt).count();
+    averageServiceSeconds.store(averageServiceSeconds.load() * 0.9 + held * 0.1);
+
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    if (inFlight <= maxInFlight) {
+        for (auto& state : classes) {
+            if (!state.waiters.empty()) {
+                Waiter* next = state.waiters.front();
+                state.waiters.pop_front();
+                next->granted = true;
+                next->cv.notify_one();
+                return;
+            }
+        }
+    }
+    inFlight--;
+}
+
+ConnectionSlot AdmissionController::tryOpenConnection() {
+    if (connections.fetch_add(1) < maxConnections - reservedConnections) {
+        return ConnectionSlot::GENERAL;
+    }
+    connections.fetch_sub(1);
+    if (reservedInUse.fetch_add(1) < reservedConnections) {
+        return ConnectionSlot::RESERVED;
+    }
+    reservedInUse.fetch_sub(1);
+    connectionsShed.fetch_add(1, std::memory_order_relaxed);
+    return ConnectionSlot::REFUSED;
+}
+
+void AdmissionController::closeConnection(ConnectionSlot slot) {
+    if (slot == ConnectionSlot::GENERAL) {
+        connections.fetch_sub(1);
+    } else if (slot == ConnectionSlot::RESERVED) {
+        reservedInUse.fetch_sub(1);
+    }
+}
+
+void AdmissionController::setMaxInFlight(size_t limit) {
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    maxInFlight = std::max<size_t>(1, limit);
+
+    // Wake waiters for any slots the new limit opened up
+    for (auto& state : classes) {
+        while (inFlight < maxInFlight && !state.waiters.empty()) {
+            Waiter* next = state.waiters.front();
+            state.waiters.pop_front();
+            next->granted = true;
+            next->cv.notify_one();
+            inFlight++;
+        }
+    }
+}
+
+void AdmissionController::setClassLimits(RequestPriority priority, AdmissionClassLimits limits) {
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    classes[static_cast<size_t>(priority)].limits = limits;
+}
+
+size_t AdmissionController::getInFlight() const {
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    return inFlight;
+}
+
+size_t AdmissionController::getQueued(RequestPriority priority) const {
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    return classes[static_cast<size_t>(priority)].waiters.size();
+}
+
+uint64_t AdmissionController::getShed(RequestPriority priority) const {
+    const ClassState& state = classes[static_cast<size_t>(priority)];
+    return state.shedQueueFull + state.shedTimeout;
+}
+
+std::string AdmissionController::renderMetrics() const {
+    // Bucket bounds exported to Prometheus, in seconds
+    static const double BOUNDS[] = {0.0001, 0.0005, 0.001, 0.005, 0.01, 0.025, 0.05,
+                                    0.1, 0.25, 0.5, 1, 2.5, 5};
+    static const RequestPriority PRIORITIES[] = {RequestPriority::CONSENSUS, RequestPriority::TRANSACTION,
+                                                 RequestPriority::READ};
+
+    std::ostringstream out;
+    out << "# HELP nilotic_admission_in_flight Requests currently holding a handler slot.\n";
+    out << "# TYPE nilotic_admission_in_flight gauge\n";
+    out << "nilotic_admission_in_flight " << getInFlight() << "\n";
+
+    out << "# HELP nilotic_admission_queued Requests waiting for a handler slot, by priority.\n";
+    out << "# TYPE nilotic_admission_queued gauge\n";
+    for (RequestPriority priority : PRIORITIES) {
+        out << "nilotic_admission_queued{priority=\"" << priorityName(priority) << "\"} "
+            << getQueued(priority) << "\n";
+    }
+
+    out << "# HELP nilotic_admission_admitted_total Requests admitted, by priority.\n";
+    out << "# TYPE nilotic_admission_admitted_total counter\n";
+    for (RequestPriority priority : PRIORITIES) {
+        out << "nilotic_admission_admitted_total{priority=\"" << priorityName(priority) << "\"} "
+            << classes[static_cast<size_t>(priority)].admitted << "\n";
+    }
+
+    out << "# HELP nilotic_admission_shed_total Requests refused with 503, by priority and reason.\n";
+    out << "# TYPE nilotic_admission_shed_total counter\n";
+    for (RequestPriority priority : PRIORITIES) {
+        const ClassState& state = classes[static_cast<size_t>(priority)];
+        out << "nilotic_admission_shed_total{priority=\"" << priorityName(priority)
+            << "\",reason=\"queue_full\"} " << state.shedQueueFull << "\n";
+        out << "nilotic_admission_shed_total{priority=\"" << priorityName(priority)
+            << "\",reason=\"timeout\"} " << state.shedTimeout << "\n";
+    }
+    out << "nilotic_admission_shed_total{priority=\"connection\",reason=\"connection_limit\"} "
+        << connectionsShed << "\n";
+
+    out << "# HELP nilotic_admission_queue_seconds Time admitted requests spent waiting for a slot.\n";
+    out << "# TYPE nilotic_admission_queue_seconds histogram\n";
+    char value[32];
+    for (RequestPriority priority : PRIORITIES) {
+        const LatencyHistogram& queueTime = classes[static_cast<size_t>(priority)].queueTime;
+        std::string label = std::string("priority=\"") + priorityName(priority) + "\"";
+        for (double bound : BOUNDS) {
+            snprintf(value, sizeof(value), "%g", bound);
+            out << "nilotic_admission_queue_seconds_bucket{" << label << ",le=\"" << value << "\"} "
+                << queueTime.countAtOrBelow(static_cast<uint64_t>(bound * 1e6)) << "\n";
+        }
+        out << "nilotic_admission_queue_seconds_bucket{" << label << ",le=\"+Inf\"} "
+            << queueTime.getCount() << "\n";
+        snprintf(value, sizeof(value), "%.6f", queueTime.getSumMicros() / 1e6);
+        out << "nilotic_admission_queue_seconds_sum{" << label << "} " << value << "\n";
+        out << "nilotic_admission_queue_seconds_count{" << label << "} " << queueTime.getCount() << "\n";
+    }
+    return out.str();
+}
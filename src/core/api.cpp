@@ -4,21 +4,59 @@
 #include "wallet.h"
 #include "mining.h"
 #include "networking.h"
+#include "http_parser.h"
+#include "compression.h"
+#include "json_writer.h"
 #include <thread>
 #include <mutex>
 #include <sstream>
 #include <map>
+#include <cmath>
+#include <algorithm>
 #include <unistd.h>
+#include <cerrno>
 #include <sys/select.h>
 #include <arpa/inet.h>
 #include "json.hpp"
 
 // Constructor
-API::API(Blockchain& blockchain) : blockchain(blockchain), miningEngine(blockchain), running(false), server_fd(-1) {}
+API::API(Blockchain& blockchain)
+    : blockchain(blockchain), miningEngine(blockchain), miningJobs(miningEngine, blockchain),
+      running(false), server_fd(-1),
+      rpc(blockchain, blockCache), ipLimiter(50.0, 100.0), senderLimiter(1.0, 10.0),
+      admission(std::max(4u, std::thread::hardware_concurrency() * 2)) {
+    // Serialize each block once, when it is connected, and reuse the same
+    // bytes for the cache and the event stream
+    ChainListener listener;
+    listener.onBlockConnected = [this](const Block& block) {
+        auto entry = blockCache.put(block);
+        events.publish("tip", entry->body);
+    };
+    listener.onTransactionAdded = [this](const Transaction& tx) {
+        std::string data;
+        JsonWriter json(data);
+        tx.writeJson(json);
+        events.publish("transaction", data);
+    };
+    listener.onChainReset = [this](size_t newHeight) {
+        blockCache.clear();
+        nlohmann::json reorg;
+        reorg["height"] = newHeight;
+        events.publish("reorg", reorg.dump());
+    };
+    blockListenerId = blockchain.addListener(std::move(listener));
+    
+    miningJobs.setCompletionCallback([this](const MiningJobInfo& job) {
+        events.publish("job", job.toJson().dump());
+    });
+    
+    registerRoutes();
+}
 
 // Destructor
 API::~API() {
     stop();
+    blockchain.removeListener(blockListenerId);
 }
 
 // Start the API server
@@ -65,6 +103,7 @@ void API::start(int port) {
     }
     
     running = true;
+    miningJobs.start();
     Utils::logInfo("API server started successfully on port " + std::to_string(port));
     
     // Start server thread
@@ -78,6 +117,8 @@ void API::stop() {
     if (!running) return;
     
     running = false;
+    miningJobs.stop();
+    events.closeAll();
     
     if (server_fd >= 0) {
         close(server_fd);
@@ -91,6 +132,16 @@ void API::stop() {
     Utils::logInfo("API server stopped");
 }
 
+// Adjust rate limits; existing buckets pick up the new rate on their next request
+void API::setRateLimits(double ipRate, double ipBurst, double senderRate, double senderBurst) {
+    ipLimiter.setRate(ipRate, ipBurst);
+    senderLimiter.setRate(senderRate, senderBurst);
+}
+
+void API::setMaxInFlight(size_t maxInFlight) {
+    admission.setMaxInFlight(maxInFlight);
+}
+
 // Server main loop
 void API::serverLoop() {
     while (running) {
@@ -126,377 +177,1053 @@ void API::serverLoop() {
             continue;
         }
         
+        // Past the connection limit, answer 503 here instead of starting another thread
+        ConnectionSlot slot = admission.tryOpenConnection();
+        if (slot == ConnectionSlot::REFUSED) {
+            std::string response = buildOverloadedResponse(1.0, false);
+            send(client_fd, response.data(), response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            close(client_fd);
+            continue;
+        }
+        
         // Handle client in a separate thread
-        std::thread([this, client_fd, client_addr]() {
-            this->handleClient(client_fd, client_addr);
+        std::thread([this, client_fd, client_addr, slot]() {
+            this->handleClient(client_fd, client_addr, slot);
+            admission.closeConnection(slot);
         }).detach();
     }
 }
 
-// Handle individual client connection
-void API::handleClient(int client_fd, struct sockaddr_in client_addr) {
-    char buffer[4096];
-    int bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
+// Admission class for a request: consensus traffic first, explorer reads last.
+// Long-lived event streams and the metrics scrape bypass admission entirely.
+static bool classifyRequest(const HttpRequestView& request, RequestPriority& priority) {
+    const std::string_view path = request.path;
+    auto startsWith = [&path](std::string_view prefix) {
+        return path.compare(0, prefix.size(), prefix) == 0;
+    };
     
-    if (bytes_read <= 0) {
-        close(client_fd);
-        return;
+    if (request.method == "OPTIONS" || path == "/events" || path == "/metrics") {
+        return false;
+    }
+    if (request.method == "POST" || request.method == "DELETE") {
+        if (startsWith("/mine") || startsWith("/mining") || startsWith("/jobs") ||
+            startsWith("/network") || startsWith("/block")) {
+            priority = RequestPriority::CONSENSUS;
+            return true;
+        }
+        if (path == "/transaction" || path == "/token" || path == "/wallet/sign") {
+            priority = RequestPriority::TRANSACTION;
+            return true;
+        }
+    }
+    priority = RequestPriority::READ;
+    return true;
+}
+
+// Send the whole buffer, retrying on partial writes
+static bool sendAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
     }
+    return true;
+}
+
+// Buffers streamed output and writes it as HTTP/1.1 chunks once the buffer
+// passes a threshold, so memory per response stays bounded. Without chunking
+// (HTTP/1.0 clients) the bytes are written raw and the connection closes.
+class ChunkedStreamWriter {
+private:
+    int fd;
+    bool chunked;
+    bool failed;
+    std::string buffer;
+    size_t flushThreshold;
+    size_t written;
     
-    buffer[bytes_read] = '\0';
-    std::string request(buffer);
+public:
+    ChunkedStreamWriter(int fd, bool chunked, size_t flushThreshold = 64 * 1024)
+        : fd(fd), chunked(chunked), failed(false), flushThreshold(flushThreshold), written(0) {
+        buffer.reserve(flushThreshold + 4096);
+    }
     
-    // Parse HTTP request
-    std::string method, path, body;
-    std::map<std::string, std::string> headers;
-    Utils::parseHttpRequest(request, method, path, headers, body);
+    bool ok() const { return !failed; }
+    size_t bytesWritten() const { return written; }
     
-    // Log request
-    Utils::logInfo("Request: " + method + " " + path + " from " + 
-                   inet_ntoa(client_addr.sin_addr) + ":" + std::to_string(ntohs(client_addr.sin_port)));
-    Utils::logInfo("Parsed path: '" + path + "'");
+    void write(const std::string& data) {
+        buffer += data;
+        if (buffer.size() >= flushThreshold) {
+            flush();
+        }
+    }
     
-    // Generate response
-    std::string response = generateResponse(method, path, body);
+    void write(char c) {
+        buffer += c;
+    }
     
-    // Send response
-    ssize_t bytes_sent = send(client_fd, response.c_str(), response.length(), 0);
-    if (bytes_sent < 0) {
-        Utils::logError("Failed to send response");
-    } else {
-        Utils::logInfo("Response sent successfully: " + std::to_string(bytes_sent) + " bytes");
+    void flush() {
+        if (failed || buffer.empty()) {
+            return;
+        }
+        if (chunked) {
+            char header[32];
+            int headerLength = snprintf(header, sizeof(header), "%zx\r\n", buffer.size());
+            buffer += "\r\n";
+            failed = !sendAll(fd, header, headerLength) || !sendAll(fd, buffer.data(), buffer.size());
+            written += headerLength;
+        } else {
+            failed = !sendAll(fd, buffer.data(), buffer.size());
+        }
+        written += buffer.size();
+        buffer.clear();
     }
-    close(client_fd);
-}
+    
+    // Flush and terminate the chunked body
+    bool finish() {
+        flush();
+        if (chunked && !failed) {
+            failed = !sendAll(fd, "0\r\n\r\n", 5);
+            written += 5;
+        }
+        return !failed;
+    }
+};
 
-// Generate HTTP response
-std::string API::generateResponse(const std::string& method, const std::string& path, const std::string& body) {
-    nlohmann::json response;
-    std::string status = "200 OK";
+// Handle individual client connection
+void API::handleClient(int client_fd, struct sockaddr_in client_addr, ConnectionSlot slot) {
+    // Idle keep-alive connections are closed after the receive timeout
+    struct timeval recv_timeout;
+    recv_timeout.tv_sec = 5;
+    recv_timeout.tv_usec = 0;
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout));
     
-    try {
-        if (method == "OPTIONS") {
-            // Handle CORS preflight requests
-            response["status"] = "ok";
-            status = "200 OK";
-        }
-        else if (path == "/") {
-            // Root endpoint
-            response["status"] = "Nilotic Blockchain API is running";
-            response["version"] = "1.0.0";
-            response["chain_height"] = blockchain.getChainHeight();
-            response["pending_transactions"] = blockchain.getPendingTransactions().size();
-            response["difficulty"] = blockchain.getDifficulty();
-            response["mining_reward"] = blockchain.getMiningReward();
-            response["success"] = true;
-        }
-        else if (path == "/info") {
-            // Blockchain info
-            response["chainId"] = "nilotic-chain-1";
-            response["chainHeight"] = blockchain.getChainHeight();
-            response["blockCount"] = blockchain.getChain().size();
-            response["isValid"] = true; // TODO: implement validation
-            response["pendingTransactions"] = blockchain.getPendingTransactions().size();
-            response["difficulty"] = blockchain.getDifficulty();
-            response["miningReward"] = blockchain.getMiningReward();
-            response["status"] = "success";
+    char ipBuffer[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &client_addr.sin_addr, ipBuffer, sizeof(ipBuffer));
+    const std::string clientIp(ipBuffer);
+    
+    HttpConnectionBuffer buffer;
+    std::string output;   // Reused for every response body on this connection
+    HttpRequestParser parser;
+    bool keepAlive = true;
+    bool continueSent = false;
+    
+    while (running && keepAlive) {
+        HttpParseStatus status = parser.parse(buffer.data(), buffer.size());
+        
+        if (status == HttpParseStatus::INCOMPLETE) {
+            // Large uploads from curl and friends wait for an interim 100 response
+            if (parser.headersComplete() && parser.expectsContinue() && !continueSent) {
+                static const char continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                sendAll(client_fd, continueResponse, sizeof(continueResponse) - 1);
+                continueSent = true;
+            }
+            if (buffer.fill(client_fd) <= 0) {
+                break;
+            }
+            continue;
         }
-        else if (path.substr(0, 9) == "/balance/") {
-            // Get wallet balance
-            std::string address = path.substr(9);
-            double balance = blockchain.getBalance(address);
-            double stake = 0.0; // TODO: implement staking
-            
-            response["address"] = address;
-            response["balance"] = balance;
-            response["stake"] = stake;
+        
+        if (status == HttpParseStatus::ERROR) {
+            nlohmann::json error;
+            error["error"] = parser.getErrorMessage();
+            std::string response = Utils::createJsonResponse(parser.getErrorStatus(), error);
+            sendAll(client_fd, response.data(), response.size());
+            break;
         }
-        else if (path == "/block/latest") {
-            // Get latest block
-            try {
-                Block latestBlock = blockchain.getLatestBlock();
-                response = nlohmann::json::parse(latestBlock.serialize());
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
-                status = "400 Bad Request";
+        
+        const HttpRequestView& request = parser.request();
+        keepAlive = request.keepAlive;
+        
+        Utils::logInfo("Request: " + std::string(request.method) + " " + std::string(request.target) + " from " + 
+                       clientIp + ":" + std::to_string(ntohs(client_addr.sin_port)));
+        
+        // Per-IP limit is checked before any routing or body parsing
+        double retryAfter = 0.0;
+        if (!ipLimiter.allow(clientIp, 1.0, &retryAfter)) {
+            std::string response = buildRateLimitedResponse(retryAfter, keepAlive);
+            if (!sendAll(client_fd, response.data(), response.size())) {
+                break;
             }
+            buffer.consume(parser.consumed());
+            parser.reset();
+            continueSent = false;
+            continue;
         }
-        else if (path.substr(0, 7) == "/block/") {
-            // Get block by index
-            try {
-                std::string index_str = path.substr(7);
-                int index = std::stoi(index_str);
-                
-                const auto& chain = blockchain.getChain();
-                if (index < 0 || static_cast<size_t>(index) >= chain.size()) {
-                    response["error"] = "Block index out of range";
-                    status = "400 Bad Request";
-                } else {
-                    response = nlohmann::json::parse(chain[index].serialize());
+        
+        // A connection on a reserved slot may only carry consensus requests;
+        // anything else is shed and the slot freed for the next one
+        RequestPriority priority;
+        bool admitted = classifyRequest(request, priority);
+        if (slot == ConnectionSlot::RESERVED && (!admitted || priority != RequestPriority::CONSENSUS)) {
+            admission.recordConnectionShed();
+            std::string response = buildOverloadedResponse(1.0, false);
+            sendAll(client_fd, response.data(), response.size());
+            break;
+        }
+        
+        // Wait for a handler slot; under overload the request is shed with 503
+        AdmissionController::Permit permit;
+        if (admitted) {
+            permit = admission.acquire(priority, &retryAfter);
+            if (!permit.granted()) {
+                std::string response = buildOverloadedResponse(retryAfter, keepAlive);
+                if (!sendAll(client_fd, response.data(), response.size())) {
+                    break;
                 }
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
-                status = "400 Bad Request";
+                buffer.consume(parser.consumed());
+                parser.reset();
+                continueSent = false;
+                continue;
             }
         }
-        else if (path == "/transaction" && method == "POST") {
-            // Create transaction
-            try {
-                nlohmann::json tx_data = nlohmann::json::parse(body);
-                std::string sender = tx_data["sender"];
-                std::string recipient = tx_data["recipient"];
-                double amount = tx_data["amount"];
-                std::string type = tx_data.value("type", "transfer");
-                
-                Transaction tx(sender, recipient, amount);
-                
-                if (blockchain.addTransaction(tx)) {
-                    response["status"] = "success";
-                    response["message"] = "Transaction added to pending pool";
-                    response["transaction_id"] = tx.calculateHash();
-                } else {
-                    response["error"] = "Failed to add transaction";
-                    status = "400 Bad Request";
-                }
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
-                status = "400 Bad Request";
+        
+        // Route and send the response; pipelined requests are answered in order.
+        // Streaming endpoints have already written their output.
+        RouteContext ctx(request, client_fd, keepAlive, output);
+        std::string response = routeRequest(ctx);
+        keepAlive = ctx.keepAlive;
+        permit = AdmissionController::Permit();
+        if (!response.empty() && !sendAll(client_fd, response.data(), response.size())) {
+            Utils::logError("Failed to send response");
+            break;
+        }
+        
+        buffer.consume(parser.consumed());
+        parser.reset();
+        continueSent = false;
+    }
+    
+    close(client_fd);
+}
+
+// Build the route table once; handlers are looked up per request by the router
+void API::registerRoutes() {
+    // Hot read endpoints write their JSON straight into the connection's
+    // output buffer. Keys must stay in sorted order to match nlohmann.
+    addRoute("*", "/", [this](RouteContext& ctx) {
+        // Root endpoint
+        ctx.output.clear();
+        JsonWriter json(ctx.output);
+        json.beginObject();
+        json.key("chain_height").value(blockchain.getChainHeight());
+        json.key("difficulty").value(blockchain.getDifficulty());
+        json.key("mining_reward").value(blockchain.getMiningReward());
+        json.key("pending_transactions").value(blockchain.getPendingTransactionCount());
+        json.key("status").value("Nilotic Blockchain API is running");
+        json.key("success").value(true);
+        json.key("version").value("1.0.0");
+        json.endObject();
+        return buildEncodedResponse(ctx.request, "200 OK", ctx.output, ctx.keepAlive);
+    });
+    
+    addRoute("*", "/info", [this](RouteContext& ctx) {
+        // Blockchain info
+        ctx.output.clear();
+        JsonWriter json(ctx.output);
+        json.beginObject();
+        json.key("blockCount").value(blockchain.getChainHeight());
+        json.key("chainHeight").value(blockchain.getChainHeight());
+        json.key("chainId").value("nilotic-chain-1");
+        json.key("difficulty").value(blockchain.getDifficulty());
+        json.key("isValid").value(true); // TODO: implement validation
+        json.key("miningReward").value(blockchain.getMiningReward());
+        json.key("pendingTransactions").value(blockchain.getPendingTransactionCount());
+        json.key("status").value("success");
+        json.endObject();
+        return buildEncodedResponse(ctx.request, "200 OK", ctx.output, ctx.keepAlive);
+    });
+    
+    addRoute("*", "/balance/{address}", [this](RouteContext& ctx) {
+        // Get wallet balance
+        std::string address(ctx.params[0]);
+        double balance = blockchain.getBalance(address);
+        double stake = 0.0; // TODO: implement staking
+        
+        ctx.output.clear();
+        JsonWriter json(ctx.output);
+        json.beginObject();
+        json.key("address").value(address);
+        json.key("balance").value(balance);
+        json.key("stake").value(stake);
+        json.endObject();
+        return buildEncodedResponse(ctx.request, "200 OK", ctx.output, ctx.keepAlive);
+    });
+    
+    addRoute("*", "/block/latest", [this](RouteContext& ctx) {
+        // Get latest block
+        size_t height = blockchain.getChainHeight();
+        auto entry = height > 0 ? getBlockResponse(height - 1) : nullptr;
+        if (entry) {
+            // The tip can change, so clients must revalidate
+            return buildBlockResponse(*entry, ctx.request, ctx.keepAlive, false);
+        }
+        nlohmann::json error;
+        error["error"] = "Chain is empty";
+        return buildHttpResponse("400 Bad Request", error.dump(), ctx.keepAlive);
+    });
+    
+    addRoute("*", "/block/{index}", [this](RouteContext& ctx) {
+        // Get block by index
+        nlohmann::json error;
+        try {
+            long long index = std::stoll(std::string(ctx.params[0]));
+            
+            auto entry = index >= 0 ? getBlockResponse(static_cast<uint64_t>(index)) : nullptr;
+            if (entry) {
+                // Blocks near the tip can still be replaced by a reorg, so
+                // only those buried past the confirmation depth are cached
+                // as immutable; the rest revalidate with their ETag
+                static const uint64_t IMMUTABLE_DEPTH = 6;
+                uint64_t height = blockchain.getChainHeight();
+                bool immutable = static_cast<uint64_t>(index) + IMMUTABLE_DEPTH < height;
+                return buildBlockResponse(*entry, ctx.request, ctx.keepAlive, immutable);
             }
+            error["error"] = "Block index out of range";
+        } catch (const std::exception& e) {
+            error["error"] = e.what();
         }
-        else if (path == "/mine" && method == "POST") {
-            // Mine a new block
-            try {
-                nlohmann::json mine_data = nlohmann::json::parse(body);
-                std::string miner_address = mine_data["miner_address"];
-                
-                // Mine a block using the mining engine
-                Block minedBlock = miningEngine.mineBlock(miner_address);
-                
-                if (minedBlock.getIndex() >= 0 && !minedBlock.getHash().empty()) { // Valid block mined
-                    // Add the block to the blockchain
-                    if (blockchain.addBlock(minedBlock)) {
-                        response["status"] = "success";
-                        response["message"] = "Block mined successfully";
-                        response["block_index"] = minedBlock.getIndex();
-                        response["block_hash"] = minedBlock.getHash();
-                        response["miner_address"] = miner_address;
-                        response["difficulty"] = miningEngine.getCurrentDifficulty();
-                        response["reward"] = miningEngine.calculateBlockReward(minedBlock.getIndex());
-                    } else {
-                        response["status"] = "error";
-                        response["message"] = "Failed to add block to blockchain";
-                        status = "400 Bad Request";
-                    }
-                } else {
-                    response["status"] = "error";
-                    response["message"] = "Failed to mine block";
-                    status = "400 Bad Request";
-                }
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
+        return buildHttpResponse("400 Bad Request", error.dump(), ctx.keepAlive);
+    });
+    
+    addRoute("GET", "/chain", [this](RouteContext& ctx) {
+        return buildChainResponse(ctx.request, ctx.keepAlive);
+    });
+    
+    addJsonRoute("POST", "/transaction", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Create transaction
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json tx_data = nlohmann::json::parse(body);
+            std::string sender = tx_data["sender"];
+            std::string recipient = tx_data["recipient"];
+            double amount = tx_data["amount"];
+            std::string type = tx_data.value("type", "transfer");
+            
+            double retryAfter = 0.0;
+            if (!senderLimiter.allow(sender, 1.0, &retryAfter)) {
+                response["error"] = "Too many transactions from sender";
+                response["retry_after"] = std::max(1, static_cast<int>(std::ceil(retryAfter)));
+                status = "429 Too Many Requests";
+                return;
+            }
+            
+            Transaction tx(sender, recipient, amount);
+            
+            if (blockchain.addTransaction(tx)) {
+                response["status"] = "success";
+                response["message"] = "Transaction added to pending pool";
+                response["transaction_id"] = tx.calculateHash();
+            } else {
+                response["error"] = "Failed to add transaction";
                 status = "400 Bad Request";
             }
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
         }
-        else if (path == "/mining/status" && method == "GET") {
-            // Get mining status
-            response["status"] = "success";
-            response["isMining"] = miningEngine.isMiningActive();
-            response["currentDifficulty"] = miningEngine.getCurrentDifficulty();
-            response["hashRate"] = miningEngine.getCurrentHashRate();
-            response["estimatedTimeToNextBlock"] = miningEngine.getEstimatedTimeToNextBlock();
-            response["pendingTransactions"] = blockchain.getPendingTransactions().size();
-            response["miningStats"] = miningEngine.getMiningStats().toJson();
-        }
-        else if (path == "/mining/start" && method == "POST") {
-            // Start mining
-            try {
-                nlohmann::json start_data = nlohmann::json::parse(body);
-                std::string miner_address = start_data["miner_address"];
-                
-                if (miningEngine.startMining(miner_address)) {
-                    response["status"] = "success";
-                    response["message"] = "Mining started successfully";
-                    response["miner_address"] = miner_address;
-                    response["difficulty"] = miningEngine.getCurrentDifficulty();
-                } else {
-                    response["status"] = "error";
-                    response["message"] = "Failed to start mining";
-                    status = "400 Bad Request";
-                }
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
-                status = "400 Bad Request";
+    });
+    
+    addJsonRoute("POST", "/mine", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Queue a mining job; the client polls /jobs/{id} or listens for "job" events
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json mine_data = nlohmann::json::parse(body);
+            std::string miner_address = mine_data["miner_address"];
+            
+            std::string job_id;
+            if (miningJobs.submit(miner_address, job_id)) {
+                response["status"] = "success";
+                response["message"] = "Mining job queued";
+                response["job_id"] = job_id;
+                response["state"] = "queued";
+                response["status_url"] = "/jobs/" + job_id;
+                status = "202 Accepted";
+            } else {
+                response["status"] = "error";
+                response["message"] = "Mining queue is full";
+                status = "503 Service Unavailable";
             }
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
         }
-        else if (path == "/mining/stop" && method == "POST") {
-            // Stop mining
-            miningEngine.stopMining();
-            response["status"] = "success";
-            response["message"] = "Mining stopped successfully";
-            response["isMining"] = miningEngine.isMiningActive();
+    });
+    
+    addJsonRoute("GET", "/jobs/{id}", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Get the state of a mining job
+        MiningJobInfo job;
+        if (!miningJobs.getJob(std::string(ctx.params[0]), job)) {
+            response["error"] = "Job not found";
+            status = "404 Not Found";
+            return;
         }
-        else if (path == "/network/status" && method == "GET") {
-            // Get network status
-            response["status"] = "success";
-            response["isRunning"] = false; // TODO: get from network engine
-            response["activeConnections"] = 0;
-            response["totalPeers"] = 0;
-            response["totalMessagesReceived"] = 0;
-            response["totalMessagesSent"] = 0;
-            response["listenPort"] = 8333;
-        }
-        else if (path == "/network/peers" && method == "GET") {
-            // Get peer list
+        response = job.toJson();
+        response["status"] = "success";
+    });
+    
+    addJsonRoute("DELETE", "/jobs/{id}", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Cancel a queued or running mining job
+        std::string job_id(ctx.params[0]);
+        MiningJobInfo job;
+        if (!miningJobs.getJob(job_id, job)) {
+            response["error"] = "Job not found";
+            status = "404 Not Found";
+        } else if (!miningJobs.cancel(job_id)) {
+            response["error"] = "Job already finished";
+            response["state"] = MiningJobInfo::stateName(job.state);
+            status = "409 Conflict";
+        } else {
             response["status"] = "success";
-            response["peers"] = nlohmann::json::array();
-            // TODO: get actual peers from network engine
+            response["message"] = "Cancellation requested";
+            response["job_id"] = job_id;
         }
-        else if (path == "/network/connect" && method == "POST") {
-            // Connect to peer
-            try {
-                nlohmann::json connect_data = nlohmann::json::parse(body);
-                std::string address = connect_data["address"];
-                uint16_t port = connect_data["port"];
-                
-                // TODO: connect to peer using network engine
+    });
+    
+    addJsonRoute("GET", "/mining/status", [this](RouteContext&, nlohmann::json& response, std::string&) {
+        // Get mining status
+        response["status"] = "success";
+        response["isMining"] = miningEngine.isMiningActive();
+        response["currentDifficulty"] = miningEngine.getCurrentDifficulty();
+        response["hashRate"] = miningEngine.getCurrentHashRate();
+        response["estimatedTimeToNextBlock"] = miningEngine.getEstimatedTimeToNextBlock();
+        response["pendingTransactions"] = blockchain.getPendingTransactionCount();
+        response["miningStats"] = miningEngine.getMiningStats().toJson();
+    });
+    
+    addJsonRoute("POST", "/mining/start", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Start mining
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json start_data = nlohmann::json::parse(body);
+            std::string miner_address = start_data["miner_address"];
+            
+            if (miningEngine.startMining(miner_address)) {
                 response["status"] = "success";
-                response["message"] = "Connection request sent";
-                response["address"] = address;
-                response["port"] = port;
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
+                response["message"] = "Mining started successfully";
+                response["miner_address"] = miner_address;
+                response["difficulty"] = miningEngine.getCurrentDifficulty();
+            } else {
+                response["status"] = "error";
+                response["message"] = "Failed to start mining";
                 status = "400 Bad Request";
             }
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
         }
-        else if (path == "/network/disconnect" && method == "POST") {
-            // Disconnect from peer
-            try {
-                nlohmann::json disconnect_data = nlohmann::json::parse(body);
-                std::string address = disconnect_data["address"];
-                
-                // TODO: disconnect from peer using network engine
-                response["status"] = "success";
-                response["message"] = "Disconnection request sent";
-                response["address"] = address;
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
-                status = "400 Bad Request";
-            }
+    });
+    
+    addJsonRoute("POST", "/mining/stop", [this](RouteContext&, nlohmann::json& response, std::string&) {
+        // Stop mining
+        miningEngine.stopMining();
+        response["status"] = "success";
+        response["message"] = "Mining stopped successfully";
+        response["isMining"] = miningEngine.isMiningActive();
+    });
+    
+    addJsonRoute("GET", "/network/status", [this](RouteContext&, nlohmann::json& response, std::string&) {
+        // Get network status
+        response["status"] = "success";
+        response["isRunning"] = false; // TODO: get from network engine
+        response["activeConnections"] = 0;
+        response["totalPeers"] = 0;
+        response["totalMessagesReceived"] = 0;
+        response["totalMessagesSent"] = 0;
+        response["listenPort"] = 8333;
+    });
+    
+    addJsonRoute("GET", "/network/peers", [this](RouteContext&, nlohmann::json& response, std::string&) {
+        // Get peer list
+        response["status"] = "success";
+        response["peers"] = nlohmann::json::array();
+        // TODO: get actual peers from network engine
+    });
+    
+    addJsonRoute("POST", "/network/connect", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Connect to peer
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json connect_data = nlohmann::json::parse(body);
+            std::string address = connect_data["address"];
+            uint16_t port = connect_data["port"];
+            
+            // TODO: connect to peer using network engine
+            response["status"] = "success";
+            response["message"] = "Connection request sent";
+            response["address"] = address;
+            response["port"] = port;
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
         }
-        else if (path == "/token" && method == "POST") {
-            // Create token
-            try {
-                nlohmann::json token_data = nlohmann::json::parse(body);
-                std::string tokenId = token_data["token_id"];
-                double amount = token_data["amount"];
-                std::string creator = token_data["creator"];
-                
-                OderoSLW token(tokenId, amount, creator);
-                
+    });
+    
+    addJsonRoute("POST", "/network/disconnect", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Disconnect from peer
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json disconnect_data = nlohmann::json::parse(body);
+            std::string address = disconnect_data["address"];
+            
+            // TODO: disconnect from peer using network engine
+            response["status"] = "success";
+            response["message"] = "Disconnection request sent";
+            response["address"] = address;
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
+        }
+    });
+    
+    addJsonRoute("POST", "/token", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Create token
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json token_data = nlohmann::json::parse(body);
+            std::string tokenId = token_data["token_id"];
+            double amount = token_data["amount"];
+            std::string creator = token_data["creator"];
+            
+            OderoSLW token(tokenId, amount, creator);
+            
+            response["status"] = "success";
+            response["message"] = "Token created successfully";
+            response["token_id"] = tokenId;
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
+        }
+    });
+    
+    addJsonRoute("POST", "/wallet/create", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Create new wallet
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json wallet_data = nlohmann::json::parse(body);
+            std::string name = wallet_data["name"];
+            std::string password = wallet_data["password"];
+            
+            Wallet wallet(name);
+            if (wallet.createNewWallet(password)) {
                 response["status"] = "success";
-                response["message"] = "Token created successfully";
-                response["token_id"] = tokenId;
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
+                response["message"] = "Wallet created successfully";
+                response["address"] = wallet.getAddress();
+                response["name"] = wallet.getName();
+                response["seedPhrase"] = wallet.toMnemonic(password);
+            } else {
+                response["error"] = "Failed to create wallet";
                 status = "400 Bad Request";
             }
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
         }
-        else if (path == "/wallet/create" && method == "POST") {
-            // Create new wallet
-            try {
-                nlohmann::json wallet_data = nlohmann::json::parse(body);
-                std::string name = wallet_data["name"];
-                std::string password = wallet_data["password"];
-                
-                Wallet wallet(name);
-                if (wallet.createNewWallet(password)) {
-                    response["status"] = "success";
-                    response["message"] = "Wallet created successfully";
-                    response["address"] = wallet.getAddress();
-                    response["name"] = wallet.getName();
-                    response["seedPhrase"] = wallet.toMnemonic(password);
-                } else {
-                    response["error"] = "Failed to create wallet";
-                    status = "400 Bad Request";
-                }
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
+    });
+    
+    addJsonRoute("POST", "/wallet/import", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Import wallet
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json wallet_data = nlohmann::json::parse(body);
+            std::string name = wallet_data["name"];
+            std::string password = wallet_data["password"];
+            
+            // Create a new wallet with the name (this will generate the same address)
+            Wallet wallet(name);
+            
+            // Create the wallet with the password
+            if (wallet.createNewWallet(password)) {
+                response["status"] = "success";
+                response["message"] = "Wallet imported successfully";
+                response["address"] = wallet.getAddress();
+                response["name"] = name; // Use the provided name instead of getName()
+            } else {
+                response["error"] = "Failed to import wallet";
                 status = "400 Bad Request";
             }
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
         }
-        else if (path == "/wallet/import" && method == "POST") {
-            // Import wallet
-            try {
-                nlohmann::json wallet_data = nlohmann::json::parse(body);
-                std::string name = wallet_data["name"];
-                std::string password = wallet_data["password"];
-                
-                // Create a new wallet with the name (this will generate the same address)
-                Wallet wallet(name);
-                
-                // Create the wallet with the password
-                if (wallet.createNewWallet(password)) {
+    });
+    
+    addJsonRoute("POST", "/wallet/sign", [this](RouteContext& ctx, nlohmann::json& response, std::string& status) {
+        // Sign transaction
+        const std::string_view body = ctx.request.body;
+        try {
+            nlohmann::json sign_data = nlohmann::json::parse(body);
+            std::string privateKeyPEM = sign_data["private_key"];
+            std::string password = sign_data["password"];
+            std::string transactionData = sign_data["transaction_data"];
+            
+            Wallet wallet(privateKeyPEM, password);
+            if (wallet.isValid()) {
+                std::string signature = wallet.signTransaction(transactionData);
+                if (!signature.empty()) {
                     response["status"] = "success";
-                    response["message"] = "Wallet imported successfully";
+                    response["message"] = "Transaction signed successfully";
+                    response["signature"] = signature;
                     response["address"] = wallet.getAddress();
-                    response["name"] = name; // Use the provided name instead of getName()
                 } else {
-                    response["error"] = "Failed to import wallet";
+                    response["error"] = "Failed to sign transaction";
                     status = "400 Bad Request";
                 }
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
+            } else {
+                response["error"] = "Invalid wallet";
                 status = "400 Bad Request";
             }
+        } catch (const std::exception& e) {
+            response["error"] = e.what();
+            status = "400 Bad Request";
         }
-        else if (path == "/wallet/sign" && method == "POST") {
-            // Sign transaction
-            try {
-                nlohmann::json sign_data = nlohmann::json::parse(body);
-                std::string privateKeyPEM = sign_data["private_key"];
-                std::string password = sign_data["password"];
-                std::string transactionData = sign_data["transaction_data"];
-                
-                Wallet wallet(privateKeyPEM, password);
-                if (wallet.isValid()) {
-                    std::string signature = wallet.signTransaction(transactionData);
-                    if (!signature.empty()) {
-                        response["status"] = "success";
-                        response["message"] = "Transaction signed successfully";
-                        response["signature"] = signature;
-                        response["address"] = wallet.getAddress();
-                    } else {
-                        response["error"] = "Failed to sign transaction";
-                        status = "400 Bad Request";
-                    }
-                } else {
-                    response["error"] = "Invalid wallet";
-                    status = "400 Bad Request";
-                }
-            } catch (const std::exception& e) {
-                response["error"] = e.what();
-                status = "400 Bad Request";
-            }
+    });
+    
+    addRoute("POST", "/rpc", [this](RouteContext& ctx) {
+        std::string body = rpc.handle(ctx.request.body);
+        if (body.empty()) {
+            // Only notifications: nothing to return
+            return buildHttpResponse("204 No Content", body, ctx.keepAlive);
         }
-        else {
-            response["error"] = "Endpoint not found";
-            status = "404 Not Found";
+        return buildEncodedResponse(ctx.request, "200 OK", body, ctx.keepAlive);
+    });
+    
+    // Streaming endpoints write to the socket themselves
+    addRoute("GET", "/blocks", [this](RouteContext& ctx) {
+        if (!streamBlockRange(ctx)) {
+            ctx.keepAlive = false;
         }
-    } catch (const std::exception& e) {
-        response["error"] = e.what();
-        status = "500 Internal Server Error";
+        return std::string();
+    });
+    
+    addRoute("GET", "/events", [this](RouteContext& ctx) {
+        streamEvents(ctx);
+        ctx.keepAlive = false;
+        return std::string();
+    });
+    
+    addRoute("GET", "/metrics", [this](RouteContext& ctx) {
+        return buildHttpResponse("200 OK", buildMetrics(), ctx.keepAlive, "",
+                                 "text/plain; version=0.0.4");
+    });
+    
+    router.setNotFoundHandler([this](RouteContext& ctx) {
+        nlohmann::json error;
+        error["error"] = "Endpoint not found";
+        return buildHttpResponse("404 Not Found", error.dump(), ctx.keepAlive);
+    });
+}
+
+void API::addRoute(const std::string& method, const std::string& pattern, Router::Handler handler) {
+    router.addRoute(method, pattern, std::move(handler));
+}
+
+// Most endpoints fill in a JSON object and a status line
+void API::addJsonRoute(const std::string& method, const std::string& pattern, JsonHandler handler) {
+    router.addRoute(method, pattern, [this, handler](RouteContext& ctx) {
+        nlohmann::json response;
+        std::string status = "200 OK";
+        handler(ctx, response, status);
+        return buildEncodedResponse(ctx.request, status, response.dump(), ctx.keepAlive);
+    });
+}
+
+// Route one request. Streaming handlers return an empty string after writing
+// to the socket themselves.
+std::string API::routeRequest(RouteContext& ctx) {
+    if (ctx.request.method == "OPTIONS") {
+        // Handle CORS preflight requests
+        nlohmann::json response;
+        response["status"] = "ok";
+        return buildHttpResponse("200 OK", response.dump(), ctx.keepAlive);
     }
     
-    // Create HTTP response
-    std::string json_body = response.dump(4);
-    std::string http_response = "HTTP/1.1 " + status + "\r\n";
-    http_response += "Content-Type: application/json\r\n";
+    try {
+        return router.dispatch(ctx);
+    } catch (const std::exception& e) {
+        nlohmann::json error;
+        error["error"] = e.what();
+        return buildHttpResponse("500 Internal Server Error", error.dump(), ctx.keepAlive);
+    }
+}
+
+// Build a complete HTTP response with the standard API headers
+std::string API::buildHttpResponse(const std::string& status, const std::string& body, bool keepAlive,
+                                   const std::string& extraHeaders, const std::string& contentType) {
+    std::string http_response;
+    http_response.reserve(256 + extraHeaders.size() + body.size());
+    http_response += "HTTP/1.1 " + status + "\r\n";
+    http_response += "Content-Type: " + contentType + "\r\n";
     http_response += "Access-Control-Allow-Origin: *\r\n";
     http_response += "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n";
-    http_response += "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-    http_response += "Content-Length: " + std::to_string(json_body.length()) + "\r\n";
+    http_response += "Access-Control-Allow-Headers: Content-Type, Authorization, If-None-Match\r\n";
+    http_response += extraHeaders;
+    http_response += "Content-Length: " + std::to_string(body.length()) + "\r\n";
+    http_response += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
     http_response += "\r\n";
-    http_response += json_body;
+    http_response += body;
     
     return http_response;
-}
\ No newline at end of file
+}
+
+// 429 with a Retry-After hint in whole seconds
+std::string API::buildRateLimitedResponse(double retryAfterSeconds, bool keepAlive) {
+    int retryAfter = std::max(1, static_cast<int>(std::ceil(retryAfterSeconds)));
+    nlohmann::json error;
+    error["error"] = "Rate limit exceeded";
+    error["retry_after"] = retryAfter;
+    return buildHttpResponse("429 Too Many Requests", error.dump(), keepAlive,
+                             "Retry-After: " + std::to_string(retryAfter) + "\r\n");
+}
+
+// 503 for requests shed by admission control
+std::string API::buildOverloadedResponse(double retryAfterSeconds, bool keepAlive) {
+    int retryAfter = std::max(1, static_cast<int>(std::ceil(retryAfterSeconds)));
+    nlohmann::json error;
+    error["error"] = "Server overloaded";
+    error["retry_after"] = retryAfter;
+    return buildHttpResponse("503 Service Unavailable", error.dump(), keepAlive,
+                             "Retry-After: " + std::to_string(retryAfter) + "\r\n");
+}
+
+// Gzip the body when the client accepts it and it is large enough to benefit
+std::string API::buildEncodedResponse(const HttpRequestView& request, const std::string& status,
+                                      const std::string& body, bool keepAlive) {
+    if (body.size() < Compression::GZIP_MIN_SIZE) {
+        return buildHttpResponse(status, body, keepAlive);
+    }
+    
+    if (Compression::acceptsGzip(request.header("Accept-Encoding"))) {
+        std::string compressed = Compression::gzip(body);
+        if (!compressed.empty() && compressed.size() < body.size()) {
+            return buildHttpResponse(status, compressed, keepAlive,
+                                     "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n");
+        }
+    }
+    return buildHttpResponse(status, body, keepAlive, "Vary: Accept-Encoding\r\n");
+}
+
+// Cached serialized block, built on demand for blocks evicted or loaded from disk
+std::shared_ptr<const CachedBlockResponse> API::getBlockResponse(uint64_t index) {
+    auto entry = blockCache.get(index);
+    if (entry) {
+        return entry;
+    }
+    
+    Block block(0, "0");
+    if (!blockchain.getBlock(index, block)) {
+        return nullptr;
+    }
+    return blockCache.put(block);
+}
+
+// Serve a cached block with its ETag, answering conditional requests with 304
+std::string API::buildBlockResponse(const CachedBlockResponse& entry, const HttpRequestView& request,
+                                    bool keepAlive, bool immutable) {
+    // Compressed bytes were produced when the block was cached
+    bool gzip = !entry.gzipBody.empty() && Compression::acceptsGzip(request.header("Accept-Encoding"));
+    const std::string& etag = gzip ? entry.gzipEtag : entry.etag;
+    
+    std::string headers = "ETag: " + etag + "\r\n";
+    headers += immutable ? "Cache-Control: public, max-age=31536000, immutable\r\n"
+                         : "Cache-Control: no-cache\r\n";
+    if (!entry.gzipBody.empty()) {
+        headers += "Vary: Accept-Encoding\r\n";
+    }
+    
+    std::string_view ifNoneMatch = request.header("If-None-Match");
+    if (!ifNoneMatch.empty() && BlockResponseCache::etagMatches(ifNoneMatch, etag)) {
+        std::string http_response = "HTTP/1.1 304 Not Modified\r\n";
+        http_response += "Access-Control-Allow-Origin: *\r\n";
+        http_response += headers;
+        http_response += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        http_response += "\r\n";
+        return http_response;
+    }
+    
+    if (gzip) {
+        return buildHttpResponse("200 OK", entry.gzipBody, keepAlive, headers + "Content-Encoding: gzip\r\n");
+    }
+    return buildHttpResponse("200 OK", entry.body, keepAlive, headers);
+}
+
+// Opaque pagination cursor: next height plus a prefix of the hash before it,
+// so a cursor taken before the chain was replaced is detected
+static std::string makeBlockCursor(uint64_t height, const std::string& previousHash) {
+    return std::to_string(height) + "-" + previousHash.substr(0, 16);
+}
+
+// GET /blocks?from=H&to=H2&limit=N or /blocks?cursor=C
+// Streams one page of blocks with chunked transfer encoding. Blocks come from
+// the response cache when present and are otherwise serialized from the chain
+// without being inserted, so range scans do not evict hot entries.
+bool API::streamBlockRange(RouteContext& ctx) {
+    static const uint64_t DEFAULT_PAGE_SIZE = 100;
+    static const uint64_t MAX_PAGE_SIZE = 1000;
+    
+    const HttpRequestView& request = ctx.request;
+    int client_fd = ctx.clientFd;
+    bool& keepAlive = ctx.keepAlive;
+    auto params = Utils::parseQueryParams(std::string(request.query));
+    size_t height = blockchain.getChainHeight();
+    
+    auto sendError = [&](const std::string& status, const std::string& message) {
+        nlohmann::json error;
+        error["error"] = message;
+        std::string response = buildHttpResponse(status, error.dump(), keepAlive);
+        ctx.status = std::atoi(status.c_str());
+        ctx.bytesSent = response.size();
+        return sendAll(client_fd, response.data(), response.size());
+    };
+    
+    uint64_t from = 0;
+    uint64_t to = height > 0 ? height - 1 : 0;
+    uint64_t limit = DEFAULT_PAGE_SIZE;
+    try {
+        if (params.count("cursor")) {
+            const std::string& cursor = params["cursor"];
+            size_t dash = cursor.find('-');
+            if (dash == std::string::npos) {
+                return sendError("400 Bad Request", "Malformed cursor");
+            }
+            from = std::stoull(cursor.substr(0, dash));
+            Block previous(0, "0");
+            if (from == 0 || !blockchain.getBlock(from - 1, previous) ||
+                previous.getHash().substr(0, 16) != cursor.substr(dash + 1)) {
+                return sendError("410 Gone", "Cursor is no longer valid for the current chain");
+            }
+        } else if (params.count("from")) {
+            from = std::stoull(params["from"]);
+        }
+        if (params.count("to")) {
+            to = std::stoull(params["to"]);
+        }
+        if (params.count("limit")) {
+            limit = std::stoull(params["limit"]);
+        }
+    } catch (const std::exception& e) {
+        return sendError("400 Bad Request", "Invalid range parameters");
+    }
+    
+    if (height == 0 || from >= height || from > to) {
+        return sendError("400 Bad Request", "Block range out of bounds");
+    }
+    to = std::min<uint64_t>(to, height - 1);
+    limit = std::max<uint64_t>(1, std::min(limit, MAX_PAGE_SIZE));
+    uint64_t pageEnd = std::min(to, from + limit - 1);
+    
+    bool chunked = request.version != "HTTP/1.0";
+    if (!chunked) {
+        keepAlive = false;
+    }
+    
+    std::string headers = "HTTP/1.1 200 OK\r\n";
+    headers += "Content-Type: application/json\r\n";
+    headers += "Access-Control-Allow-Origin: *\r\n";
+    headers += chunked ? "Transfer-Encoding: chunked\r\n" : "";
+    headers += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    headers += "\r\n";
+    ctx.status = 200;
+    ctx.bytesSent = headers.size();
+    if (!sendAll(client_fd, headers.data(), headers.size())) {
+        return false;
+    }
+    
+    ChunkedStreamWriter writer(client_fd, chunked);
+    writer.write("{\"blocks\":[");
+    std::string lastHash;
+    for (uint64_t i = from; i <= pageEnd && writer.ok(); i++) {
+        auto entry = blockCache.get(i);
+        if (!entry) {
+            Block block(0, "0");
+            if (!blockchain.getBlock(i, block)) {
+                // Chain shrank under us; end the stream without the terminating chunk
+                ctx.bytesSent += writer.bytesWritten();
+                return false;
+            }
+            entry = BlockResponseCache::build(block, false);
+        }
+        if (i != from) {
+            writer.write(',');
+        }
+        writer.write(entry->body);
+        lastHash = entry->hash;
+    }
+    
+    writer.write("],\"from\":" + std::to_string(from) + ",\"next_cursor\":");
+    writer.write(pageEnd < to ? "\"" + makeBlockCursor(pageEnd + 1, lastHash) + "\"" : std::string("null"));
+    writer.write(",\"to\":" + std::to_string(pageEnd) + "}");
+    
+    bool finished = writer.finish();
+    ctx.bytesSent += writer.bytesWritten();
+    return finished && keepAlive;
+}
+
+// Server-Sent Events stream of chain events. Each event is framed once by the
+// broadcaster and shared by every subscriber; a client that stops reading is
+// dropped once its queue fills rather than buffering without bound.
+void API::streamEvents(RouteContext& ctx) {
+    static const size_t MAX_QUEUED_EVENTS = 256;
+    static const std::chrono::seconds HEARTBEAT_INTERVAL(15);
+    
+    const HttpRequestView& request = ctx.request;
+    int client_fd = ctx.clientFd;
+    auto params = Utils::parseQueryParams(std::string(request.query));
+    std::set<std::string> types;
+    if (params.count("types")) {
+        std::stringstream ss(params["types"]);
+        std::string type;
+        while (std::getline(ss, type, ',')) {
+            if (!type.empty()) {
+                types.insert(type);
+            }
+        }
+    }
+    
+    uint64_t lastEventId = 0;
+    try {
+        std::string_view lastId = request.header("Last-Event-ID");
+        if (!lastId.empty()) {
+            lastEventId = std::stoull(std::string(lastId));
+        }
+    } catch (const std::exception& e) {
+        lastEventId = 0;
+    }
+    
+    std::string headers = "HTTP/1.1 200 OK\r\n";
+    headers += "Content-Type: text/event-stream\r\n";
+    headers += "Cache-Control: no-cache\r\n";
+    headers += "Access-Control-Allow-Origin: *\r\n";
+    headers += "Connection: keep-alive\r\n";
+    headers += "\r\n";
+    
+    // Ask EventSource clients to wait a few seconds before reconnecting
+    headers += "retry: 3000\n\n";
+    ctx.status = 200;
+    if (!sendAll(client_fd, headers.data(), headers.size())) {
+        return;
+    }
+    ctx.bytesSent += headers.size();
+    
+    // A stalled reader must not pin this thread inside send()
+    struct timeval send_timeout;
+    send_timeout.tv_sec = 10;
+    send_timeout.tv_usec = 0;
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+    
+    auto subscriber = events.subscribe(MAX_QUEUED_EVENTS, std::move(types), lastEventId);
+    std::vector<SharedStreamEvent> batch;
+    std::string out;
+    
+    while (running) {
+        if (!subscriber->next(batch, HEARTBEAT_INTERVAL)) {
+            if (subscriber->wasDropped()) {
+                Utils::logWarning("Dropping slow event stream subscriber");
+            }
+            break;
+        }
+        
+        if (batch.empty()) {
+            // Comment line keeps proxies from timing out idle streams
+            static const char heartbeat[] = ": keepalive\n\n";
+            if (!sendAll(client_fd, heartbeat, sizeof(heartbeat) - 1)) {
+                break;
+            }
+            ctx.bytesSent += sizeof(heartbeat) - 1;
+            continue;
+        }
+        
+        if (batch.size() == 1) {
+            if (!sendAll(client_fd, batch[0]->frame.data(), batch[0]->frame.size())) {
+                break;
+            }
+            ctx.bytesSent += batch[0]->frame.size();
+            continue;
+        }
+        
+        // Coalesce a backlog into one write
+        out.clear();
+        for (const auto& event : batch) {
+            out += event->frame;
+        }
+        if (!sendAll(client_fd, out.data(), out.size())) {
+            break;
+        }
+        ctx.bytesSent += out.size();
+    }
+    
+    events.unsubscribe(subscriber);
+}
+
+// Chain summary, optionally with the most recent blocks spliced in from the cache
+std::string API::buildChainResponse(const HttpRequestView& request, bool keepAlive) {
+    auto params = Utils::parseQueryParams(std::string(request.query));
+    size_t height = blockchain.getChainHeight();
+    
+    std::string body = "{";
+    if (params["include_blocks"] == "true") {
+        size_t limit = 10;
+        if (params.find("limit") != params.end()) {
+            try {
+                limit = std::stoul(params["limit"]);
+            } catch (...) {
+                limit = 10;
+            }
+        }
+        
+        size_t start = height > limit ? height - limit : 0;
+        body += "\"blocks\":[";
+        for (size_t i = start; i < height; i++) {
+            auto entry = getBlockResponse(i);
+            if (!entry) {
+                break;
+            }
+            if (i != start) {
+                body += ',';
+            }
+            body += entry->body;
+        }
+        body += "],";
+    }
+    body += "\"chain_height\":" + std::to_string(height) + "}";
+    
+    return buildEncodedResponse(request, "200 OK", body, keepAlive);
+}
+
+// Prometheus text exposition: per-route statistics plus node-level gauges
+std::string API::buildMetrics() {
+    std::string out = router.renderMetrics();
+    out += admission.renderMetrics();
+    
+    auto metric = [&out](const std::string& name, const std::string& type, const std::string& help,
+                         uint64_t value) {
+        out += "# HELP " + name + " " + help + "\n";
+        out += "# TYPE " + name + " " + type + "\n";
+        out += name + " " + std::to_string(value) + "\n";
+    };
+    
+    metric("nilotic_chain_height", "gauge", "Number of blocks in the chain.", blockchain.getChainHeight());
+    metric("nilotic_pending_transactions", "gauge", "Transactions waiting to be mined.",
+           blockchain.getPendingTransactionCount());
+    metric("nilotic_mining_jobs_queued", "gauge", "Mining jobs waiting for the executor.",
+           miningJobs.getQueueDepth());
+    metric("nilotic_block_cache_entries", "gauge", "Serialized blocks held in the response cache.", blockCache.size());
+    metric("nilotic_block_cache_hits_total", "counter", "Block response cache hits.", blockCache.getHits());
+    metric("nilotic_block_cache_misses_total", "counter", "Block response cache misses.", blockCache.getMisses());
+    metric("nilotic_rate_limited_ip_total", "counter", "Requests refused by the per-IP limit.",
+           ipLimiter.getLimited());
+    metric("nilotic_rate_limited_sender_total", "counter", "Transactions refused by the per-sender limit.",
+           senderLimiter.getLimited());
+    metric("nilotic_rate_limiter_evictions_total", "counter", "Rate limit buckets evicted to bound memory.",
+           ipLimiter.getEvicted() + senderLimiter.getEvicted());
+    metric("nilotic_event_subscribers", "gauge", "Connected /events subscribers.", events.getSubscriberCount());
+    metric("nilotic_events_published_total", "counter", "Events published to subscribers.",
+           events.getEventsPublished());
+    metric("nilotic_event_subscribers_dropped_total", "counter", "Subscribers dropped for falling behind.",
+           events.getSubscribersDropped());
+    return out;
+}
@@ -0,0 +1,107 @@
+#include "block_cache.h"
+#include "utils.h"
+#include "compression.h"
+
+BlockResponseCache::BlockResponseCache(size_t capacity)
+    : capacity(capacity == 0 ? 1 : capacity), hits(0), misses(0) {}
+
+BlockResponseCache::Entry BlockResponseCache::build(const Block& block, bool compress) {
+    auto entry = std::make_shared<CachedBlockResponse>();
+    entry->index = block.getIndex();
+    entry->hash = block.getHash();
+    JsonWriter json(entry->body);
+    block.writeJson(json);
+
+    // Derive the validator from the bytes actually served, so any change to
+    // the representation also changes the tag
+    std::string tag = Utils::calculateSHA256(entry->body).substr(0, 32);
+    entry->etag = "\"" + tag + "\"";
+
+    // Blocks never change, so compress once here rather than per request.
+    // The encoded variant needs its own strong tag.
+    if (compress && entry->body.size() >= Compression::GZIP_MIN_SIZE) {
+        entry->gzipBody = Compression::gzip(entry->body);
+        if (!entry->gzipBody.empty()) {
+            entry->gzipEtag = "\"" + tag + "-gz\"";
+        }
+    }
+    return entry;
+}
+
+BlockResponseCache::Entry BlockResponseCache::put(const Block& block) {
+    Entry entry = build(block);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = entries.find(entry->index);
+    if (it != entries.end()) {
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+
+    lru.push_front(entry);
+    entries[entry->index] = lru.begin();
+
+    while (entries.size() > capacity) {
+        entries.erase(lru.back()->index);
+        lru.pop_back();
+    }
+    return entry;
+}
+
+BlockResponseCache::Entry BlockResponseCache::get(uint64_t index) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = entries.find(index);
+    if (it == entries.end()) {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    lru.splice(lru.begin(), lru, it->second);
+    return *it->second;
+}
+
+void BlockResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    entries.clear();
+    lru.clear();
+}
+
+size_t BlockResponseCache::size() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return entries.size();
+}
+
+uint64_t BlockResponseCache::getHits() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return hits;
+}
+
+uint64_t BlockResponseCache::getMisses() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return misses;
+}
+
+bool BlockResponseCache::etagMatches(std::string_view ifNoneMatch, const std::string& etag) {
+    size_t pos = 0;
+    while (pos < ifNoneMatch.size()) {
+        size_t comma = ifNoneMatch.find(',', pos);
+        if (comma == std::string_view::npos) {
+            comma = ifNoneMatch.size();
+        }
+
+        std::string_view candidate = ifNoneMatch.substr(pos, comma - pos);
+        while (!candidate.empty() && (candidate.front() == ' ' || candidate.front() == '\t')) candidate.remove_prefix(1);
+        while (!candidate.empty() && (candidate.back() == ' ' || candidate.back() == '\t')) candidate.remove_suffix(1);
+
+        // If-None-Match uses weak comparison, so a W/ prefix is ignored
+        if (candidate.substr(0, 2) == "W/") {
+            candidate.remove_prefix(2);
+        }
+        if (candidate == "*" || candidate == etag) {
+            return true;
+        }
+        pos = comma + 1;
+    }
+    return false;
+}
@@ -0,0 +1,236 @@
+#include "compact_block.h"
+#include <cstring>
+#include <map>
+#include <openssl/sha.h>
+
+// SipHash-2-4
+static inline uint64_t rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+#define SIPROUND                                                   \
+    do {                                                           \
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);  \
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;                     \
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;                     \
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);  \
+    } while (0)
+
+uint64_t sipHash24(uint64_t k0, uint64_t k1, const void* data, size_t length) {
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    size_t blocks = length / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        uint64_t m = 0;
+        for (int b = 0; b < 8; b++) {
+            m |= static_cast<uint64_t>(in[i * 8 + b]) << (8 * b);
+        }
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    uint64_t last = static_cast<uint64_t>(length) << 56;
+    for (size_t b = 0; b < length % 8; b++) {
+        last |= static_cast<uint64_t>(in[blocks * 8 + b]) << (8 * b);
+    }
+    v3 ^= last;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef SIPROUND
+
+// CompactBlock implementation
+CompactBlock::CompactBlock() : salt(0), k0(0), k1(0), transactionCount(0) {}
+
+void CompactBlock::deriveKeys() {
+    // Key = first 16 bytes of SHA-256(block hash || salt)
+    std::string seed = header.hash + std::to_string(salt);
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(seed.data()), seed.size(), digest);
+    k0 = 0;
+    k1 = 0;
+    for (int i = 0; i < 8; i++) {
+        k0 |= static_cast<uint64_t>(digest[i]) << (8 * i);
+        k1 |= static_cast<uint64_t>(digest[8 + i]) << (8 * i);
+    }
+}
+
+uint64_t CompactBlock::shortId(const std::string& transactionHash) const {
+    return sipHash24(k0, k1, transactionHash.data(), transactionHash.size()) & SHORT_ID_MASK;
+}
+
+CompactBlock CompactBlock::fromBlock(const Block& block, uint64_t salt) {
+    CompactBlock compact;
+    compact.header = BlockHeader::fromBlock(block);
+    compact.signature = block.getSignature();
+    compact.salt = salt;
+    compact.deriveKeys();
+
+    std::vector<Transaction> transactions = block.getTransactions();
+    compact.transactionCount = transactions.size();
+    for (size_t i = 0; i < transactions.size(); i++) {
+        if (transactions[i].getSender() == "COINBASE") {
+            compact.prefilled.emplace_back(i, transactions[i]);
+        } else {
+            compact.shortIds.push_back(compact.shortId(transactions[i].getHash()));
+        }
+    }
+    return compact;
+}
+
+nlohmann::json CompactBlock::toJson() const {
+    static const char HEX[] = "0123456789abcdef";
+    std::string ids;
+    ids.reserve(shortIds.size() * 12);
+    for (uint64_t id : shortIds) {
+        for (int shift = 44; shift >= 0; shift -= 4) {
+            ids.push_back(HEX[(id >> shift) & 0xf]);
+        }
+    }
+
+    nlohmann::json json;
+    json["header"] = header.toJson();
+    json["signature"] = signature;
+    json["salt"] = salt;
+    json["transactionCount"] = transactionCount;
+    json["shortIds"] = ids;
+    json["prefilled"] = nlohmann::json::array();
+    for (const auto& entry : prefilled) {
+        json["prefilled"].push_back({{"index", entry.first}, {"transaction", entry.second.serialize()}});
+    }
+    return json;
+}
+
+CompactBlock CompactBlock::fromJson(const nlohmann::json& json) {
+    CompactBlock compact;
+    compact.header = BlockHeader::fromJson(json.at("header"));
+    compact.signature = json.value("signature", "");
+    compact.salt = json.at("salt").get<uint64_t>();
+    compact.transactionCount = json.at("transactionCount").get<size_t>();
+    compact.deriveKeys();
+
+    for (const auto& entry : json.at("prefilled")) {
+        size_t index = entry.at("index").get<size_t>();
+        if (index >= compact.transactionCount) {
+            throw std::runtime_error("Prefilled transaction index out of range");
+        }
+        compact.prefilled.emplace_back(index, Transaction::deserialize(entry.at("transaction").get<std::string>()));
+    }
+
+    const std::string& ids = json.at("shortIds").get_ref<const std::string&>();
+    if (ids.size() % 12 != 0 || ids.size() / 12 + compact.prefilled.size() != compact.transactionCount) {
+        throw std::runtime_error("Short ID count does not match transaction count");
+    }
+    for (size_t i = 0; i < ids.size(); i += 12) {
+        compact.shortIds.push_back(std::stoull(ids.substr(i, 12), nullptr, 16));
+    }
+    return compact;
+}
+
+// PartialBlock implementation
+PartialBlock::PartialBlock(CompactBlock compactIn) : compact(std::move(compactIn)) {
+    slots.resize(compact.transactionCount);
+    for (const auto& entry : compact.prefilled) {
+        slots[entry.first] = entry.second;
+    }
+}
+
+std::vector<size_t> PartialBlock::fillFromMempool(const std::deque<Transaction>& mempool) {
+    // Short ID -> pool position, or -1 when two pool entries collide
+    std::map<uint64_t, long> candidates;
+    for (size_t i = 0; i < mempool.size(); i++) {
+        auto inserted = candidates.emplace(compact.shortId(mempool[i].getHash()), static_cast<long>(i));
+        if (!inserted.second && inserted.first->second >= 0 &&
+            mempool[static_cast<size_t>(inserted.first->second)].getHash() != mempool[i].getHash()) {
+            inserted.first->second = -1;
+        }
+    }
+
+    size_t next = 0;
+    for (size_t position = 0; position < slots.size(); position++) {
+        if (slots[position]) {
+            continue;
+        }
+        if (next >= compact.shortIds.size()) {
+            break;   // Duplicate prefilled positions; left missing
+        }
+        uint64_t id = compact.shortIds[next++];
+        auto match = candidates.find(id);
+        if (match != candidates.end() && match->second >= 0) {
+            slots[position] = mempool[static_cast<size_t>(match->second)];
+        }
+    }
+    return getMissing();
+}
+
+bool PartialBlock::fillMissing(const std::vector<Transaction>& transactions) {
+    std::vector<size_t> missing = getMissing();
+    if (transactions.size() != missing.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < missing.size(); i++) {
+        slots[missing[i]] = transactions[i];
+    }
+    return true;
+}
+
+std::vector<size_t> PartialBlock::getMissing() const {
+    std::vector<size_t> missing;
+    for (size_t position = 0; position < slots.size(); position++) {
+        if (!slots[position]) {
+            missing.push_back(position);
+        }
+    }
+    return missing;
+}
+
+std::vector<size_t> PartialBlock::reset() {
+    for (auto& slot : slots) {
+        slot.reset();
+    }
+    for (const auto& entry : compact.prefilled) {
+        slots[entry.first] = entry.second;
+    }
+    return getMissing();
+}
+
+bool PartialBlock::build(Block& out) const {
+    const BlockHeader& header = compact.header;
+    nlohmann::json json = header.toJson();
+    json["signature"] = compact.signature;
+    json["transactions"] = nlohmann::json::array();
+    for (const auto& slot : slots) {
+        if (!slot) {
+            return false;
+        }
+        json["transactions"].push_back(slot->serialize());
+    }
+
+    Block block = Block::deserialize(json.dump());
+    if (block.calculateHash() != header.hash) {
+        return false;
+    }
+
+    // A short ID collision with a different pool transaction shows up here
+    Block check = block;
+    if (check.calculateMerkleRoot() != header.merkleRoot) {
+        return false;
+    }
+    out = std::move(block);
+    return true;
+}
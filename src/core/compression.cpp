@@ -0,0 +1,71 @@
+#include "compression.h"
+#include <zlib.h>
+#include <cctype>
+
+std::string Compression::gzip(std::string_view data, int level) {
+    z_stream stream{};
+    // windowBits 15 + 16 selects the gzip wrapper instead of raw zlib
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return "";
+    }
+
+    std::string out;
+    out.resize(deflateBound(&stream, static_cast<uLong>(data.size())) + 18);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    int result = deflate(&stream, Z_FINISH);
+    size_t written = stream.total_out;
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        return "";
+    }
+    out.resize(written);
+    return out;
+}
+
+bool Compression::acceptsGzip(std::string_view acceptEncoding) {
+    // An explicit gzip entry decides; "*" only covers codings not listed
+    // (RFC 9110 12.5.3), so the whole list is read before answering
+    int gzip = -1;
+    int wildcard = -1;
+    size_t pos = 0;
+    while (pos < acceptEncoding.size()) {
+        size_t comma = acceptEncoding.find(',', pos);
+        if (comma == std::string_view::npos) {
+            comma = acceptEncoding.size();
+        }
+
+        std::string_view item = acceptEncoding.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        std::string_view coding = item.substr(0, item.find(';'));
+        while (!coding.empty() && (coding.front() == ' ' || coding.front() == '\t')) coding.remove_prefix(1);
+        while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t')) coding.remove_suffix(1);
+
+        bool isGzip = coding.size() == 4;
+        for (size_t i = 0; isGzip && i < 4; i++) {
+            isGzip = std::tolower(static_cast<unsigned char>(coding[i])) == "gzip"[i];
+        }
+        if (!isGzip && coding != "*") {
+            continue;
+        }
+
+        // "gzip;q=0" explicitly refuses the coding
+        bool allowed = true;
+        size_t q = item.find("q=");
+        if (q != std::string_view::npos) {
+            std::string_view value = item.substr(q + 2);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            allowed = value.find_first_not_of("0.") != std::string_view::npos;
+        }
+        (isGzip ? gzip : wildcard) = allowed ? 1 : 0;
+    }
+    if (gzip >= 0) {
+        return gzip == 1;
+    }
+    return wildcard == 1;
+}
@@ -0,0 +1,263 @@
+#include "dialer.h"
+#include "logger.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <cstdio>
+
+static uint64_t unixSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Dialer implementation
+Dialer::Dialer(const DialerConfig& config)
+    : config(config), rng(std::random_device()()), dialsStarted(0), dialsSucceeded(0), dialsFailed(0),
+      dialsTimedOut(0) {}
+
+Dialer::Entry& Dialer::entryFor(const std::string& address, uint16_t port) {
+    auto inserted = addresses.emplace(address + ":" + std::to_string(port), Entry());
+    Entry& entry = inserted.first->second;
+    if (inserted.second) {
+        entry.address = address;
+        entry.port = port;
+    }
+    return entry;
+}
+
+void Dialer::backOff(Entry& entry, std::chrono::steady_clock::time_point now) {
+    entry.failures++;
+    double delay = static_cast<double>(config.initialBackoff.count()) * std::exp2(std::min<uint32_t>(entry.failures - 1, 20));
+    delay = std::min(delay, static_cast<double>(config.maxBackoff.count()));
+    std::uniform_real_distribution<double> jitter(1 - config.jitter, 1 + config.jitter);
+    entry.nextAttempt = now + std::chrono::milliseconds(static_cast<int64_t>(delay * jitter(rng)));
+}
+
+void Dialer::trimLocked() {
+    // Forget the least promising idle address: never reached, most failures
+    while (addresses.size() > config.maxAddresses) {
+        auto worst = addresses.end();
+        for (auto it = addresses.begin(); it != addresses.end(); ++it) {
+            if (inFlight.count(it->first) || outbound.count(it->first)) {
+                continue;
+            }
+            if (worst == addresses.end() ||
+                std::make_pair(it->second.lastSuccess, -static_cast<int64_t>(it->second.failures)) <
+                std::make_pair(worst->second.lastSuccess, -static_cast<int64_t>(worst->second.failures))) {
+                worst = it;
+            }
+        }
+        if (worst == addresses.end()) {
+            return;
+        }
+        addresses.erase(worst);
+    }
+}
+
+void Dialer::addAddress(const std::string& address, uint16_t port) {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    entryFor(address, port);
+    trimLocked();
+}
+
+Dialer::Plan Dialer::tick(const std::set<std::string>& connected) {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    auto now = std::chrono::steady_clock::now();
+    Plan plan;
+
+    // A connect to a host that drops SYNs only fails after the kernel's
+    // retries, which take minutes; give up on it long before that
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+        if (now - it->second < config.connectTimeout) {
+            ++it;
+            continue;
+        }
+        plan.timedOut.push_back(it->first);
+        auto entry = addresses.find(it->first);
+        if (entry != addresses.end()) {
+            backOff(entry->second, now);
+        }
+        dialsTimedOut++;
+        dialsFailed++;
+        it = inFlight.erase(it);
+    }
+
+    size_t busy = outbound.size() + inFlight.size();
+    if (busy >= config.targetOutbound || inFlight.size() >= config.maxInFlight) {
+        return plan;
+    }
+    size_t slots = std::min(config.targetOutbound - busy, config.maxInFlight - inFlight.size());
+
+    // Known-good peers first, most recent first; untried before failing
+    std::vector<Entry*> candidates;
+    for (auto& pair : addresses) {
+        if (pair.second.nextAttempt <= now && !inFlight.count(pair.first) && !outbound.count(pair.first) &&
+            !connected.count(pair.first)) {
+            candidates.push_back(&pair.second);
+        }
+    }
+    std::shuffle(candidates.begin(), candidates.end(), rng);
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) {
+        if (a->lastSuccess != b->lastSuccess) {
+            return a->lastSuccess > b->lastSuccess;
+        }
+        return a->failures < b->failures;
+    });
+
+    for (size_t i = 0; i < candidates.size() && i < slots; i++) {
+        const Entry& entry = *candidates[i];
+        inFlight[entry.address + ":" + std::to_string(entry.port)] = now;
+        plan.dials.push_back({entry.address, entry.port});
+        dialsStarted++;
+    }
+    return plan;
+}
+
+void Dialer::dialStarted(const std::string& address, uint16_t port) {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    entryFor(address, port);
+    if (inFlight.emplace(address + ":" + std::to_string(port), std::chrono::steady_clock::now()).second) {
+        dialsStarted++;
+    }
+}
+
+void Dialer::dialSucceeded(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    if (inFlight.erase(peer) == 0) {
+        return;   // Inbound, or already handshaken
+    }
+    outbound.insert(peer);
+    auto it = addresses.find(peer);
+    if (it != addresses.end()) {
+        it->second.lastSuccess = unixSeconds();
+        it->second.failures = 0;
+    }
+    dialsSucceeded++;
+}
+
+void Dialer::connectionClosed(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    auto now = std::chrono::steady_clock::now();
+    auto it = addresses.find(peer);
+    if (inFlight.erase(peer)) {
+        // Refused, unreachable or closed before the handshake
+        if (it != addresses.end()) {
+            backOff(it->second, now);
+        }
+        dialsFailed++;
+    } else if (outbound.erase(peer) && it != addresses.end()) {
+        // A good peer that went away is worth another try, after a pause
+        it->second.nextAttempt = now + config.initialBackoff;
+    }
+}
+
+void Dialer::deferHost(const std::string& address, std::chrono::steady_clock::time_point until) {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    for (auto& pair : addresses) {
+        if (pair.second.address == address) {
+            pair.second.nextAttempt = std::max(pair.second.nextAttempt, until);
+            inFlight.erase(pair.first);
+        }
+    }
+}
+
+bool Dialer::isDialing(const std::string& peer) const {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    return inFlight.count(peer) > 0;
+}
+
+bool Dialer::isOutbound(const std::string& peer) const {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    return inFlight.count(peer) > 0 || outbound.count(peer) > 0;
+}
+
+size_t Dialer::getOutboundCount() const {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    return outbound.size();
+}
+
+bool Dialer::load() {
+    if (config.addressBookPath.empty()) {
+        return false;
+    }
+    std::ifstream file(config.addressBookPath);
+    if (!file) {
+        return false;
+    }
+    try {
+        nlohmann::json book = nlohmann::json::parse(file);
+        std::lock_guard<std::mutex> lock(dialerMutex);
+        for (const auto& item : book.at("addresses")) {
+            Entry& entry = entryFor(item.at("address").get<std::string>(), item.at("port").get<uint16_t>());
+            entry.lastSuccess = std::max(entry.lastSuccess, item.value("lastSuccess", uint64_t(0)));
+        }
+        trimLocked();
+        Logger::info("Loaded " + std::to_string(book.at("addresses").size()) + " addresses from " + config.addressBookPath);
+        return true;
+    } catch (const std::exception& e) {
+        Logger::warning("Ignoring unreadable address book " + config.addressBookPath + ": " + e.what());
+        return false;
+    }
+}
+
+bool Dialer::save() const {
+    if (config.addressBookPath.empty()) {
+        return false;
+    }
+    nlohmann::json book;
+    book["addresses"] = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lock(dialerMutex);
+        std::vector<const Entry*> good;
+        for (const auto& pair : addresses) {
+            if (pair.second.lastSuccess > 0) {
+                good.push_back(&pair.second);
+            }
+        }
+        std::sort(good.begin(), good.end(), [](const Entry* a, const Entry* b) {
+            return a->lastSuccess > b->lastSuccess;
+        });
+        for (const Entry* entry : good) {
+            book["addresses"].push_back({
+                {"address", entry->address},
+                {"port", entry->port},
+                {"lastSuccess", entry->lastSuccess}
+            });
+        }
+    }
+
+    // Written aside and renamed, so a crash never leaves half a book
+    std::string temporary = config.addressBookPath + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file || !(file << book.dump(2))) {
+            Logger::warning("Failed to write address book " + temporary);
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), config.addressBookPath.c_str()) != 0) {
+        Logger::warning("Failed to replace address book " + config.addressBookPath);
+        return false;
+    }
+    return true;
+}
+
+nlohmann::json Dialer::getStats() const {
+    std::lock_guard<std::mutex> lock(dialerMutex);
+    uint64_t known = 0;
+    for (const auto& pair : addresses) {
+        if (pair.second.lastSuccess > 0) {
+            known++;
+        }
+    }
+    return {
+        {"addresses", addresses.size()},
+        {"knownGood", known},
+        {"outbound", outbound.size()},
+        {"inFlight", inFlight.size()},
+        {"dialsStarted", dialsStarted},
+        {"dialsSucceeded", dialsSucceeded},
+        {"dialsFailed", dialsFailed},
+        {"dialsTimedOut", dialsTimedOut}
+    };
+}
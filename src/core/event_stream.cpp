@@ -0,0 +1,112 @@
+#include "event_stream.h"
+#include <algorithm>
+
+// EventSubscriber implementation
+EventSubscriber::EventSubscriber(size_t maxQueued, std::set<std::string> types)
+    : maxQueued(maxQueued == 0 ? 1 : maxQueued), types(std::move(types)), dropped(false), closed(false) {}
+
+bool EventSubscriber::offer(const SharedStreamEvent& event) {
+    std::lock_guard<std::mutex> lock(subscriberMutex);
+    if (dropped || closed) {
+        return false;
+    }
+    if (queue.size() >= maxQueued) {
+        // Slow consumer: release its backlog and let the connection close
+        dropped = true;
+        queue.clear();
+        subscriberCV.notify_all();
+        return false;
+    }
+    queue.push_back(event);
+    subscriberCV.notify_one();
+    return true;
+}
+
+bool EventSubscriber::next(std::vector<SharedStreamEvent>& batch, std::chrono::milliseconds timeout) {
+    batch.clear();
+    std::unique_lock<std::mutex> lock(subscriberMutex);
+    subscriberCV.wait_for(lock, timeout, [this] { return !queue.empty() || dropped || closed; });
+    if (dropped || closed) {
+        return false;
+    }
+    batch.assign(queue.begin(), queue.end());
+    queue.clear();
+    return true;
+}
+
+void EventSubscriber::close() {
+    std::lock_guard<std::mutex> lock(subscriberMutex);
+    closed = true;
+    subscriberCV.notify_all();
+}
+
+bool EventSubscriber::wasDropped() const {
+    std::lock_guard<std::mutex> lock(subscriberMutex);
+    return dropped;
+}
+
+// EventBroadcaster implementation
+EventBroadcaster::EventBroadcaster(size_t historySize) : historySize(historySize), nextEventId(1) {}
+
+void EventBroadcaster::publish(const std::string& type, const std::string& data) {
+    std::lock_guard<std::mutex> lock(broadcasterMutex);
+
+    auto event = std::make_shared<StreamEvent>();
+    event->id = nextEventId++;
+    event->type = type;
+    event->frame.reserve(data.size() + type.size() + 32);
+    event->frame += "id: " + std::to_string(event->id) + "\n";
+    event->frame += "event: " + type + "\n";
+    event->frame += "data: " + data + "\n\n";
+    SharedStreamEvent shared = event;
+
+    history.push_back(shared);
+    if (history.size() > historySize) {
+        history.pop_front();
+    }
+
+    auto it = subscribers.begin();
+    while (it != subscribers.end()) {
+        if ((*it)->wants(type) && !(*it)->offer(shared) && (*it)->wasDropped()) {
+            subscribersDropped++;
+            it = subscribers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    eventsPublished++;
+}
+
+std::shared_ptr<EventSubscriber> EventBroadcaster::subscribe(size_t maxQueued, std::set<std::string> types,
+                                                             uint64_t lastEventId) {
+    auto subscriber = std::make_shared<EventSubscriber>(maxQueued, std::move(types));
+
+    std::lock_guard<std::mutex> lock(broadcasterMutex);
+    if (lastEventId > 0) {
+        for (const auto& event : history) {
+            if (event->id > lastEventId && subscriber->wants(event->type)) {
+                subscriber->offer(event);
+            }
+        }
+    }
+    subscribers.push_back(subscriber);
+    return subscriber;
+}
+
+void EventBroadcaster::unsubscribe(const std::shared_ptr<EventSubscriber>& subscriber) {
+    std::lock_guard<std::mutex> lock(broadcasterMutex);
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
+}
+
+void EventBroadcaster::closeAll() {
+    std::lock_guard<std::mutex> lock(broadcasterMutex);
+    for (auto& subscriber : subscribers) {
+        subscriber->close();
+    }
+    subscribers.clear();
+}
+
+size_t EventBroadcaster::getSubscriberCount() const {
+    std::lock_guard<std::mutex> lock(broadcasterMutex);
+    return subscribers.size();
+}
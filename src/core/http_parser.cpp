@@ -0,0 +1,434 @@
+#include "http_parser.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+
+namespace {
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        char ca = a[i];
+        char cb = b[i];
+        if (ca >= 'A' && ca <= 'Z') ca = static_cast<char>(ca - 'A' + 'a');
+        if (cb >= 'A' && cb <= 'Z') cb = static_cast<char>(cb - 'A' + 'a');
+        if (ca != cb) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// True if the comma-separated header value contains the given token
+bool containsToken(std::string_view value, std::string_view token) {
+    size_t pos = 0;
+    while (pos <= value.size()) {
+        size_t comma = value.find(',', pos);
+        if (comma == std::string_view::npos) {
+            comma = value.size();
+        }
+        std::string_view item = value.substr(pos, comma - pos);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+        if (equalsIgnoreCase(item, token)) {
+            return true;
+        }
+        pos = comma + 1;
+    }
+    return false;
+}
+
+// Find the end of the line starting at pos; returns npos if no '\n' yet.
+// lineEnd excludes the trailing "\r\n" or "\n".
+size_t findLineEnd(const char* data, size_t pos, size_t size, size_t& lineEnd) {
+    const void* nl = std::memchr(data + pos, '\n', size - pos);
+    if (nl == nullptr) {
+        return std::string::npos;
+    }
+    size_t newline = static_cast<const char*>(nl) - data;
+    lineEnd = (newline > pos && data[newline - 1] == '\r') ? newline - 1 : newline;
+    return newline + 1;
+}
+
+} // namespace
+
+std::string_view HttpRequestView::header(std::string_view name) const {
+    for (const auto& h : headers) {
+        if (equalsIgnoreCase(h.name, name)) {
+            return h.value;
+        }
+    }
+    return std::string_view();
+}
+
+HttpRequestParser::HttpRequestParser(size_t maxHeaderBytes, size_t maxBodyBytes)
+    : maxHeaderBytes(maxHeaderBytes), maxBodyBytes(maxBodyBytes) {
+    reset();
+}
+
+void HttpRequestParser::reset() {
+    state = State::HEADERS;
+    scanOffset = 0;
+    headerEnd = 0;
+    bodyStart = 0;
+    bodyLength = 0;
+    chunkRemaining = 0;
+    expectContinue = false;
+    errorCode = 0;
+    errorText.clear();
+    methodSpan = targetSpan = versionSpan = Span{0, 0};
+    headerSpans.clear();
+
+    // Keep the header vector's capacity for the next request on this connection
+    view.headers.clear();
+    view.method = view.target = view.path = view.query = view.version = view.body = std::string_view();
+    view.keepAlive = true;
+}
+
+HttpParseStatus HttpRequestParser::fail(int code, const std::string& message) {
+    state = State::FAILED;
+    errorCode = code;
+    errorText = message;
+    return HttpParseStatus::ERROR;
+}
+
+HttpParseStatus HttpRequestParser::parse(char* data, size_t size) {
+    switch (state) {
+        case State::DONE:
+            return HttpParseStatus::COMPLETE;
+        case State::FAILED:
+            return HttpParseStatus::ERROR;
+        case State::HEADERS: {
+            HttpParseStatus status = parseHeaders(data, size);
+            if (status != HttpParseStatus::COMPLETE) {
+                return status;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (state == State::BODY) {
+        if (size < bodyStart + bodyLength) {
+            return HttpParseStatus::INCOMPLETE;
+        }
+        scanOffset = bodyStart + bodyLength;
+        state = State::DONE;
+    } else if (state != State::DONE) {
+        HttpParseStatus status = parseChunked(data, size);
+        if (status != HttpParseStatus::COMPLETE) {
+            return status;
+        }
+    }
+
+    buildView(data);
+    return HttpParseStatus::COMPLETE;
+}
+
+HttpParseStatus HttpRequestParser::parseHeaders(char* data, size_t size) {
+    // Tolerate stray CRLFs between pipelined requests
+    if (scanOffset == 0) {
+        while (scanOffset < size && (data[scanOffset] == '\r' || data[scanOffset] == '\n')) {
+            scanOffset++;
+        }
+        methodSpan.offset = scanOffset;
+    }
+    size_t requestStart = methodSpan.offset;
+
+    // Look for the blank line that terminates the header block
+    size_t pos = scanOffset;
+    while (headerEnd == 0) {
+        const void* nl = std::memchr(data + pos, '\n', size - pos);
+        if (nl == nullptr) {
+            pos = size;
+            break;
+        }
+        size_t newline = static_cast<const char*>(nl) - data;
+        if (newline + 1 < size && data[newline + 1] == '\n') {
+            headerEnd = newline + 2;
+        } else if (newline + 2 < size && data[newline + 1] == '\r' && data[newline + 2] == '\n') {
+            headerEnd = newline + 3;
+        } else if (newline + 2 >= size) {
+            // Not enough bytes yet to tell whether the next line is blank
+            pos = newline;
+            break;
+        } else {
+            pos = newline + 1;
+        }
+    }
+
+    if (headerEnd == 0) {
+        scanOffset = pos;
+        if (size - requestStart > maxHeaderBytes) {
+            return fail(431, "Request header fields too large");
+        }
+        return HttpParseStatus::INCOMPLETE;
+    }
+    if (headerEnd - requestStart > maxHeaderBytes) {
+        return fail(431, "Request header fields too large");
+    }
+
+    // Request line: METHOD SP request-target SP HTTP-version
+    size_t lineEnd = 0;
+    size_t next = findLineEnd(data, requestStart, headerEnd, lineEnd);
+    std::string_view requestLine(data + requestStart, lineEnd - requestStart);
+    size_t sp1 = requestLine.find(' ');
+    size_t sp2 = sp1 == std::string_view::npos ? sp1 : requestLine.find(' ', sp1 + 1);
+    if (sp1 == std::string_view::npos || sp2 == std::string_view::npos || sp1 == 0 || sp2 == sp1 + 1) {
+        return fail(400, "Malformed request line");
+    }
+    methodSpan = Span{requestStart, sp1};
+    targetSpan = Span{requestStart + sp1 + 1, sp2 - sp1 - 1};
+    versionSpan = Span{requestStart + sp2 + 1, requestLine.size() - sp2 - 1};
+
+    std::string_view version(data + versionSpan.offset, versionSpan.length);
+    if (version.substr(0, 7) != "HTTP/1.") {
+        return fail(505, "HTTP version not supported");
+    }
+    bool keepAlive = version != "HTTP/1.0";
+
+    // Header fields
+    bool chunked = false;
+    bool haveContentLength = false;
+    bool haveTransferEncoding = false;
+    size_t contentLength = 0;
+
+    while (next < headerEnd) {
+        size_t lineStart = next;
+        next = findLineEnd(data, lineStart, headerEnd, lineEnd);
+        if (lineEnd == lineStart) {
+            break; // Blank line
+        }
+        if (data[lineStart] == ' ' || data[lineStart] == '\t') {
+            return fail(400, "Obsolete header line folding is not supported");
+        }
+
+        std::string_view line(data + lineStart, lineEnd - lineStart);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0) {
+            return fail(400, "Malformed header field");
+        }
+        size_t valueStart = colon + 1;
+        while (valueStart < line.size() && (line[valueStart] == ' ' || line[valueStart] == '\t')) valueStart++;
+        size_t valueEnd = line.size();
+        while (valueEnd > valueStart && (line[valueEnd - 1] == ' ' || line[valueEnd - 1] == '\t')) valueEnd--;
+
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = line.substr(valueStart, valueEnd - valueStart);
+        headerSpans.push_back({Span{lineStart, colon}, Span{lineStart + valueStart, valueEnd - valueStart}});
+
+        if (equalsIgnoreCase(name, "Content-Length")) {
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string_view::npos || value.size() > 18) {
+                return fail(400, "Invalid Content-Length");
+            }
+            size_t length = std::stoull(std::string(value));
+            if (haveContentLength && length != contentLength) {
+                return fail(400, "Conflicting Content-Length headers");
+            }
+            haveContentLength = true;
+            contentLength = length;
+        } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+            haveTransferEncoding = true;
+            size_t lastComma = value.rfind(',');
+            std::string_view lastCoding = lastComma == std::string_view::npos ? value : value.substr(lastComma + 1);
+            while (!lastCoding.empty() && (lastCoding.front() == ' ' || lastCoding.front() == '\t')) lastCoding.remove_prefix(1);
+            if (!equalsIgnoreCase(lastCoding, "chunked")) {
+                return fail(501, "Unsupported transfer encoding");
+            }
+            chunked = true;
+        } else if (equalsIgnoreCase(name, "Connection")) {
+            if (containsToken(value, "close")) {
+                keepAlive = false;
+            } else if (containsToken(value, "keep-alive")) {
+                keepAlive = true;
+            }
+        } else if (equalsIgnoreCase(name, "Expect")) {
+            expectContinue = equalsIgnoreCase(value, "100-continue");
+        }
+    }
+
+    // A request carrying both framings is a smuggling vector; refuse it
+    if (haveTransferEncoding && haveContentLength) {
+        return fail(400, "Both Transfer-Encoding and Content-Length present");
+    }
+    if (contentLength > maxBodyBytes) {
+        return fail(413, "Request body too large");
+    }
+
+    view.keepAlive = keepAlive;
+    bodyStart = headerEnd;
+    scanOffset = headerEnd;
+    if (chunked) {
+        state = State::CHUNK_SIZE;
+        bodyLength = 0;
+    } else if (contentLength > 0) {
+        state = State::BODY;
+        bodyLength = contentLength;
+    } else {
+        state = State::DONE;
+        bodyLength = 0;
+    }
+    return HttpParseStatus::COMPLETE;
+}
+
+HttpParseStatus HttpRequestParser::parseChunked(char* data, size_t size) {
+    static const size_t MAX_CHUNK_LINE = 1024;
+    size_t lineEnd = 0;
+
+    while (state != State::DONE) {
+        switch (state) {
+            case State::CHUNK_SIZE: {
+                size_t next = findLineEnd(data, scanOffset, size, lineEnd);
+                if (next == std::string::npos) {
+                    if (size - scanOffset > MAX_CHUNK_LINE) {
+                        return fail(400, "Chunk size line too long");
+                    }
+                    return HttpParseStatus::INCOMPLETE;
+                }
+                std::string_view line(data + scanOffset, lineEnd - scanOffset);
+                size_t semicolon = line.find(';');
+                if (semicolon != std::string_view::npos) {
+                    line = line.substr(0, semicolon); // Ignore chunk extensions
+                }
+                while (!line.empty() && (line.back() == ' ' || line.back() == '\t')) line.remove_suffix(1);
+                if (line.empty() || line.size() > 15 ||
+                    line.find_first_not_of("0123456789abcdefABCDEF") != std::string_view::npos) {
+                    return fail(400, "Invalid chunk size");
+                }
+                size_t chunkSize = std::stoull(std::string(line), nullptr, 16);
+                scanOffset = next;
+                if (chunkSize == 0) {
+                    state = State::TRAILERS;
+                } else {
+                    if (bodyLength + chunkSize > maxBodyBytes) {
+                        return fail(413, "Request body too large");
+                    }
+                    chunkRemaining = chunkSize;
+                    state = State::CHUNK_DATA;
+                }
+                break;
+            }
+            case State::CHUNK_DATA: {
+                size_t available = std::min(size - scanOffset, chunkRemaining);
+                if (available == 0) {
+                    return HttpParseStatus::INCOMPLETE;
+                }
+                // Decode in place: chunk payload only ever moves towards the body start
+                std::memmove(data + bodyStart + bodyLength, data + scanOffset, available);
+                bodyLength += available;
+                scanOffset += available;
+                chunkRemaining -= available;
+                if (chunkRemaining == 0) {
+                    state = State::CHUNK_DATA_END;
+                }
+                break;
+            }
+            case State::CHUNK_DATA_END: {
+                size_t next = findLineEnd(data, scanOffset, size, lineEnd);
+                if (next == std::string::npos) {
+                    if (size - scanOffset >= 2) {
+                        return fail(400, "Missing CRLF after chunk data");
+                    }
+                    return HttpParseStatus::INCOMPLETE;
+                }
+                if (lineEnd != scanOffset) {
+                    return fail(400, "Missing CRLF after chunk data");
+                }
+                scanOffset = next;
+                state = State::CHUNK_SIZE;
+                break;
+            }
+            case State::TRAILERS: {
+                size_t next = findLineEnd(data, scanOffset, size, lineEnd);
+                if (next == std::string::npos) {
+                    if (size - scanOffset > maxHeaderBytes) {
+                        return fail(431, "Trailer fields too large");
+                    }
+                    return HttpParseStatus::INCOMPLETE;
+                }
+                bool blank = lineEnd == scanOffset;
+                scanOffset = next;
+                if (blank) {
+                    state = State::DONE;
+                }
+                break;
+            }
+            default:
+                return fail(500, "Invalid parser state");
+        }
+    }
+    return HttpParseStatus::COMPLETE;
+}
+
+void HttpRequestParser::buildView(const char* data) {
+    view.method = std::string_view(data + methodSpan.offset, methodSpan.length);
+    view.target = std::string_view(data + targetSpan.offset, targetSpan.length);
+    view.version = std::string_view(data + versionSpan.offset, versionSpan.length);
+
+    size_t question = view.target.find('?');
+    if (question == std::string_view::npos) {
+        view.path = view.target;
+        view.query = std::string_view();
+    } else {
+        view.path = view.target.substr(0, question);
+        view.query = view.target.substr(question + 1);
+    }
+
+    view.headers.clear();
+    for (const auto& span : headerSpans) {
+        view.headers.push_back({std::string_view(data + span.first.offset, span.first.length),
+                                std::string_view(data + span.second.offset, span.second.length)});
+    }
+
+    view.body = std::string_view(data + bodyStart, bodyLength);
+}
+
+// HttpConnectionBuffer implementation
+HttpConnectionBuffer::HttpConnectionBuffer(size_t initialCapacity) : start(0), end(0) {
+    buffer.resize(initialCapacity);
+}
+
+ssize_t HttpConnectionBuffer::fill(int fd, size_t readSize) {
+    if (buffer.size() - end < readSize) {
+        // Reclaim consumed space before growing
+        if (start > 0) {
+            std::memmove(&buffer[0], &buffer[start], end - start);
+            end -= start;
+            start = 0;
+        }
+        if (buffer.size() - end < readSize) {
+            buffer.resize(std::max(buffer.size() * 2, end + readSize));
+        }
+    }
+
+    ssize_t received = recv(fd, &buffer[end], readSize, 0);
+    if (received > 0) {
+        end += static_cast<size_t>(received);
+    }
+    return received;
+}
+
+void HttpConnectionBuffer::append(const char* bytes, size_t length) {
+    if (buffer.size() - end < length) {
+        if (start > 0) {
+            std::memmove(&buffer[0], &buffer[start], end - start);
+            end -= start;
+            start = 0;
+        }
+        if (buffer.size() - end < length) {
+            buffer.resize(std::max(buffer.size() * 2, end + length));
+        }
+    }
+    std::memcpy(&buffer[end], bytes, length);
+    end += length;
+}
+
+void HttpConnectionBuffer::consume(size_t length) {
+    start += std::min(length, end - start);
+    if (start == end) {
+        start = end = 0;
+    }
+}
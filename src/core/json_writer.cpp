@@ -0,0 +1,167 @@
+#include "json_writer.h"
+#include "json.hpp"
+#include <cmath>
+
+namespace {
+
+// Escape sequence for every byte that needs one, built once. Empty entries
+// are copied through unchanged.
+struct EscapeTable {
+    std::string sequences[256];
+
+    EscapeTable() {
+        static const char digits[] = "0123456789abcdef";
+        for (int c = 0; c < 0x20; c++) {
+            sequences[c] = std::string("\\u00") + digits[c >> 4] + digits[c & 0xF];
+        }
+        sequences[static_cast<unsigned char>('"')] = "\\\"";
+        sequences[static_cast<unsigned char>('\\')] = "\\\\";
+        sequences[static_cast<unsigned char>('\b')] = "\\b";
+        sequences[static_cast<unsigned char>('\f')] = "\\f";
+        sequences[static_cast<unsigned char>('\n')] = "\\n";
+        sequences[static_cast<unsigned char>('\r')] = "\\r";
+        sequences[static_cast<unsigned char>('\t')] = "\\t";
+    }
+};
+
+const EscapeTable& escapeTable() {
+    static const EscapeTable table;
+    return table;
+}
+
+} // namespace
+
+JsonWriter::JsonWriter(std::string& out, int indent) : out(out), indent(indent), afterKey(false) {}
+
+void JsonWriter::newline(size_t depth) {
+    out += '\n';
+    out.append(depth * static_cast<size_t>(indent), ' ');
+}
+
+void JsonWriter::beforeValue() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (empty.empty()) {
+        return;
+    }
+    if (!empty.back()) {
+        out += ',';
+    }
+    empty.back() = false;
+    if (indent >= 0) {
+        newline(empty.size());
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    beforeValue();
+    out += '{';
+    empty.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    bool wasEmpty = empty.back();
+    empty.pop_back();
+    if (indent >= 0 && !wasEmpty) {
+        newline(empty.size());
+    }
+    out += '}';
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    beforeValue();
+    out += '[';
+    empty.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    bool wasEmpty = empty.back();
+    empty.pop_back();
+    if (indent >= 0 && !wasEmpty) {
+        newline(empty.size());
+    }
+    out += ']';
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    beforeValue();
+    appendEscaped(out, name);
+    out += indent >= 0 ? ": " : ":";
+    afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    beforeValue();
+    appendEscaped(out, text);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    beforeValue();
+    out += flag ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    beforeValue();
+    if (!std::isfinite(number)) {
+        out += "null";
+        return *this;
+    }
+    // Same shortest round-trip formatting (and ".0" suffix) as nlohmann's dump
+    char buffer[64];
+    char* end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), number);
+    out.append(buffer, static_cast<size_t>(end - buffer));
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    beforeValue();
+    out += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::hex(std::string_view text) {
+    beforeValue();
+    // A cheap check keeps the output correct if a field loaded from disk or
+    // a peer is not actually hex
+    for (char c : text) {
+        if (static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\') {
+            appendEscaped(out, text);
+            return *this;
+        }
+    }
+    out += '"';
+    out.append(text.data(), text.size());
+    out += '"';
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json) {
+    beforeValue();
+    out.append(json.data(), json.size());
+    return *this;
+}
+
+void JsonWriter::appendEscaped(std::string& out, std::string_view text) {
+    const EscapeTable& table = escapeTable();
+    out += '"';
+    size_t runStart = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        const std::string& escaped = table.sequences[static_cast<unsigned char>(text[i])];
+        if (!escaped.empty()) {
+            out.append(text.data() + runStart, i - runStart);
+            out += escaped;
+            runStart = i + 1;
+        }
+    }
+    out.append(text.data() + runStart, text.size() - runStart);
+    out += '"';
+}
@@ -1,4 +1,4 @@
-#include "../include/logger.h"
+#include "logger.h"
 
 // Define static members
 std::mutex Logger::logMutex;
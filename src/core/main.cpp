@@ -80,12 +80,13 @@ std::string handleRequest(const std::string& request_data) {
                 }
             }
             
-            // Get the blocks
-            auto chain = blockchain.getChain();
-            size_t start = chain.size() > limit ? chain.size() - limit : 0;
+            // Get the blocks one at a time instead of copying the whole chain
+            size_t height = blockchain.getChainHeight();
+            size_t start = height > limit ? height - limit : 0;
             
-            for (size_t i = start; i < chain.size(); i++) {
-                nlohmann::json block_json = nlohmann::json::parse(chain[i].serialize());
+            Block block(0, "0");
+            for (size_t i = start; i < height && blockchain.getBlock(i, block); i++) {
+                nlohmann::json block_json = nlohmann::json::parse(block.serialize());
                 blocks.push_back(block_json);
             }
             
@@ -467,6 +468,9 @@ int main(int argc, char* argv[]) {
     Logger::info("******************************************************");
     
     int port = 5000;
+    double ipRate = 50.0, ipBurst = 100.0;
+    double senderRate = 1.0, senderBurst = 10.0;
+    size_t maxInFlight = 0;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -475,6 +479,16 @@ int main(int argc, char* argv[]) {
             port = std::stoi(argv[i + 1]);
             i++;
             Logger::info("Port set to: " + std::to_string(port));
+        } else if (arg == "--ip-rate" && i + 1 < argc) {
+            ipRate = std::stod(argv[++i]);
+        } else if (arg == "--ip-burst" && i + 1 < argc) {
+            ipBurst = std::stod(argv[++i]);
+        } else if (arg == "--sender-rate" && i + 1 < argc) {
+            senderRate = std::stod(argv[++i]);
+        } else if (arg == "--sender-burst" && i + 1 < argc) {
+            senderBurst = std::stod(argv[++i]);
+        } else if (arg == "--max-inflight" && i + 1 < argc) {
+            maxInFlight = std::stoul(argv[++i]);
         } else if (arg == "--debug") {
             Logger::setLevel(LogLevel::DEBUG);
             Logger::debug("Debug logging enabled");
@@ -498,6 +512,10 @@ int main(int argc, char* argv[]) {
     // Create and start API server
     Logger::info("Creating API server...");
     API api(blockchain);
+    api.setRateLimits(ipRate, ipBurst, senderRate, senderBurst);
+    if (maxInFlight > 0) {
+        api.setMaxInFlight(maxInFlight);
+    }
     Logger::info("Starting API server on port " + std::to_string(port));
     api.start(port);
     Logger::info("API server start called");
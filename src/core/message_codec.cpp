@@ -0,0 +1,247 @@
+#include "message_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <openssl/sha.h>
+#include <zlib.h>
+
+static void putUint16(char* out, uint16_t value) {
+    out[0] = static_cast<char>(value >> 8);
+    out[1] = static_cast<char>(value & 0xff);
+}
+
+static void putUint32(char* out, uint32_t value) {
+    out[0] = static_cast<char>(value >> 24);
+    out[1] = static_cast<char>((value >> 16) & 0xff);
+    out[2] = static_cast<char>((value >> 8) & 0xff);
+    out[3] = static_cast<char>(value & 0xff);
+}
+
+static uint16_t getUint16(const uint8_t* bytes) {
+    return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+}
+
+static uint32_t getUint32(const uint8_t* bytes) {
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+// FrameCodec implementation
+std::array<uint8_t, 4> FrameCodec::magicFor(const std::string& networkMagic) {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(networkMagic.data()), networkMagic.size(), digest);
+    return {digest[0], digest[1], digest[2], digest[3]};
+}
+
+uint32_t FrameCodec::checksum(std::string_view payload) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    // crc32() takes a uInt length, so feed very large payloads in pieces
+    while (!payload.empty()) {
+        size_t chunk = std::min<size_t>(payload.size(), 1u << 30);
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(payload.data()), static_cast<uInt>(chunk));
+        payload.remove_prefix(chunk);
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+void FrameCodec::encodeHeader(char* out, const std::array<uint8_t, 4>& magic, uint16_t type,
+                              std::string_view payload, uint16_t flags) {
+    encodeHeader(out, magic, type, static_cast<uint32_t>(payload.size()), checksum(payload), flags);
+}
+
+void FrameCodec::encodeHeader(char* out, const std::array<uint8_t, 4>& magic, uint16_t type,
+                              uint32_t length, uint32_t checksum, uint16_t flags) {
+    std::memcpy(out, magic.data(), magic.size());
+    putUint16(out + 4, type);
+    putUint16(out + 6, flags);
+    putUint32(out + 8, length);
+    putUint32(out + 12, checksum);
+}
+
+void FrameCodec::encode(std::string& out, const std::array<uint8_t, 4>& magic, uint16_t type,
+                        std::string_view payload, uint16_t flags) {
+    char header[FrameHeader::SIZE];
+    encodeHeader(header, magic, type, payload, flags);
+    out.reserve(out.size() + FrameHeader::SIZE + payload.size());
+    out.append(header, sizeof(header));
+    out.append(payload.data(), payload.size());
+}
+
+// FrameCompressor implementation
+FrameCompressor::FrameCompressor(int level) : deflaterReady(false), inflaterReady(false), level(level) {
+    std::memset(&deflater, 0, sizeof(deflater));
+    std::memset(&inflater, 0, sizeof(inflater));
+}
+
+FrameCompressor::~FrameCompressor() {
+    if (deflaterReady) {
+        deflateEnd(&deflater);
+    }
+    if (inflaterReady) {
+        inflateEnd(&inflater);
+    }
+}
+
+bool FrameCompressor::compress(std::string_view input, std::string& output) {
+    // Streams are set up on first use; many peers never need both
+    if (!deflaterReady) {
+        if (deflateInit(&deflater, level) != Z_OK) {
+            return false;
+        }
+        deflaterReady = true;
+    } else {
+        deflateReset(&deflater);
+    }
+
+    output.resize(deflateBound(&deflater, static_cast<uLong>(input.size())));
+    deflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    deflater.avail_in = static_cast<uInt>(input.size());
+    deflater.next_out = reinterpret_cast<Bytef*>(&output[0]);
+    deflater.avail_out = static_cast<uInt>(output.size());
+    if (deflate(&deflater, Z_FINISH) != Z_STREAM_END) {
+        return false;
+    }
+    output.resize(deflater.total_out);
+    return true;
+}
+
+bool FrameCompressor::decompress(std::string_view input, std::string& output, size_t maxSize) {
+    if (!inflaterReady) {
+        if (inflateInit(&inflater) != Z_OK) {
+            return false;
+        }
+        inflaterReady = true;
+    } else {
+        inflateReset(&inflater);
+    }
+
+    inflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    inflater.avail_in = static_cast<uInt>(input.size());
+    output.clear();
+    size_t produced = 0;
+    int result = Z_OK;
+    while (result != Z_STREAM_END) {
+        if (produced == output.size()) {
+            if (output.size() > maxSize) {
+                return false;   // Decompression bomb
+            }
+            // Grow geometrically, stopping one byte past the limit so an
+            // oversized stream is detected without inflating all of it
+            size_t grow = std::max<size_t>(std::max<size_t>(output.size(), input.size() * 4), 4096);
+            output.resize(output.size() + std::min(grow, maxSize + 1 - output.size()));
+        }
+        inflater.next_out = reinterpret_cast<Bytef*>(&output[produced]);
+        inflater.avail_out = static_cast<uInt>(output.size() - produced);
+        result = inflate(&inflater, Z_NO_FLUSH);
+        produced = output.size() - inflater.avail_out;
+        if (result == Z_BUF_ERROR && inflater.avail_in == 0) {
+            return false;   // Truncated stream
+        }
+        if (result != Z_OK && result != Z_BUF_ERROR && result != Z_STREAM_END) {
+            return false;
+        }
+    }
+    output.resize(produced);
+    return produced <= maxSize && inflater.avail_in == 0;
+}
+
+// FrameDecoder implementation
+FrameDecoder::FrameDecoder(const std::string& networkMagic, size_t maxPayloadSize, size_t initialCapacity)
+    : magic(FrameCodec::magicFor(networkMagic)), maxPayloadSize(maxPayloadSize),
+      initialCapacity(initialCapacity), start(0), end(0), pendingConsume(0) {
+    buffer.resize(initialCapacity);
+}
+
+void FrameDecoder::reserveTail(size_t length) {
+    // The frame handed out by the last next() call is released here, so its
+    // payload view stays valid until the caller asks for more data
+    start += pendingConsume;
+    pendingConsume = 0;
+    if (start == end) {
+        start = end = 0;
+        // Drop the space a large block needed once it has been handled
+        if (buffer.size() > initialCapacity * 4) {
+            std::string().swap(buffer);
+            buffer.resize(initialCapacity);
+        }
+    }
+
+    if (buffer.size() - end < length) {
+        // Reclaim consumed space before growing
+        if (start > 0) {
+            std::memmove(&buffer[0], &buffer[start], end - start);
+            end -= start;
+            start = 0;
+        }
+        if (buffer.size() - end < length) {
+            buffer.resize(std::max(buffer.size() * 2, end + length));
+        }
+    }
+}
+
+ssize_t FrameDecoder::fill(int fd, size_t readSize) {
+    reserveTail(readSize);
+    ssize_t received = recv(fd, &buffer[end], readSize, 0);
+    if (received > 0) {
+        end += static_cast<size_t>(received);
+    }
+    return received;
+}
+
+void FrameDecoder::append(const char* bytes, size_t length) {
+    reserveTail(length);
+    std::memcpy(&buffer[end], bytes, length);
+    end += length;
+}
+
+size_t FrameDecoder::bytesNeeded() const {
+    size_t available = buffered();
+    if (available < FrameHeader::SIZE) {
+        return FrameHeader::SIZE - available;
+    }
+    const uint8_t* header = reinterpret_cast<const uint8_t*>(&buffer[start + pendingConsume]);
+    size_t total = FrameHeader::SIZE + getUint32(header + 8);
+    return total > available ? total - available : 0;
+}
+
+FrameStatus FrameDecoder::next(FrameView& frame) {
+    if (!error.empty()) {
+        return FrameStatus::ERROR;
+    }
+
+    start += pendingConsume;
+    pendingConsume = 0;
+
+    size_t available = end - start;
+    if (available < FrameHeader::SIZE) {
+        return FrameStatus::INCOMPLETE;
+    }
+
+    const uint8_t* header = reinterpret_cast<const uint8_t*>(&buffer[start]);
+    if (!std::equal(magic.begin(), magic.end(), header)) {
+        error = "Bad network magic";
+        return FrameStatus::ERROR;
+    }
+
+    // Reject oversized frames from the header alone, before buffering them
+    uint32_t length = getUint32(header + 8);
+    if (length > maxPayloadSize) {
+        error = "Frame of " + std::to_string(length) + " bytes exceeds maxMessageSize";
+        return FrameStatus::ERROR;
+    }
+    if (available < FrameHeader::SIZE + length) {
+        return FrameStatus::INCOMPLETE;
+    }
+
+    std::string_view payload(&buffer[start + FrameHeader::SIZE], length);
+    if (FrameCodec::checksum(payload) != getUint32(header + 12)) {
+        error = "Frame checksum mismatch";
+        return FrameStatus::ERROR;
+    }
+
+    frame.type = getUint16(header + 4);
+    frame.flags = getUint16(header + 6);
+    frame.payload = payload;
+    pendingConsume = FrameHeader::SIZE + length;
+    return FrameStatus::FRAME;
+}
@@ -223,7 +223,8 @@ void MiningEngine::clearPendingTransactions() {
     Logger::info("Mining queue cleared");
 }
 
-Block MiningEngine::mineBlock(const std::string& minerAddress, uint64_t maxAttempts) {
+Block MiningEngine::mineBlock(const std::string& minerAddress, uint64_t maxAttempts,
+                              const std::atomic<bool>* cancelled) {
     auto startTime = std::chrono::steady_clock::now();
     
     // Create a new block
@@ -243,6 +244,9 @@ Block MiningEngine::mineBlock(const std::string& minerAddress, uint64_t maxAttem
         block.addTransaction(tx);
     }
     
+    // The header commits to the transactions through the merkle root
+    block.calculateMerkleRoot();
+    
     // Mine the block
     uint64_t nonce = 0;
     uint64_t blockchainDifficulty = blockchain.getDifficulty();
@@ -251,7 +255,7 @@ Block MiningEngine::mineBlock(const std::string& minerAddress, uint64_t maxAttem
     
     Logger::info("Starting to mine block " + std::to_string(blockIndex) + " with difficulty " + std::to_string(blockchainDifficulty));
     
-    while (!shouldStop && (maxAttempts == 0 || nonce < maxAttempts)) {
+    while (!shouldStop && (maxAttempts == 0 || nonce < maxAttempts) && !(cancelled && *cancelled)) {
         block.setNonce(nonce);
         block.updateHash(); // Update the block's stored hash
         blockHash = block.getHash(); // Get the updated hash
@@ -658,6 +662,211 @@ nlohmann::json MiningPool::getPoolStats() const {
     return stats;
 }
 
+// MiningJobInfo implementation
+std::string MiningJobInfo::stateName(MiningJobState state) {
+    switch (state) {
+        case MiningJobState::QUEUED: return "queued";
+        case MiningJobState::RUNNING: return "running";
+        case MiningJobState::COMPLETED: return "completed";
+        case MiningJobState::FAILED: return "failed";
+        case MiningJobState::CANCELLED: return "cancelled";
+    }
+    return "unknown";
+}
+
+nlohmann::json MiningJobInfo::toJson() const {
+    nlohmann::json j;
+    j["job_id"] = id;
+    j["miner_address"] = minerAddress;
+    j["state"] = stateName(state);
+    j["submitted_at"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+        submittedAt.time_since_epoch()).count();
+    if (isFinished()) {
+        j["finished_at"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+            finishedAt.time_since_epoch()).count();
+    }
+    if (state == MiningJobState::COMPLETED) {
+        j["block_index"] = blockIndex;
+        j["block_hash"] = blockHash;
+        j["reward"] = reward;
+    }
+    if (!error.empty()) {
+        j["error"] = error;
+    }
+    return j;
+}
+
+// MiningJobQueue implementation
+MiningJobQueue::MiningJobQueue(MiningEngine& miningEngine, Blockchain& blockchain,
+                               size_t maxQueued, size_t maxRetained)
+    : miningEngine(miningEngine), blockchain(blockchain), maxQueued(maxQueued),
+      maxRetained(maxRetained), nextJobId(1), running(false) {}
+
+MiningJobQueue::~MiningJobQueue() {
+    stop();
+}
+
+void MiningJobQueue::start() {
+    if (running) return;
+    running = true;
+    executor = std::thread(&MiningJobQueue::executorLoop, this);
+}
+
+void MiningJobQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        if (!running) return;
+        running = false;
+        if (current) {
+            current->cancelRequested = true;
+        }
+    }
+    jobsCV.notify_all();
+    if (executor.joinable()) {
+        executor.join();
+    }
+    
+    // Anything still queued will never run
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    while (!queue.empty()) {
+        auto job = queue.front();
+        queue.pop_front();
+        job->info.state = MiningJobState::CANCELLED;
+        job->info.error = "Server shutting down";
+        job->info.finishedAt = std::chrono::system_clock::now();
+    }
+}
+
+bool MiningJobQueue::submit(const std::string& minerAddress, std::string& id) {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    if (!running || queue.size() >= maxQueued) {
+        id.clear();
+        return false;
+    }
+    
+    auto job = std::make_shared<Job>();
+    job->info.id = "job-" + std::to_string(nextJobId++);
+    job->info.minerAddress = minerAddress;
+    job->info.submittedAt = std::chrono::system_clock::now();
+    
+    jobs[job->info.id] = job;
+    queue.push_back(job);
+    id = job->info.id;
+    jobsCV.notify_one();
+    return true;
+}
+
+bool MiningJobQueue::cancel(const std::string& id) {
+    std::shared_ptr<Job> job;
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        auto it = jobs.find(id);
+        if (it == jobs.end() || it->second->info.isFinished()) {
+            return false;
+        }
+        job = it->second;
+        job->cancelRequested = true;
+        
+        if (job->info.state == MiningJobState::RUNNING) {
+            // The executor notices the flag between nonces and finishes the job
+            return true;
+        }
+        queue.erase(std::remove(queue.begin(), queue.end(), job), queue.end());
+    }
+    finish(job, MiningJobState::CANCELLED, "Cancelled by client");
+    return true;
+}
+
+bool MiningJobQueue::getJob(const std::string& id, MiningJobInfo& out) const {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    auto it = jobs.find(id);
+    if (it == jobs.end()) {
+        return false;
+    }
+    out = it->second->info;
+    return true;
+}
+
+size_t MiningJobQueue::getQueueDepth() const {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    return queue.size();
+}
+
+void MiningJobQueue::setCompletionCallback(std::function<void(const MiningJobInfo&)> callback) {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    onFinished = std::move(callback);
+}
+
+void MiningJobQueue::finish(const std::shared_ptr<Job>& job, MiningJobState state, const std::string& error) {
+    MiningJobInfo info;
+    std::function<void(const MiningJobInfo&)> callback;
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        job->info.state = state;
+        job->info.error = error;
+        job->info.finishedAt = std::chrono::system_clock::now();
+        info = job->info;
+        callback = onFinished;
+        
+        // Forget the oldest finished jobs once over the retention limit
+        finishedOrder.push_back(job->info.id);
+        while (finishedOrder.size() > maxRetained) {
+            jobs.erase(finishedOrder.front());
+            finishedOrder.pop_front();
+        }
+    }
+    if (callback) {
+        callback(info);
+    }
+}
+
+void MiningJobQueue::executorLoop() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsCV.wait(lock, [this] { return !running || !queue.empty(); });
+            if (!running) {
+                break;
+            }
+            job = queue.front();
+            queue.pop_front();
+            job->info.state = MiningJobState::RUNNING;
+            current = job;
+        }
+        
+        try {
+            Block block = miningEngine.mineBlock(job->info.minerAddress, 0, &job->cancelRequested);
+            
+            // A cancel that lands after a solution was found is too late;
+            // the mined block is still connected rather than thrown away
+            if (block.getHash().empty() || block.getIndex() == static_cast<uint64_t>(-1)) {
+                if (job->cancelRequested) {
+                    finish(job, MiningJobState::CANCELLED, running ? "Cancelled by client" : "Server shutting down");
+                } else {
+                    finish(job, MiningJobState::FAILED, "Failed to mine block");
+                }
+            } else if (!blockchain.addBlock(block)) {
+                // Another block won the race for this height
+                finish(job, MiningJobState::FAILED, "Failed to add block to blockchain");
+            } else {
+                {
+                    std::lock_guard<std::mutex> lock(jobsMutex);
+                    job->info.blockIndex = block.getIndex();
+                    job->info.blockHash = block.getHash();
+                    job->info.reward = miningEngine.calculateBlockReward(block.getIndex());
+                }
+                finish(job, MiningJobState::COMPLETED, "");
+            }
+        } catch (const std::exception& e) {
+            finish(job, MiningJobState::FAILED, e.what());
+        }
+        
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        current.reset();
+    }
+}
+
 // ConsensusEngine implementation
 ConsensusEngine::ConsensusEngine(Blockchain& blockchain, MiningEngine& miningEngine)
     : blockchain(blockchain), miningEngine(miningEngine) {
@@ -0,0 +1,506 @@
+#include "netsim.h"
+#include "logger.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// SimulatedLink implementation
+SimulatedLink::SimulatedLink(uint16_t targetPort, const LinkProfile& profile, uint64_t seed)
+    : profile(profile), targetPort(targetPort), listener(-1), port(0), running(false), rng(seed),
+      bytesForwarded(0) {}
+
+SimulatedLink::~SimulatedLink() {
+    stop();
+}
+
+bool SimulatedLink::start() {
+    listener = NetworkUtils::createSocket();
+    if (listener < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (!NetworkUtils::bindSocket(listener, "127.0.0.1", 0) || !NetworkUtils::listenSocket(listener, 16)) {
+        NetworkUtils::closeSocket(listener);
+        listener = -1;
+        return false;
+    }
+
+    struct sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &length);
+    port = ntohs(addr.sin_port);
+
+    running = true;
+    acceptor = std::thread(&SimulatedLink::acceptLoop, this);
+    return true;
+}
+
+void SimulatedLink::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    // Shutting the sockets down wakes every blocked accept, recv and send
+    shutdown(listener, SHUT_RDWR);
+    {
+        std::lock_guard<std::mutex> lock(pipesMutex);
+        for (int socket : sockets) {
+            shutdown(socket, SHUT_RDWR);
+        }
+        for (auto& pipe : pipes) {
+            std::lock_guard<std::mutex> pipeLock(pipe->mutex);
+            pipe->closed = true;
+            pipe->ready.notify_all();
+        }
+    }
+    if (acceptor.joinable()) {
+        acceptor.join();
+    }
+    for (auto& pipe : pipes) {
+        pipe->reader.join();
+        pipe->writer.join();
+    }
+    for (int socket : sockets) {
+        NetworkUtils::closeSocket(socket);
+    }
+    pipes.clear();
+    sockets.clear();
+    NetworkUtils::closeSocket(listener);
+    listener = -1;
+}
+
+void SimulatedLink::acceptLoop() {
+    while (running) {
+        std::string address;
+        uint16_t clientPort;
+        int client = NetworkUtils::acceptConnection(listener, address, clientPort);
+        if (client < 0) {
+            if (!running) {
+                return;
+            }
+            continue;
+        }
+
+        int server = NetworkUtils::createSocket();
+        if (server < 0 || !NetworkUtils::connectSocket(server, "127.0.0.1", targetPort)) {
+            NetworkUtils::closeSocket(client);
+            if (server >= 0) {
+                NetworkUtils::closeSocket(server);
+            }
+            continue;
+        }
+
+        // Shaping happens here; Nagle would only add its own delay on top
+        int one = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::lock_guard<std::mutex> lock(pipesMutex);
+        if (!running) {
+            NetworkUtils::closeSocket(client);
+            NetworkUtils::closeSocket(server);
+            return;
+        }
+        sockets.push_back(client);
+        sockets.push_back(server);
+        startPipe(client, server);
+        startPipe(server, client);
+    }
+}
+
+void SimulatedLink::startPipe(int from, int to) {
+    auto pipe = std::make_unique<Pipe>();
+    pipe->from = from;
+    pipe->to = to;
+    Pipe& ref = *pipe;
+    uint64_t seed = rng();
+    pipes.push_back(std::move(pipe));
+    ref.reader = std::thread(&SimulatedLink::readLoop, this, std::ref(ref), seed);
+    ref.writer = std::thread(&SimulatedLink::writeLoop, this, std::ref(ref));
+}
+
+void SimulatedLink::readLoop(Pipe& pipe, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    auto lastDeparture = std::chrono::steady_clock::now();
+    auto lastDelivery = lastDeparture;
+    std::string buffer(16384, '\0');
+
+    while (true) {
+        ssize_t received = recv(pipe.from, &buffer[0], buffer.size(), 0);
+        if (received <= 0) {
+            break;
+        }
+
+        // Serialization: the chunk leaves once the link has sent what was
+        // ahead of it, and not before it has all been put on the wire
+        auto now = std::chrono::steady_clock::now();
+        auto departure = std::max(now, lastDeparture);
+        if (profile.bandwidth > 0) {
+            departure += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(received / profile.bandwidth));
+        }
+        lastDeparture = departure;
+        std::this_thread::sleep_until(departure);
+
+        auto deliverAt = departure + profile.latency;
+        if (profile.loss > 0) {
+            double segments = std::ceil(received / 1460.0);
+            if (chance(random) < 1 - std::pow(1 - profile.loss, segments)) {
+                deliverAt += profile.retransmitDelay;
+            }
+        }
+        // In-order delivery: a retransmission holds up everything behind it
+        deliverAt = std::max(deliverAt, lastDelivery);
+        lastDelivery = deliverAt;
+
+        std::lock_guard<std::mutex> lock(pipe.mutex);
+        pipe.queue.push_back(Segment{deliverAt, buffer.substr(0, static_cast<size_t>(received))});
+        pipe.ready.notify_one();
+    }
+
+    std::lock_guard<std::mutex> lock(pipe.mutex);
+    pipe.closed = true;
+    pipe.ready.notify_one();
+}
+
+void SimulatedLink::writeLoop(Pipe& pipe) {
+    while (true) {
+        Segment segment;
+        {
+            std::unique_lock<std::mutex> lock(pipe.mutex);
+            pipe.ready.wait(lock, [&pipe]() { return pipe.closed || !pipe.queue.empty(); });
+            if (pipe.queue.empty()) {
+                break;   // Closed and drained
+            }
+            segment = std::move(pipe.queue.front());
+            pipe.queue.pop_front();
+        }
+
+        std::this_thread::sleep_until(segment.deliverAt);
+        size_t offset = 0;
+        while (offset < segment.bytes.size()) {
+            ssize_t sent = send(pipe.to, segment.bytes.data() + offset, segment.bytes.size() - offset, MSG_NOSIGNAL);
+            if (sent <= 0) {
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                shutdown(pipe.from, SHUT_RDWR);
+                return;
+            }
+            offset += static_cast<size_t>(sent);
+        }
+        bytesForwarded += segment.bytes.size();
+    }
+
+    // Pass the close on; the other direction then winds down too
+    shutdown(pipe.to, SHUT_RDWR);
+}
+
+// LatencySummary implementation
+LatencySummary LatencySummary::of(std::vector<double> samples, size_t expected) {
+    LatencySummary summary;
+    summary.count = samples.size();
+    summary.expected = expected;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&samples](double quantile) {
+        size_t index = static_cast<size_t>(std::ceil(quantile * samples.size()));
+        return samples[std::min(samples.size(), std::max<size_t>(1, index)) - 1];
+    };
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary.p50 = rank(0.50);
+    summary.p90 = rank(0.90);
+    summary.p99 = rank(0.99);
+    summary.max = samples.back();
+    return summary;
+}
+
+nlohmann::json LatencySummary::toJson() const {
+    return {
+        {"count", count},
+        {"expected", expected},
+        {"meanMillis", mean},
+        {"p50Millis", p50},
+        {"p90Millis", p90},
+        {"p99Millis", p99},
+        {"maxMillis", max}
+    };
+}
+
+std::string LatencySummary::toString() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << count << "/" << expected << " delivered, "
+        << "p50 " << p50 << " ms, p90 " << p90 << " ms, p99 " << p99 << " ms, max " << max << " ms";
+    return out.str();
+}
+
+nlohmann::json SyncResult::toJson() const {
+    return {
+        {"completed", completed},
+        {"blocks", blocks},
+        {"seconds", seconds},
+        {"bytesReceived", bytesReceived},
+        {"blocksPerSecond", blocksPerSecond()},
+        {"bytesPerSecond", bytesPerSecond()}
+    };
+}
+
+// SimulatedNetwork implementation
+SimulatedNetwork::SimulatedNetwork(const SimulationConfig& config)
+    : config(config), rng(config.seed), transactionCounter(0) {}
+
+SimulatedNetwork::~SimulatedNetwork() {
+    stop();
+}
+
+bool SimulatedNetwork::buildNodes() {
+    // Genesis blocks carry a timestamp; retry until every chain was
+    // created within the same second
+    for (int attempt = 0; attempt < 5; attempt++) {
+        nodes.clear();
+        for (size_t i = 0; i <= config.nodes; i++) {
+            auto node = std::make_unique<Node>();
+            node->chain = std::make_unique<Blockchain>();
+            nodes.push_back(std::move(node));
+        }
+        std::string genesis = nodes[0]->chain->getLatestBlock().getHash();
+        bool shared = std::all_of(nodes.begin(), nodes.end(), [&genesis](const std::unique_ptr<Node>& node) {
+            return node->chain->getLatestBlock().getHash() == genesis;
+        });
+        if (shared) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SimulatedNetwork::startNode(size_t index) {
+    Node& node = *nodes[index];
+    node.chain->setDifficulty(config.difficulty);
+    node.miner = std::make_unique<MiningEngine>(*node.chain);
+
+    NetworkConfig network = config.network;
+    network.listenPort = static_cast<uint16_t>(config.basePort + index);
+    network.bindAddress = "127.0.0.1";
+    network.addressBookPath.clear();   // Nodes share a working directory
+    node.port = network.listenPort;
+    node.engine = std::make_unique<NetworkEngine>(*node.chain, *node.miner, network);
+    return node.engine->start();
+}
+
+bool SimulatedNetwork::start() {
+    if (config.nodes < 2 || !buildNodes()) {
+        Logger::error("Simulation: could not build nodes with a shared genesis block");
+        return false;
+    }
+    for (size_t i = 0; i < config.nodes; i++) {
+        if (!startNode(i)) {
+            Logger::error("Simulation: node " + std::to_string(i) + " failed to start");
+            return false;
+        }
+    }
+
+    // Each node dials a few distinct random peers; a ring underneath keeps
+    // the graph connected whatever the draw
+    for (size_t i = 0; i < config.nodes; i++) {
+        std::vector<size_t> targets{(i + 1) % config.nodes};
+        std::vector<size_t> others;
+        for (size_t j = 0; j < config.nodes; j++) {
+            if (j != i && j != targets[0]) {
+                others.push_back(j);
+            }
+        }
+        std::shuffle(others.begin(), others.end(), rng);
+        size_t extra = std::min(others.size(), config.outboundPerNode > 0 ? config.outboundPerNode - 1 : 0);
+        targets.insert(targets.end(), others.begin(), others.begin() + extra);
+        for (size_t target : targets) {
+            if (!connect(i, target)) {
+                return false;
+            }
+        }
+    }
+
+    // Wait for every connection to be up in both directions
+    size_t expected = links.size() * 2;
+    return waitFor([this, expected]() {
+        size_t connected = 0;
+        for (size_t i = 0; i < config.nodes; i++) {
+            connected += nodes[i]->engine->getActiveConnections();
+        }
+        return connected >= expected;
+    }, std::chrono::duration_cast<std::chrono::milliseconds>(config.timeout));
+}
+
+void SimulatedNetwork::stop() {
+    for (auto& node : nodes) {
+        if (node->engine) {
+            node->engine->stop();
+        }
+    }
+    for (auto& link : links) {
+        link->stop();
+    }
+    links.clear();
+}
+
+bool SimulatedNetwork::connect(size_t from, size_t to) {
+    auto link = std::make_unique<SimulatedLink>(nodes[to]->port, config.link, rng());
+    if (!link->start()) {
+        return false;
+    }
+    uint16_t linkPort = link->getPort();
+    links.push_back(std::move(link));
+    return nodes[from]->engine->connectToPeer("127.0.0.1", linkPort);
+}
+
+bool SimulatedNetwork::waitFor(const std::function<bool()>& done, std::chrono::milliseconds timeout) const {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    return true;
+}
+
+bool SimulatedNetwork::waitForChains(size_t height, size_t count) {
+    return waitFor([this, height, count]() {
+        for (size_t i = 0; i < count; i++) {
+            if (nodes[i]->chain->getChainHeight() < height) {
+                return false;
+            }
+        }
+        return true;
+    }, std::chrono::duration_cast<std::chrono::milliseconds>(config.timeout));
+}
+
+std::vector<double> SimulatedNetwork::propagateBlock(size_t miner, size_t transactions) {
+    // Let the transactions reach every pool first, as they would between
+    // blocks, so the block relays as a compact block
+    propagateTransactions(miner, transactions);
+
+    Blockchain& chain = *nodes[miner]->chain;
+    auto start = std::chrono::steady_clock::now();
+    Block block = chain.minePendingTransactions("sim-miner-" + std::to_string(miner));
+    nodes[miner]->engine->broadcastBlock(block);
+    size_t height = block.getIndex() + 1;
+
+    std::vector<double> samples;
+    std::vector<bool> arrived(config.nodes, false);
+    arrived[miner] = true;
+    waitFor([&]() {
+        auto now = std::chrono::steady_clock::now();
+        bool all = true;
+        for (size_t i = 0; i < config.nodes; i++) {
+            if (arrived[i]) {
+                continue;
+            }
+            if (nodes[i]->chain->getChainHeight() >= height) {
+                arrived[i] = true;
+                samples.push_back(std::chrono::duration<double, std::milli>(now - start).count());
+            } else {
+                all = false;
+            }
+        }
+        return all;
+    }, std::chrono::duration_cast<std::chrono::milliseconds>(config.timeout));
+    return samples;
+}
+
+std::vector<double> SimulatedNetwork::propagateTransactions(size_t origin, size_t count) {
+    std::vector<size_t> baseline(config.nodes);
+    for (size_t i = 0; i < config.nodes; i++) {
+        baseline[i] = nodes[i]->chain->getPendingTransactionCount();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+        Transaction transaction("GENESIS", "sim-" + std::to_string(transactionCounter++), 0.001);
+        if (nodes[origin]->chain->addTransaction(transaction)) {
+            nodes[origin]->engine->broadcastTransaction(transaction);
+        }
+    }
+
+    // One sample per transaction per node, stamped when the pool grew
+    std::vector<double> samples;
+    std::vector<size_t> seen(config.nodes, count);
+    for (size_t i = 0; i < config.nodes; i++) {
+        if (i != origin) {
+            seen[i] = 0;
+        }
+    }
+    waitFor([&]() {
+        auto now = std::chrono::steady_clock::now();
+        bool all = true;
+        for (size_t i = 0; i < config.nodes; i++) {
+            size_t pending = nodes[i]->chain->getPendingTransactionCount();
+            size_t have = std::min(count, pending > baseline[i] ? pending - baseline[i] : 0);
+            for (; seen[i] < have; seen[i]++) {
+                samples.push_back(std::chrono::duration<double, std::milli>(now - start).count());
+            }
+            all = all && seen[i] >= count;
+        }
+        return all;
+    }, std::chrono::duration_cast<std::chrono::milliseconds>(config.timeout));
+    return samples;
+}
+
+SyncResult SimulatedNetwork::syncNewNode(size_t blocks, size_t transactionsPerBlock) {
+    SyncResult result;
+    Blockchain& source = *nodes[0]->chain;
+    for (size_t b = 0; b < blocks; b++) {
+        for (size_t t = 0; t < transactionsPerBlock; t++) {
+            source.addTransaction(Transaction("GENESIS", "sim-" + std::to_string(transactionCounter++), 0.001));
+        }
+        source.minePendingTransactions("sim-miner-0");
+    }
+
+    // The rest of the network catches up through its own header polling
+    size_t height = source.getChainHeight();
+    if (!waitForChains(height, config.nodes)) {
+        Logger::warning("Simulation: network did not converge before the sync run");
+    }
+
+    size_t joiner = standby();
+    if (!startNode(joiner)) {
+        return result;
+    }
+    std::vector<size_t> targets(config.nodes);
+    std::iota(targets.begin(), targets.end(), 0);
+    std::shuffle(targets.begin(), targets.end(), rng);
+    targets.resize(std::min(targets.size(), std::max<size_t>(1, config.outboundPerNode)));
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t target : targets) {
+        connect(joiner, target);
+    }
+    Blockchain& chain = *nodes[joiner]->chain;
+    result.completed = waitFor([&chain, height]() { return chain.getChainHeight() >= height; },
+                               std::chrono::duration_cast<std::chrono::milliseconds>(config.timeout));
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.blocks = chain.getChainHeight() - 1;
+    result.bytesReceived = nodes[joiner]->engine->getNetworkStats().value("totalBytesReceived", 0ULL);
+    return result;
+}
+
+uint64_t SimulatedNetwork::getLinkBytes() const {
+    uint64_t total = 0;
+    for (const auto& link : links) {
+        total += link->getBytesForwarded();
+    }
+    return total;
+}
@@ -0,0 +1,129 @@
+#include "netsim.h"
+#include "logger.h"
+#include <iostream>
+#include <iomanip>
+
+// Runs a fixed set of scenarios against an in-process network and prints
+// propagation percentiles and sync throughput. Exits non-zero if any step
+// timed out, so it can gate a build.
+static void printUsage() {
+    std::cout << "Usage: nilotic_netsim [options]\n"
+              << "  --nodes N              Nodes in the network (default 8)\n"
+              << "  --degree N             Outbound peers per node (default 3)\n"
+              << "  --latency-ms MS        One-way link latency (default 0)\n"
+              << "  --bandwidth-mbit MBIT  Per-direction link bandwidth, 0 for unlimited (default 0)\n"
+              << "  --loss P               Segment loss probability, 0..1 (default 0)\n"
+              << "  --blocks N             Block propagation rounds (default 5)\n"
+              << "  --txs N                Transactions per round (default 50)\n"
+              << "  --sync-blocks N        Blocks for the initial sync run, 0 to skip (default 200)\n"
+              << "  --seed N               Topology and loss seed (default 1)\n"
+              << "  --base-port PORT       First node's listen port (default 19000)\n"
+              << "  --timeout S            Per-step timeout in seconds (default 30)\n"
+              << "  --json                 Print the report as JSON\n";
+}
+
+int main(int argc, char* argv[]) {
+    SimulationConfig config;
+    config.network.blockSyncInterval = 1;
+    config.network.transactionBroadcastInterval = 1;
+    size_t rounds = 5;
+    size_t transactions = 50;
+    size_t syncBlocks = 200;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--nodes" && hasValue) {
+            config.nodes = std::stoul(argv[++i]);
+        } else if (arg == "--degree" && hasValue) {
+            config.outboundPerNode = std::stoul(argv[++i]);
+        } else if (arg == "--latency-ms" && hasValue) {
+            config.link.latency = std::chrono::microseconds(static_cast<int64_t>(std::stod(argv[++i]) * 1000));
+        } else if (arg == "--bandwidth-mbit" && hasValue) {
+            config.link.bandwidth = std::stod(argv[++i]) * 1000 * 1000 / 8;
+        } else if (arg == "--loss" && hasValue) {
+            config.link.loss = std::stod(argv[++i]);
+        } else if (arg == "--blocks" && hasValue) {
+            rounds = std::stoul(argv[++i]);
+        } else if (arg == "--txs" && hasValue) {
+            transactions = std::stoul(argv[++i]);
+        } else if (arg == "--sync-blocks" && hasValue) {
+            syncBlocks = std::stoul(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            config.seed = std::stoull(argv[++i]);
+        } else if (arg == "--base-port" && hasValue) {
+            config.basePort = static_cast<uint16_t>(std::stoul(argv[++i]));
+        } else if (arg == "--timeout" && hasValue) {
+            config.timeout = std::chrono::seconds(std::stoul(argv[++i]));
+        } else if (arg == "--json") {
+            json = true;
+        } else {
+            printUsage();
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+
+    Logger::setLevel(LogLevel::WARNING);
+    SimulatedNetwork network(config);
+    if (!network.start()) {
+        std::cerr << "Failed to start the simulated network" << std::endl;
+        return 1;
+    }
+
+    // Alternate the origin so no single node's position skews the numbers
+    std::vector<double> blockSamples;
+    std::vector<double> transactionSamples;
+    for (size_t round = 0; round < rounds; round++) {
+        size_t origin = round % config.nodes;
+        std::vector<double> sent = network.propagateTransactions((origin + 1) % config.nodes, transactions);
+        transactionSamples.insert(transactionSamples.end(), sent.begin(), sent.end());
+        std::vector<double> mined = network.propagateBlock(origin, 0);
+        blockSamples.insert(blockSamples.end(), mined.begin(), mined.end());
+    }
+    LatencySummary blockSummary = LatencySummary::of(blockSamples, rounds * (config.nodes - 1));
+    LatencySummary transactionSummary = LatencySummary::of(transactionSamples, rounds * transactions * (config.nodes - 1));
+
+    SyncResult sync;
+    if (syncBlocks > 0) {
+        sync = network.syncNewNode(syncBlocks, 10);
+    }
+    uint64_t linkBytes = network.getLinkBytes();
+    network.stop();
+
+    bool complete = blockSummary.count == blockSummary.expected &&
+                    transactionSummary.count == transactionSummary.expected &&
+                    (syncBlocks == 0 || sync.completed);
+
+    if (json) {
+        nlohmann::json report;
+        report["nodes"] = config.nodes;
+        report["degree"] = config.outboundPerNode;
+        report["latencyMillis"] = config.link.latency.count() / 1000.0;
+        report["bandwidthBytesPerSecond"] = config.link.bandwidth;
+        report["loss"] = config.link.loss;
+        report["blockPropagation"] = blockSummary.toJson();
+        report["transactionPropagation"] = transactionSummary.toJson();
+        if (syncBlocks > 0) {
+            report["sync"] = sync.toJson();
+        }
+        report["linkBytes"] = linkBytes;
+        report["complete"] = complete;
+        std::cout << report.dump(2) << std::endl;
+    } else {
+        std::cout << std::fixed << std::setprecision(1)
+                  << "Network: " << config.nodes << " nodes, " << config.outboundPerNode << " outbound each, "
+                  << config.link.latency.count() / 1000.0 << " ms latency, "
+                  << (config.link.bandwidth > 0 ? std::to_string(config.link.bandwidth * 8 / 1e6) + " Mbit/s" : "unlimited")
+                  << ", loss " << config.link.loss << "\n"
+                  << "Block propagation:       " << blockSummary.toString() << "\n"
+                  << "Transaction propagation: " << transactionSummary.toString() << "\n";
+        if (syncBlocks > 0) {
+            std::cout << "Initial sync:            " << sync.blocks << " blocks in " << sync.seconds << " s, "
+                      << sync.blocksPerSecond() << " blocks/s, " << sync.bytesPerSecond() / 1024 << " KB/s"
+                      << (sync.completed ? "" : " (timed out)") << "\n";
+        }
+        std::cout << "Bytes over links:        " << linkBytes << std::endl;
+    }
+    return complete ? 0 : 1;
+}
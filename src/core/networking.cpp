@@ -3,11 +3,17 @@
 #include "logger.h"
 #include <algorithm>
 #include <random>
+#include <cmath>
+#include <future>
 #include <cstring>
 #include <unistd.h>
 #include <fcntl.h>
 #include <netdb.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
 
 // NetworkMessage implementation
 std::string NetworkMessage::serialize() const {
@@ -22,10 +28,26 @@ std::string NetworkMessage::serialize() const {
     return json.dump();
 }
 
-NetworkMessage NetworkMessage::deserialize(const std::string& data) {
+// SerializedMessage implementation
+SerializedMessage::SerializedMessage(const NetworkMessage& message)
+    : type(message.type), payload(std::make_shared<const std::string>(message.serialize())),
+      checksum(FrameCodec::checksum(*payload)), compressedChecksum(0) {}
+
+const std::shared_ptr<const std::string>& SerializedMessage::getCompressed(FrameCompressor& compressor) const {
+    std::call_once(compressOnce, [this, &compressor]() {
+        std::string output;
+        if (compressor.compress(*payload, output) && output.size() < payload->size()) {
+            compressedChecksum = FrameCodec::checksum(output);
+            compressed = std::make_shared<const std::string>(std::move(output));
+        }
+    });
+    return compressed;
+}
+
+NetworkMessage NetworkMessage::deserialize(std::string_view data) {
     NetworkMessage message;
     try {
-        nlohmann::json json = nlohmann::json::parse(data);
+        nlohmann::json json = nlohmann::json::parse(data.begin(), data.end());
         message.type = static_cast<MessageType>(json["type"].get<int>());
         message.sender = json["sender"];
         message.recipient = json["recipient"];
@@ -89,15 +111,37 @@ PeerNode PeerNode::fromJson(const nlohmann::json& json) {
     return peer;
 }
 
+// BandwidthLimits implementation
+BandwidthLimits::BandwidthLimits(uint64_t uploadRate, uint64_t downloadRate)
+    : limitUpload(uploadRate > 0), limitDownload(downloadRate > 0),
+      upload(static_cast<double>(uploadRate), std::max(64.0 * 1024, uploadRate / 4.0)),
+      download(static_cast<double>(downloadRate), std::max(64.0 * 1024, downloadRate / 4.0)),
+      throttledWrites(0), throttledReads(0) {}
+
 // NetworkConnection implementation
-NetworkConnection::NetworkConnection(int fd, const std::string& address, uint16_t port)
-    : socketFd(fd), remoteAddress(address), remotePort(port), state(ConnectionState::DISCONNECTED),
-      shouldClose(false), bytesReceived(0), bytesSent(0), messagesReceived(0), messagesSent(0) {
+NetworkConnection::NetworkConnection(Reactor& reactor, int fd, const std::string& address, uint16_t port,
+                                     const NetworkConfig& config)
+    : reactor(reactor), socketFd(fd), remoteAddress(address), remotePort(port),
+      state(ConnectionState::DISCONNECTED), shouldClose(false), flushScheduled(false),
+      sendBufferLimit(std::max<uint64_t>(64 * 1024, config.sendBufferBytes)),
+      slowPeerTimeout(std::chrono::seconds(config.slowPeerTimeout)), queuedBytes(0), congestedSince(0),
+      readPaused(false), writePaused(false), overflowed(false),
+      magic(FrameCodec::magicFor(config.networkMagic)), decoder(config.networkMagic, config.maxMessageSize),
+      wantWrite(false), wantRead(true), zeroCopy(config.enableZeroCopy), zeroCopyThreshold(config.zeroCopyThreshold),
+      zeroCopySequence(0), compressor(config.compressionLevel), compressOutbound(false),
+      acceptCompressed(config.enableCompression), compressionThreshold(config.compressionThreshold),
+      maxPayloadSize(config.maxMessageSize), bytesReceived(0), bytesSent(0), messagesReceived(0),
+      messagesSent(0), writeSyscalls(0), compressionSaved(0), messagesShed(0),
+      connectedAt(std::chrono::steady_clock::now()) {
     updateActivity();
 }
 
 NetworkConnection::~NetworkConnection() {
-    disconnect();
+    // Normally already closed on the reactor thread
+    if (socketFd >= 0) {
+        reactor.remove(socketFd);
+        NetworkUtils::closeSocket(socketFd);
+    }
 }
 
 bool NetworkConnection::connect() {
@@ -117,37 +161,34 @@ bool NetworkConnection::connect() {
     addr.sin_port = htons(remotePort);
     addr.sin_addr.s_addr = inet_addr(remoteAddress.c_str());
     
+    // Accepted sockets are already connected and report EISCONN
     int result = ::connect(socketFd, (struct sockaddr*)&addr, sizeof(addr));
-    if (result < 0 && errno != EINPROGRESS) {
+    bool established = result == 0 || errno == EISCONN;
+    if (!established && errno != EINPROGRESS) {
         Logger::error("Failed to connect to " + getFullAddress());
         state = ConnectionState::DISCONNECTED;
         return false;
     }
     
-    // Wait for connection to complete
-    fd_set writefds;
-    FD_ZERO(&writefds);
-    FD_SET(socketFd, &writefds);
-    
-    struct timeval timeout;
-    timeout.tv_sec = 10;
-    timeout.tv_usec = 0;
-    
-    result = select(socketFd + 1, nullptr, &writefds, nullptr, &timeout);
-    if (result <= 0) {
-        Logger::error("Connection timeout to " + getFullAddress());
+    // Outbound connects finish when the socket turns writable
+    if (established) {
+        state = ConnectionState::CONNECTED;
+    }
+    std::weak_ptr<NetworkConnection> weak = weak_from_this();
+    if (!reactor.add(socketFd, established ? EPOLLIN : EPOLLOUT, [weak](uint32_t events) {
+            if (auto self = weak.lock()) {
+                self->handleEvents(events);
+            }
+        })) {
         state = ConnectionState::DISCONNECTED;
         return false;
     }
     
-    state = ConnectionState::CONNECTED;
-    updateActivity();
-    
-    // Start read and write threads
-    readThread = std::thread(&NetworkConnection::readLoop, this);
-    writeThread = std::thread(&NetworkConnection::writeLoop, this);
-    
-    Logger::info("Connected to " + getFullAddress());
+    if (established) {
+        enableZeroCopy();
+        updateActivity();
+        Logger::info("Connected to " + getFullAddress());
+    }
     return true;
 }
 
@@ -157,53 +198,84 @@ void NetworkConnection::disconnect() {
     }
     
     shouldClose = true;
-    state = ConnectionState::DISCONNECTING;
-    
-    // Wake up threads
-    queueCV.notify_all();
     
-    if (readThread.joinable()) {
-        readThread.join();
+    // The socket belongs to the reactor thread while the reactor runs
+    auto self = weak_from_this().lock();
+    if (!self || reactor.inLoopThread() || !reactor.isRunning()) {
+        closeNow();
+        return;
     }
-    if (writeThread.joinable()) {
-        writeThread.join();
+    reactor.post([self]() { self->closeNow(); });
+}
+
+void NetworkConnection::closeNow() {
+    ConnectionState previous = state.exchange(ConnectionState::DISCONNECTED);
+    if (previous == ConnectionState::DISCONNECTED) {
+        return;
     }
     
+    reactor.remove(socketFd);
     NetworkUtils::closeSocket(socketFd);
-    state = ConnectionState::DISCONNECTED;
+    socketFd = -1;
     
     Logger::info("Disconnected from " + getFullAddress());
+    if (closeHandler) {
+        closeHandler(*this);
+    }
 }
 
 bool NetworkConnection::sendMessage(const NetworkMessage& message) {
-    if (state != ConnectionState::CONNECTED) {
+    ConnectionState current = state;
+    if (current != ConnectionState::CONNECTED && current != ConnectionState::CONNECTING) {
         return false;
     }
-    
-    std::lock_guard<std::mutex> lock(queueMutex);
-    sendQueue.push(message);
-    queueCV.notify_one();
-    return true;
+    // Serialized on the caller's thread, keeping JSON work off the reactor
+    return sendMessage(std::make_shared<const SerializedMessage>(message));
 }
 
-bool NetworkConnection::receiveMessage(NetworkMessage& message) {
-    if (state != ConnectionState::CONNECTED) {
+bool NetworkConnection::sendMessage(std::shared_ptr<const SerializedMessage> message) {
+    ConnectionState current = state;
+    if (current != ConnectionState::CONNECTED && current != ConnectionState::CONNECTING) {
         return false;
     }
     
-    std::string data;
-    if (!receiveData(data)) {
+    // Announcements give way first; anything else that would overflow the
+    // buffer means the peer has stopped reading. One oversized message is
+    // still taken into an empty buffer.
+    size_t bytes = FrameHeader::SIZE + message->getPayload()->size();
+    size_t queued = queuedBytes;
+    MessageType type = message->getType();
+    if (queued + bytes > sendBufferLimit / 2 &&
+        (type == MessageType::INVENTORY || type == MessageType::NEW_TRANSACTION)) {
+        messagesShed++;
+        return false;
+    }
+    if (queued > 0 && queued + bytes > sendBufferLimit) {
+        if (!overflowed.exchange(true)) {
+            Logger::warning("Dropping " + getFullAddress() + ": send buffer full");
+        }
+        disconnect();
         return false;
     }
+    queuedBytes += bytes;
+    updateCongestion();
     
-    message = NetworkMessage::deserialize(data);
-    if (message.isValid()) {
-        messagesReceived++;
-        updateActivity();
-        return true;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        sendQueue.push(std::move(message));
     }
     
-    return false;
+    // One flush per burst of sends, run on the reactor thread
+    if (!flushScheduled.exchange(true)) {
+        auto self = weak_from_this().lock();
+        if (self) {
+            reactor.post([self]() {
+                self->flushScheduled = false;
+                self->flush();
+            });
+        }
+    }
+    return true;
 }
 
 void NetworkConnection::processMessage(const NetworkMessage& message) {
@@ -244,58 +316,373 @@ void NetworkConnection::processMessage(const NetworkMessage& message) {
     }
 }
 
-void NetworkConnection::readLoop() {
-    while (!shouldClose && state == ConnectionState::CONNECTED) {
-        NetworkMessage message;
-        if (receiveMessage(message)) {
-            processMessage(message);
-        } else {
-            // Connection lost
-            break;
+void NetworkConnection::handleEvents(uint32_t events) {
+    if (state == ConnectionState::CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0 || (events & EPOLLERR)) {
+            Logger::error("Failed to connect to " + getFullAddress());
+            closeNow();
+            return;
+        }
+        state = ConnectionState::CONNECTED;
+        enableZeroCopy();
+        updateActivity();
+        Logger::info("Connected to " + getFullAddress());
+        reactor.modify(socketFd, EPOLLIN);
+        wantWrite = false;
+        flush();
+        return;
+    }
+    
+    // Zero-copy completions arrive on the error queue and raise EPOLLERR
+    // without any socket error
+    if (events & EPOLLERR) {
+        drainZeroCopyCompletions();
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            closeNow();
+            return;
+        }
+    }
+    
+    // A hangup may still have unread data; recv() reports the close after it
+    if (events & (EPOLLIN | EPOLLHUP)) {
+        handleReadable();
+    }
+    if (!shouldClose && (events & EPOLLOUT)) {
+        flush();
+    }
+    if (shouldClose) {
+        closeNow();
+    }
+}
+
+void NetworkConnection::handleReadable() {
+    // A few reads per wakeup so one busy peer cannot starve the others;
+    // epoll reports the socket again while data remains
+    const size_t readSize = 65536;
+    for (int i = 0; i < 4 && !shouldClose; i++) {
+        if (bandwidth && bandwidth->limitDownload && throttle(false)) {
+            updateInterest();
+            return;
+        }
+        ssize_t received = decoder.fill(socketFd, readSize);
+        if (received == 0) {
+            shouldClose = true;
+            return;
+        }
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                shouldClose = true;
+            }
+            return;
+        }
+        bytesReceived += static_cast<uint64_t>(received);
+        if (bandwidth && bandwidth->limitDownload) {
+            bandwidth->download.charge(static_cast<double>(received));
+        }
+        updateActivity();
+        
+        FrameView frame;
+        FrameStatus status = FrameStatus::INCOMPLETE;
+        while (!shouldClose && (status = decoder.next(frame)) == FrameStatus::FRAME) {
+            messagesReceived++;
+            if (frame.flags & ~FrameHeader::FLAG_COMPRESSED) {
+                Logger::warning("Dropping " + getFullAddress() + ": unknown frame flags");
+                shouldClose = true;
+                return;
+            }
+            if (frame.flags & FrameHeader::FLAG_COMPRESSED) {
+                // The inflated size is held to the same limit as a plain frame
+                if (!acceptCompressed || !compressor.decompress(frame.payload, inflated, maxPayloadSize)) {
+                    Logger::warning("Dropping " + getFullAddress() + ": bad compressed frame");
+                    shouldClose = true;
+                    return;
+                }
+                frame.payload = inflated;
+                frame.flags = 0;
+            }
+            if (frameHandler) {
+                frameHandler(*this, frame);
+            } else {
+                NetworkMessage message = NetworkMessage::deserialize(frame.payload);
+                if (message.isValid()) {
+                    processMessage(message);
+                }
+            }
+        }
+        if (status == FrameStatus::ERROR) {
+            Logger::warning("Dropping " + getFullAddress() + ": " + decoder.getError());
+            shouldClose = true;
+            return;
+        }
+        if (static_cast<size_t>(received) < readSize) {
+            return;   // Socket drained
         }
     }
 }
 
-void NetworkConnection::writeLoop() {
-    while (!shouldClose && state == ConnectionState::CONNECTED) {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        queueCV.wait(lock, [this] { return !sendQueue.empty() || shouldClose; });
+void NetworkConnection::flush() {
+    if (state != ConnectionState::CONNECTED) {
+        return;
+    }
+    
+    // Frame everything queued onto the end of the write chain. Payloads
+    // are referenced, not copied; a broadcast shares one buffer (and one
+    // deflated buffer) across every connection it was queued on.
+    std::queue<std::shared_ptr<const SerializedMessage>> pending;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        pending.swap(sendQueue);
+    }
+    while (!pending.empty()) {
+        const SerializedMessage& message = *pending.front();
+        OutboundFrame frame;
+        frame.payload = message.getPayload();
+        frame.charged = FrameHeader::SIZE + frame.payload->size();
+        uint32_t checksum = message.getChecksum();
+        uint16_t flags = 0;
+        if (compressOutbound && frame.payload->size() >= compressionThreshold) {
+            if (const auto& compressed = message.getCompressed(compressor)) {
+                compressionSaved += frame.payload->size() - compressed->size();
+                frame.payload = compressed;
+                checksum = message.getCompressedChecksum();
+                flags = FrameHeader::FLAG_COMPRESSED;
+            }
+        }
+        frame.offset = 0;
+        FrameCodec::encodeHeader(frame.header.data(), magic, static_cast<uint16_t>(message.getType()),
+                                 static_cast<uint32_t>(frame.payload->size()), checksum, flags);
+        writeChain.push_back(std::move(frame));
+        pending.pop();
+        messagesSent++;
+    }
+    
+    // Write the chain with as few syscalls as possible: small frames are
+    // gathered into one sendmsg(); a large payload goes alone with
+    // MSG_ZEROCOPY so its completion maps to exactly one buffer. Headers
+    // are always copied since they are freed as soon as the frame is popped.
+    const size_t maxIovecs = 64;
+    bool allowZeroCopy = zeroCopy;
+    while (!writeChain.empty()) {
+        if (bandwidth && bandwidth->limitUpload && throttle(true)) {
+            break;
+        }
+        const OutboundFrame& head = writeChain.front();
+        bool sendZeroCopy = allowZeroCopy && head.offset >= FrameHeader::SIZE &&
+                            head.payload->size() >= zeroCopyThreshold;
         
-        while (!sendQueue.empty() && !shouldClose) {
-            NetworkMessage message = sendQueue.front();
-            sendQueue.pop();
-            lock.unlock();
-            
-            if (!sendMessage(message)) {
-                Logger::error("Failed to send message to " + getFullAddress());
+        struct iovec iov[maxIovecs];
+        size_t count = 0;
+        size_t total = 0;
+        for (auto it = writeChain.begin(); it != writeChain.end() && count + 2 <= maxIovecs; ++it) {
+            if (sendZeroCopy && it != writeChain.begin()) {
                 break;
             }
+            if (it->offset < FrameHeader::SIZE) {
+                iov[count].iov_base = it->header.data() + it->offset;
+                iov[count].iov_len = FrameHeader::SIZE - it->offset;
+                total += iov[count++].iov_len;
+            }
+            if (!sendZeroCopy && allowZeroCopy && it->payload->size() >= zeroCopyThreshold) {
+                break;   // Its payload goes zero-copy in the next call
+            }
+            size_t payloadOffset = it->offset > FrameHeader::SIZE ? it->offset - FrameHeader::SIZE : 0;
+            if (payloadOffset < it->payload->size()) {
+                iov[count].iov_base = const_cast<char*>(it->payload->data()) + payloadOffset;
+                iov[count].iov_len = it->payload->size() - payloadOffset;
+                total += iov[count++].iov_len;
+            }
+        }
+        
+        // Under an upload limit, write a bounded slice at a time so the
+        // bucket's debt, and with it the burst above the rate, stays small
+        const size_t uploadSlice = 65536;
+        if (bandwidth && bandwidth->limitUpload && total > uploadSlice) {
+            size_t kept = 0;
+            size_t used = 0;
+            while (used < count && kept + iov[used].iov_len <= uploadSlice) {
+                kept += iov[used++].iov_len;
+            }
+            if (used < count && kept < uploadSlice) {
+                iov[used].iov_len = uploadSlice - kept;
+                kept = uploadSlice;
+                used++;
+            }
+            count = used;
+            total = kept;
+        }
+        
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        int flags = MSG_NOSIGNAL;
+#ifdef MSG_ZEROCOPY
+        if (sendZeroCopy) {
+            flags |= MSG_ZEROCOPY;
+        }
+#endif
+        ssize_t sent = sendmsg(socketFd, &msg, flags);
+        writeSyscalls++;
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (sendZeroCopy && errno == ENOBUFS) {
+                // Out of pinned-page budget; copy this time
+                allowZeroCopy = false;
+                continue;
+            }
+            Logger::error("Failed to send message to " + getFullAddress() + ": " + std::strerror(errno));
+            shouldClose = true;
+            closeNow();
+            return;
+        }
+        if (sendZeroCopy) {
+            zeroCopyPending.emplace_back(zeroCopySequence++, writeChain.front().payload);
+        }
+        
+        bytesSent += static_cast<uint64_t>(sent);
+        if (bandwidth && bandwidth->limitUpload) {
+            bandwidth->upload.charge(static_cast<double>(sent));
+        }
+        updateActivity();
+        size_t remaining = static_cast<size_t>(sent);
+        while (remaining > 0) {
+            OutboundFrame& front = writeChain.front();
+            size_t left = front.size() - front.offset;
+            if (remaining < left) {
+                front.offset += remaining;
+                break;
+            }
+            remaining -= left;
+            queuedBytes -= front.charged;
+            writeChain.pop_front();
+        }
+        
+        if (static_cast<size_t>(sent) < total) {
+            break;   // Socket buffer is full; EPOLLOUT resumes the chain
+        }
+    }
+    updateCongestion();
+    updateInterest();
+}
+
+void NetworkConnection::enableZeroCopy() {
+#ifdef SO_ZEROCOPY
+    int one = 1;
+    if (zeroCopy && setsockopt(socketFd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) {
+        return;
+    }
+#endif
+    zeroCopy = false;
+}
+
+void NetworkConnection::drainZeroCopyCompletions() {
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+    while (!zeroCopyPending.empty()) {
+        char control[128];
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(socketFd, &msg, MSG_ERRQUEUE) < 0) {
+            return;
+        }
+        
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            auto* error = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cmsg));
+            if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            
+            // Sends ee_info..ee_data are done; their payloads can be released
+            uint32_t first = error->ee_info;
+            uint32_t last = error->ee_data;
+            zeroCopyPending.erase(
+                std::remove_if(zeroCopyPending.begin(), zeroCopyPending.end(),
+                               [first, last](const std::pair<uint32_t, std::shared_ptr<const std::string>>& entry) {
+                                   return entry.first - first <= last - first;
+                               }),
+                zeroCopyPending.end());
             
-            lock.lock();
+            // The kernel fell back to copying (loopback, no NIC support), so
+            // pinning pages only adds overhead on this socket
+            if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                zeroCopy = false;
+            }
         }
     }
+#endif
+}
+
+void NetworkConnection::updateInterest() {
+    // Only ask for EPOLLOUT while bytes are waiting and may be sent, or
+    // every wakeup would spin; a throttled download stops reading
+    bool need = !writeChain.empty() && !writePaused;
+    bool read = !readPaused;
+    if (need != wantWrite || read != wantRead) {
+        wantWrite = need;
+        wantRead = read;
+        reactor.modify(socketFd, (read ? uint32_t(EPOLLIN) : 0u) | (need ? uint32_t(EPOLLOUT) : 0u));
+    }
 }
 
-bool NetworkConnection::sendData(const std::string& data) {
-    ssize_t bytesSent = send(socketFd, data.c_str(), data.length(), 0);
-    if (bytesSent > 0) {
-        this->bytesSent += bytesSent;
-        updateActivity();
-        return true;
+void NetworkConnection::updateCongestion() {
+    if (!isCongested()) {
+        congestedSince = 0;
+        return;
     }
-    return false;
+    int64_t expected = 0;
+    congestedSince.compare_exchange_strong(expected, std::chrono::steady_clock::now().time_since_epoch().count());
 }
 
-bool NetworkConnection::receiveData(std::string& data) {
-    char buffer[4096];
-    ssize_t bytesReceived = recv(socketFd, buffer, sizeof(buffer), 0);
-    if (bytesReceived > 0) {
-        data.assign(buffer, bytesReceived);
-        this->bytesReceived += bytesReceived;
-        updateActivity();
+bool NetworkConnection::isTooSlow() const {
+    int64_t since = congestedSince;
+    if (since == 0) {
+        return false;
+    }
+    auto congested = std::chrono::steady_clock::now() -
+                     std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(since));
+    return congested >= slowPeerTimeout;
+}
+
+bool NetworkConnection::throttle(bool upload) {
+    // Pause the direction until the shared bucket is out of debt, then
+    // resume from a timer; epoll interest is dropped meanwhile
+    bool& paused = upload ? writePaused : readPaused;
+    if (paused) {
         return true;
     }
-    return false;
+    double wait = (upload ? bandwidth->upload : bandwidth->download).secondsUntilAvailable(1);
+    if (wait <= 0) {
+        return false;
+    }
+    paused = true;
+    (upload ? bandwidth->throttledWrites : bandwidth->throttledReads)++;
+    std::weak_ptr<NetworkConnection> weak = weak_from_this();
+    reactor.runAfter(std::chrono::milliseconds(static_cast<int64_t>(std::ceil(wait * 1000))), [weak, upload]() {
+        auto self = weak.lock();
+        if (!self || self->state != ConnectionState::CONNECTED) {
+            return;
+        }
+        (upload ? self->writePaused : self->readPaused) = false;
+        if (upload) {
+            self->flush();
+        } else {
+            self->updateInterest();
+        }
+    });
+    return true;
 }
 
 void NetworkConnection::updateActivity() {
@@ -303,21 +690,42 @@ void NetworkConnection::updateActivity() {
 }
 
 // NetworkEngine implementation
+static SyncConfig syncConfigFor(const NetworkConfig& config) {
+    SyncConfig syncConfig;
+    syncConfig.headerPollInterval = std::chrono::seconds(std::max<uint64_t>(1, config.blockSyncInterval));
+    // Leave room for the message envelope around a BLOCKS response
+    syncConfig.maxResponseBytes = config.maxMessageSize - config.maxMessageSize / 8;
+    return syncConfig;
+}
+
+static RelayConfig relayConfigFor(const NetworkConfig& config) {
+    RelayConfig relayConfig;
+    relayConfig.meanAnnounceInterval = std::chrono::seconds(std::max<uint64_t>(1, config.transactionBroadcastInterval));
+    return relayConfig;
+}
+
+static DialerConfig dialerConfigFor(const NetworkConfig& config) {
+    DialerConfig dialerConfig;
+    dialerConfig.targetOutbound = config.targetOutbound;
+    dialerConfig.maxInFlight = std::max<uint64_t>(1, config.maxDialsInFlight);
+    dialerConfig.connectTimeout = std::chrono::milliseconds(config.dialTimeoutMillis);
+    dialerConfig.addressBookPath = config.addressBookPath;
+    return dialerConfig;
+}
+
 NetworkEngine::NetworkEngine(Blockchain& blockchain, MiningEngine& miningEngine, const NetworkConfig& config)
     : blockchain(blockchain), miningEngine(miningEngine), config(config), isRunning(false),
-      listenerSocket(-1), totalMessagesReceived(0), totalMessagesSent(0), totalBytesReceived(0),
-      totalBytesSent(0), activeConnections(0), totalPeers(0) {
+      listenerSocket(-1), sync(blockchain, scores, syncConfigFor(config)), relay(blockchain, relayConfigFor(config)),
+      dialer(dialerConfigFor(config)),
+      totalMessagesReceived(0),
+      totalMessagesSent(0), totalBytesReceived(0), totalBytesSent(0), activeConnections(0), totalPeers(0),
+      compactBlocksReceived(0), compactBlocksFromMempool(0), compactTransactionsRequested(0),
+      blocksCutThrough(0), invalidBlockBodies(0), slowPeersDropped(0), sendBufferOverflows(0) {
+    if (config.maxUploadRate > 0 || config.maxDownloadRate > 0) {
+        bandwidth = std::make_shared<BandwidthLimits>(config.maxUploadRate, config.maxDownloadRate);
+    }
     
     // Register default message handlers
-    registerMessageHandler(MessageType::HANDSHAKE, [this](const NetworkMessage& msg) { handleHandshake(msg); });
-    registerMessageHandler(MessageType::PING, [this](const NetworkMessage& msg) { handlePing(msg); });
-    registerMessageHandler(MessageType::PONG, [this](const NetworkMessage& msg) { handlePong(msg); });
-    registerMessageHandler(MessageType::GET_BLOCKS, [this](const NetworkMessage& msg) { handleGetBlocks(msg); });
-    registerMessageHandler(MessageType::BLOCKS, [this](const NetworkMessage& msg) { handleBlocks(msg); });
-    registerMessageHandler(MessageType::GET_TRANSACTIONS, [this](const NetworkMessage& msg) { handleGetTransactions(msg); });
-    registerMessageHandler(MessageType::TRANSACTIONS, [this](const NetworkMessage& msg) { handleTransactions(msg); });
-    registerMessageHandler(MessageType::NEW_BLOCK, [this](const NetworkMessage& msg) { handleNewBlock(msg); });
-    registerMessageHandler(MessageType::NEW_TRANSACTION, [this](const NetworkMessage& msg) { handleNewTransaction(msg); });
     registerMessageHandler(MessageType::PEER_LIST, [this](const NetworkMessage& msg) { handlePeerList(msg); });
     registerMessageHandler(MessageType::ADD_PEER, [this](const NetworkMessage& msg) { handleAddPeer(msg); });
     registerMessageHandler(MessageType::REMOVE_PEER, [this](const NetworkMessage& msg) { handleRemovePeer(msg); });
@@ -326,6 +734,24 @@ NetworkEngine::NetworkEngine(Blockchain& blockchain, MiningEngine& miningEngine,
     registerMessageHandler(MessageType::CONSENSUS_REQUEST, [this](const NetworkMessage& msg) { handleConsensusRequest(msg); });
     registerMessageHandler(MessageType::CONSENSUS_RESPONSE, [this](const NetworkMessage& msg) { handleConsensusResponse(msg); });
     
+    // Block download replies go back to the requesting connection
+    using Peer = std::shared_ptr<NetworkConnection>;
+    peerMessageHandlers[MessageType::NEW_BLOCK] = [this](const Peer& peer, const NetworkMessage& msg) { handleNewBlock(peer, msg); };
+    peerMessageHandlers[MessageType::HANDSHAKE] = [this](const Peer& peer, const NetworkMessage& msg) { handleHandshake(peer, msg); };
+    peerMessageHandlers[MessageType::PING] = [this](const Peer& peer, const NetworkMessage& msg) { handlePing(peer, msg); };
+    peerMessageHandlers[MessageType::PONG] = [this](const Peer& peer, const NetworkMessage& msg) { handlePong(peer, msg); };
+    peerMessageHandlers[MessageType::GET_HEADERS] = [this](const Peer& peer, const NetworkMessage& msg) { handleGetHeaders(peer, msg); };
+    peerMessageHandlers[MessageType::HEADERS] = [this](const Peer& peer, const NetworkMessage& msg) { handleHeaders(peer, msg); };
+    peerMessageHandlers[MessageType::GET_BLOCKS] = [this](const Peer& peer, const NetworkMessage& msg) { handleGetBlocks(peer, msg); };
+    peerMessageHandlers[MessageType::BLOCKS] = [this](const Peer& peer, const NetworkMessage& msg) { handleBlocks(peer, msg); };
+    peerMessageHandlers[MessageType::COMPACT_BLOCK] = [this](const Peer& peer, const NetworkMessage& msg) { handleCompactBlock(peer, msg); };
+    peerMessageHandlers[MessageType::GET_BLOCK_TXN] = [this](const Peer& peer, const NetworkMessage& msg) { handleGetBlockTransactions(peer, msg); };
+    peerMessageHandlers[MessageType::BLOCK_TXN] = [this](const Peer& peer, const NetworkMessage& msg) { handleBlockTransactions(peer, msg); };
+    peerMessageHandlers[MessageType::INVENTORY] = [this](const Peer& peer, const NetworkMessage& msg) { handleInventory(peer, msg); };
+    peerMessageHandlers[MessageType::GET_TRANSACTIONS] = [this](const Peer& peer, const NetworkMessage& msg) { handleGetTransactions(peer, msg); };
+    peerMessageHandlers[MessageType::TRANSACTIONS] = [this](const Peer& peer, const NetworkMessage& msg) { handleTransactions(peer, msg); };
+    peerMessageHandlers[MessageType::NEW_TRANSACTION] = [this](const Peer& peer, const NetworkMessage& msg) { handleNewTransaction(peer, msg); };
+    
     Logger::info("Network engine initialized");
 }
 
@@ -345,6 +771,10 @@ bool NetworkEngine::start() {
         return false;
     }
     
+    // A restarted node must be able to rebind while old connections sit in TIME_WAIT
+    int reuse = 1;
+    setsockopt(listenerSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    
     // Bind socket
     if (!NetworkUtils::bindSocket(listenerSocket, config.bindAddress, config.listenPort)) {
         Logger::error("Failed to bind socket to " + config.bindAddress + ":" + std::to_string(config.listenPort));
@@ -353,20 +783,49 @@ bool NetworkEngine::start() {
     }
     
     // Listen for connections
-    if (!NetworkUtils::listenSocket(listenerSocket)) {
+    if (!NetworkUtils::listenSocket(listenerSocket, SOMAXCONN)) {
         Logger::error("Failed to listen on socket");
         NetworkUtils::closeSocket(listenerSocket);
         return false;
     }
     
+    // Accept from the reactor: drain the backlog on every readiness event
+    int flags = fcntl(listenerSocket, F_GETFL, 0);
+    fcntl(listenerSocket, F_SETFL, flags | O_NONBLOCK);
+    reactor.add(listenerSocket, EPOLLIN, [this](uint32_t) {
+        while (acceptConnection()) {
+        }
+    });
+    
     isRunning = true;
     
-    // Start network threads
-    listenerThread = std::thread(&NetworkEngine::listenerLoop, this);
-    discoveryThread = std::thread(&NetworkEngine::discoveryLoop, this);
-    syncThread = std::thread(&NetworkEngine::syncLoop, this);
-    broadcastThread = std::thread(&NetworkEngine::broadcastLoop, this);
-    messageProcessingThread = std::thread(&NetworkEngine::messageProcessingLoop, this);
+    // A fixed thread count no matter how many peers connect: one reactor
+    // for all sockets and timers, plus the handler pool
+    workers.start(std::max(2u, std::thread::hardware_concurrency()));
+    reactor.start();
+    
+    // Periodic jobs run on the workers so a slow one never delays socket I/O
+    auto every = [this](uint64_t seconds, Lane lane, std::function<void()> job) {
+        workers.submit(job, lane);
+        timers.push_back(reactor.runEvery(std::chrono::seconds(std::max<uint64_t>(1, seconds)),
+                                          [this, job, lane]() { workers.submit(job, lane); }));
+    };
+    every(config.peerDiscoveryInterval, Lane::HOUSEKEEPING, [this]() { discoverPeers(); });
+    // Sync ticks every second to catch stalled downloads; header polling
+    // inside it follows blockSyncInterval
+    every(1, Lane::HEADERS, [this]() { syncWithPeers(); });
+    every(config.pingInterval, Lane::HOUSEKEEPING, [this]() { pingPeers(); });
+    
+    // Last run's good peers are dialed straight away, before discovery has
+    // turned anything up; the dialer then tops up outbound every second
+    dialer.load();
+    every(1, Lane::HOUSEKEEPING, [this]() { dialPeers(); });
+    
+    // Each peer's announcements go out on its own Poisson schedule; this
+    // just needs to be fine-grained enough to honour it
+    timers.push_back(reactor.runEvery(std::chrono::milliseconds(250), [this]() {
+        workers.submit([this]() { relayTransactions(); }, Lane::TRANSACTIONS);
+    }));
     
     Logger::info("Network engine started on port " + std::to_string(config.listenPort));
     return true;
@@ -379,37 +838,33 @@ void NetworkEngine::stop() {
     
     isRunning = false;
     
+    for (auto timer : timers) {
+        reactor.cancelTimer(timer);
+    }
+    timers.clear();
+    reactor.stop();
+    
     // Close listener socket
     if (listenerSocket >= 0) {
+        reactor.remove(listenerSocket);
         NetworkUtils::closeSocket(listenerSocket);
         listenerSocket = -1;
     }
     
-    // Close all connections
+    // Close all connections; the reactor is stopped, so they close inline.
+    // The close handlers take connectionsMutex, so it is not held here.
+    std::vector<std::shared_ptr<NetworkConnection>> closing;
     {
         std::lock_guard<std::mutex> lock(connectionsMutex);
-        for (auto& connection : connections) {
-            connection->disconnect();
-        }
-        connections.clear();
-    }
-    
-    // Wait for threads to finish
-    if (listenerThread.joinable()) {
-        listenerThread.join();
-    }
-    if (discoveryThread.joinable()) {
-        discoveryThread.join();
-    }
-    if (syncThread.joinable()) {
-        syncThread.join();
-    }
-    if (broadcastThread.joinable()) {
-        broadcastThread.join();
+        closing.swap(connections);
     }
-    if (messageProcessingThread.joinable()) {
-        messageProcessingThread.join();
+    for (auto& connection : closing) {
+        connection->disconnect();
     }
+    activeConnections = 0;
+    
+    workers.stop();
+    dialer.save();
     
     Logger::info("Network engine stopped");
 }
@@ -433,6 +888,7 @@ bool NetworkEngine::addPeer(const std::string& address, uint16_t port) {
     
     peers[key] = peer;
     totalPeers++;
+    dialer.addAddress(address, port);
     
     Logger::info("Added peer: " + key);
     return true;
@@ -463,13 +919,25 @@ std::vector<PeerNode> NetworkEngine::getPeers() const {
 }
 
 std::vector<PeerNode> NetworkEngine::getActivePeers() const {
-    std::lock_guard<std::mutex> lock(peersMutex);
-    std::vector<PeerNode> result;
-    for (const auto& pair : peers) {
-        if (pair.second.isActive()) {
-            result.push_back(pair.second);
+    std::vector<std::pair<double, PeerNode>> ranked;
+    {
+        std::lock_guard<std::mutex> lock(peersMutex);
+        for (const auto& pair : peers) {
+            if (pair.second.isActive()) {
+                ranked.emplace_back(scores.score(pair.first), pair.second);
+            }
         }
     }
+    
+    // Best first
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const std::pair<double, PeerNode>& a, const std::pair<double, PeerNode>& b) {
+                         return a.first > b.first;
+                     });
+    std::vector<PeerNode> result;
+    for (auto& pair : ranked) {
+        result.push_back(std::move(pair.second));
+    }
     return result;
 }
 
@@ -479,13 +947,14 @@ bool NetworkEngine::isPeerConnected(const std::string& address) const {
     return it != peers.end() && it->second.isConnected;
 }
 
-bool NetworkEngine::broadcastMessage(const NetworkMessage& message) {
-    std::lock_guard<std::mutex> lock(connectionsMutex);
-    
+bool NetworkEngine::broadcastMessage(const NetworkMessage& message, const NetworkConnection* except) {
+    // Best peers first, so a new block reaches the fastest links soonest.
+    // Serialized once; every connection queues the same buffer.
+    auto serialized = std::make_shared<const SerializedMessage>(message);
     bool success = false;
-    for (auto& connection : connections) {
-        if (connection->isConnected()) {
-            if (connection->sendMessage(message)) {
+    for (auto& connection : rankedConnections()) {
+        if (connection->isConnected() && connection.get() != except) {
+            if (connection->sendMessage(serialized)) {
                 success = true;
             }
         }
@@ -513,31 +982,43 @@ bool NetworkEngine::sendMessageToPeer(const std::string& peerAddress, const Netw
     return false;
 }
 
-bool NetworkEngine::broadcastBlock(const Block& block) {
+bool NetworkEngine::broadcastBlock(const Block& block, const NetworkConnection* except) {
     NetworkMessage message;
-    message.type = MessageType::NEW_BLOCK;
     message.sender = generateNodeId();
     message.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
-    message.data = nlohmann::json::parse(block.serialize());
     
-    return broadcastMessage(message);
+    if (config.enableCompactBlocks) {
+        // Peers already hold nearly every transaction; send short IDs
+        std::random_device rd;
+        uint64_t salt = (static_cast<uint64_t>(rd()) << 32) | rd();
+        message.type = MessageType::COMPACT_BLOCK;
+        message.data = CompactBlock::fromBlock(block, salt).toJson();
+    } else {
+        message.type = MessageType::NEW_BLOCK;
+        message.data = nlohmann::json::parse(block.serialize());
+    }
+    
+    return broadcastMessage(message, except);
 }
 
 bool NetworkEngine::broadcastTransaction(const Transaction& transaction) {
-    NetworkMessage message;
-    message.type = MessageType::NEW_TRANSACTION;
-    message.sender = generateNodeId();
-    message.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-    message.data = nlohmann::json::parse(transaction.serialize());
-    
-    return broadcastMessage(message);
+    // Announced by hash on each peer's next batch; bodies go out on request
+    return relay.relay(transaction);
 }
 
 void NetworkEngine::discoverPeers() {
-    // Query seed nodes
+    // Query seed nodes; a "host:port" seed is a peer itself
     for (const auto& seedNode : config.seedNodes) {
+        size_t seedColon = seedNode.rfind(':');
+        if (seedColon != std::string::npos) {
+            std::string address = NetworkUtils::resolveHostname(seedNode.substr(0, seedColon));
+            int port = std::atoi(seedNode.c_str() + seedColon + 1);
+            if (!address.empty() && port > 0 && port <= 65535) {
+                addPeer(address, static_cast<uint16_t>(port));
+            }
+            continue;
+        }
         auto discoveredPeers = NetworkUtils::queryDNSPeers(seedNode);
         for (const auto& peerAddress : discoveredPeers) {
             size_t colonPos = peerAddress.find(':');
@@ -559,6 +1040,44 @@ void NetworkEngine::discoverPeers() {
             addPeer(address, port);
         }
     }
+    
+    dialer.save();
+    dialPeers();
+}
+
+void NetworkEngine::dialPeers() {
+    if (!isRunning) {
+        return;
+    }
+    // Never dial a peer we are already talking to, or ourselves
+    std::vector<std::shared_ptr<NetworkConnection>> snapshot = rankedConnections();
+    std::set<std::string> connected;
+    for (const auto& connection : snapshot) {
+        connected.insert(connection->getFullAddress());
+    }
+    connected.insert(config.bindAddress + ":" + std::to_string(config.listenPort));
+    for (const auto& local : NetworkUtils::getLocalAddresses()) {
+        connected.insert(local + ":" + std::to_string(config.listenPort));
+    }
+    
+    Dialer::Plan plan = dialer.tick(connected);
+    for (const auto& peer : plan.timedOut) {
+        for (const auto& connection : snapshot) {
+            if (connection->getFullAddress() == peer && !connection->isConnected()) {
+                Logger::debug("Connect to " + peer + " timed out");
+                connection->disconnect();
+            }
+        }
+    }
+    // All started at once; each completes on the reactor when it can.
+    // Banned hosts wait out their ban on every port.
+    for (const auto& dial : plan.dials) {
+        if (scores.isBanned(dial.address)) {
+            dialer.deferHost(dial.address, scores.bannedUntil(dial.address));
+            continue;
+        }
+        connectToPeer(dial.address, dial.port);
+    }
 }
 
 void NetworkEngine::pingPeers() {
@@ -567,24 +1086,57 @@ void NetworkEngine::pingPeers() {
     ping.sender = generateNodeId();
     ping.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
-    ping.data = {{"timestamp", ping.timestamp}};
     
-    broadcastMessage(ping);
+    // Each ping carries a fresh nonce so only the matching pong is timed
+    for (auto& connection : rankedConnections()) {
+        if (connection->isConnected()) {
+            ping.data = {{"timestamp", ping.timestamp}, {"nonce", scores.pingSent(connection->getFullAddress())}};
+            connection->sendMessage(ping);
+        }
+    }
 }
 
 void NetworkEngine::syncWithPeers() {
-    // Request blocks from peers
-    NetworkMessage getBlocks;
-    getBlocks.type = MessageType::GET_BLOCKS;
-    getBlocks.sender = generateNodeId();
-    getBlocks.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-    getBlocks.data = {
-        {"startHeight", blockchain.getChainHeight()},
-        {"endHeight", blockchain.getChainHeight() + 100}
-    };
-    
-    broadcastMessage(getBlocks);
+    std::vector<std::shared_ptr<NetworkConnection>> snapshot = rankedConnections();
+    sync.tick(snapshot);
+    
+    // Peers that keep stalling, stop draining their send buffer or send
+    // bad data make room for better ones
+    for (auto& connection : snapshot) {
+        if (!connection->isConnected()) {
+            continue;
+        }
+        bool tooSlow = connection->isTooSlow();
+        if (tooSlow || scores.shouldDisconnect(connection->getFullAddress())) {
+            Logger::warning("Dropping slow or misbehaving peer " + connection->getFullAddress());
+            if (tooSlow) {
+                slowPeersDropped++;
+                scores.recordStall(connection->getFullAddress());
+            }
+            connection->disconnect();
+        }
+    }
+}
+
+void NetworkEngine::relayTransactions() {
+    relay.tick(rankedConnections());
+}
+
+std::vector<std::shared_ptr<NetworkConnection>> NetworkEngine::rankedConnections() const {
+    std::vector<std::shared_ptr<NetworkConnection>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        snapshot = connections;
+    }
+    scores.rank(snapshot);
+    return snapshot;
+}
+
+void NetworkEngine::penalize(const std::shared_ptr<NetworkConnection>& peer, double points, const std::string& reason) {
+    Logger::warning(reason + " from " + peer->getFullAddress());
+    if (scores.recordInvalid(peer->getFullAddress(), points)) {
+        peer->disconnect();
+    }
 }
 
 void NetworkEngine::updateConfig(const NetworkConfig& newConfig) {
@@ -595,15 +1147,87 @@ void NetworkEngine::updateConfig(const NetworkConfig& newConfig) {
 nlohmann::json NetworkEngine::getNetworkStats() const {
     nlohmann::json stats;
     stats["isRunning"] = isRunning.load();
-    stats["activeConnections"] = activeConnections;
-    stats["totalPeers"] = totalPeers;
-    stats["totalMessagesReceived"] = totalMessagesReceived;
-    stats["totalMessagesSent"] = totalMessagesSent;
-    stats["totalBytesReceived"] = totalBytesReceived;
-    stats["totalBytesSent"] = totalBytesSent;
+    stats["activeConnections"] = activeConnections.load();
+    stats["totalPeers"] = totalPeers.load();
+    stats["totalMessagesReceived"] = totalMessagesReceived.load();
+    stats["totalMessagesSent"] = totalMessagesSent.load();
+    stats["totalBytesReceived"] = totalBytesReceived.load();
+    stats["totalBytesSent"] = totalBytesSent.load();
+    
+    // Frames per write syscall shows how well the send path is coalescing
+    uint64_t writeSyscalls = 0;
+    uint64_t framesWritten = 0;
+    uint64_t compressionSaved = 0;
+    uint64_t queuedBytes = 0;
+    uint64_t messagesShed = 0;
+    nlohmann::json peerBandwidth = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& connection : connections) {
+            writeSyscalls += connection->getWriteSyscalls();
+            framesWritten += connection->getMessagesSent();
+            compressionSaved += connection->getCompressionSaved();
+            queuedBytes += connection->getQueuedBytes();
+            messagesShed += connection->getMessagesShed();
+            
+            // Average rates since the connection opened
+            double seconds = std::max(0.001, std::chrono::duration<double>(now - connection->getConnectedAt()).count());
+            peerBandwidth.push_back({
+                {"address", connection->getFullAddress()},
+                {"bytesSent", connection->getBytesSent()},
+                {"bytesReceived", connection->getBytesReceived()},
+                {"sendRate", connection->getBytesSent() / seconds},
+                {"receiveRate", connection->getBytesReceived() / seconds},
+                {"queuedBytes", connection->getQueuedBytes()},
+                {"messagesShed", connection->getMessagesShed()},
+                {"congested", connection->isCongested()}
+            });
+        }
+    }
+    stats["totalWriteSyscalls"] = writeSyscalls;
+    stats["writeSyscallsPerMessage"] = framesWritten > 0 ? static_cast<double>(writeSyscalls) / framesWritten : 0.0;
+    stats["compressionBytesSaved"] = compressionSaved;
+    stats["bandwidth"] = {
+        {"maxUploadRate", config.maxUploadRate},
+        {"maxDownloadRate", config.maxDownloadRate},
+        {"throttledWrites", bandwidth ? bandwidth->throttledWrites.load() : 0},
+        {"throttledReads", bandwidth ? bandwidth->throttledReads.load() : 0},
+        {"queuedBytes", queuedBytes},
+        {"messagesShed", messagesShed},
+        {"slowPeersDropped", slowPeersDropped.load()},
+        {"sendBufferOverflows", sendBufferOverflows.load()},
+        {"peers", std::move(peerBandwidth)}
+    };
     stats["listenPort"] = config.listenPort;
     stats["bindAddress"] = config.bindAddress;
     stats["maxPeers"] = config.maxPeers;
+    stats["sync"] = sync.getStats();
+    stats["compactBlocksReceived"] = compactBlocksReceived.load();
+    stats["compactBlocksFromMempool"] = compactBlocksFromMempool.load();
+    stats["compactTransactionsRequested"] = compactTransactionsRequested.load();
+    stats["blocksCutThrough"] = blocksCutThrough.load();
+    stats["invalidBlockBodies"] = invalidBlockBodies.load();
+    stats["relay"] = relay.getStats();
+    stats["peerScores"] = scores.getStats();
+    stats["dialer"] = dialer.getStats();
+    
+    // Queue depth and wait per priority lane show whether relay load is
+    // delaying block handling
+    const std::pair<const char*, Lane> lanes[] = {
+        {"consensus", Lane::CONSENSUS}, {"headers", Lane::HEADERS},
+        {"transactions", Lane::TRANSACTIONS}, {"housekeeping", Lane::HOUSEKEEPING}
+    };
+    for (const auto& entry : lanes) {
+        LaneStats lane = workers.getLaneStats(entry.second);
+        stats["lanes"][entry.first] = {
+            {"queued", lane.queued},
+            {"processed", lane.processed},
+            {"dropped", lane.dropped},
+            {"meanWaitMillis", lane.meanWaitMillis},
+            {"maxWaitMillis", lane.maxWaitMillis}
+        };
+    }
     return stats;
 }
 
@@ -615,42 +1239,6 @@ void NetworkEngine::unregisterMessageHandler(MessageType type) {
     messageHandlers.erase(type);
 }
 
-void NetworkEngine::listenerLoop() {
-    while (isRunning) {
-        if (!acceptConnection()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-    }
-}
-
-void NetworkEngine::discoveryLoop() {
-    while (isRunning) {
-        discoverPeers();
-        std::this_thread::sleep_for(std::chrono::seconds(config.peerDiscoveryInterval));
-    }
-}
-
-void NetworkEngine::syncLoop() {
-    while (isRunning) {
-        syncWithPeers();
-        std::this_thread::sleep_for(std::chrono::seconds(config.blockSyncInterval));
-    }
-}
-
-void NetworkEngine::broadcastLoop() {
-    while (isRunning) {
-        pingPeers();
-        std::this_thread::sleep_for(std::chrono::seconds(config.pingInterval));
-    }
-}
-
-void NetworkEngine::messageProcessingLoop() {
-    while (isRunning) {
-        processMessageQueue();
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
-}
-
 bool NetworkEngine::acceptConnection() {
     std::string clientAddress;
     uint16_t clientPort;
@@ -665,23 +1253,115 @@ bool NetworkEngine::acceptConnection() {
 }
 
 void NetworkEngine::handleNewConnection(int clientSocket, const std::string& clientAddress, uint16_t clientPort) {
-    std::lock_guard<std::mutex> lock(connectionsMutex);
-    
-    if (connections.size() >= config.maxConnections) {
-        Logger::warning("Max connections reached, rejecting connection from " + clientAddress);
+    if (scores.isBanned(clientAddress)) {
+        Logger::debug("Refusing connection from banned host " + clientAddress);
         NetworkUtils::closeSocket(clientSocket);
         return;
     }
     
-    auto connection = std::make_unique<NetworkConnection>(clientSocket, clientAddress, clientPort);
-    if (connection->connect()) {
-        connections.push_back(std::move(connection));
-        activeConnections++;
+    // At maxPeers, make room by evicting the lowest-scoring inbound peer
+    // that has been measured and scores poorly. Peers we dialed are never
+    // candidates, so inbound connects cannot cycle them out and eclipse us;
+    // with no candidate the newcomer is turned away instead.
+    std::shared_ptr<NetworkConnection> evicted;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        if (connections.size() >= config.maxPeers) {
+            std::vector<std::string> candidates;
+            for (const auto& connection : connections) {
+                if (!dialer.isOutbound(connection->getFullAddress())) {
+                    candidates.push_back(connection->getFullAddress());
+                }
+            }
+            std::string victim = scores.selectEviction(candidates);
+            for (const auto& connection : connections) {
+                if (!victim.empty() && connection->getFullAddress() == victim) {
+                    evicted = connection;
+                }
+            }
+            if (!evicted) {
+                Logger::warning("Max peers reached, rejecting connection from " + clientAddress);
+                NetworkUtils::closeSocket(clientSocket);
+                return;
+            }
+        }
+        if (!evicted && connections.size() >= config.maxConnections) {
+            Logger::warning("Max connections reached, rejecting connection from " + clientAddress);
+            NetworkUtils::closeSocket(clientSocket);
+            return;
+        }
+    }
+    // Closing runs the close handler, which takes connectionsMutex
+    if (evicted) {
+        Logger::info("Evicting " + evicted->getFullAddress() + " to make room for " + clientAddress);
+        evicted->disconnect();
+    }
+    
+    if (registerConnection(clientSocket, clientAddress, clientPort)) {
         Logger::info("New connection from " + clientAddress + ":" + std::to_string(clientPort));
     }
 }
 
-void NetworkEngine::handleMessage(const NetworkMessage& message) {
+bool NetworkEngine::registerConnection(int socket, const std::string& address, uint16_t port) {
+    // Held across connect() so a close handler for a failed outbound
+    // connect cannot run before the connection is in the list
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    auto connection = std::make_shared<NetworkConnection>(reactor, socket, address, port, config);
+    connection->setFrameHandler([this](NetworkConnection& source, const FrameView& frame) {
+        handleFrame(source, frame);
+    });
+    connection->setCloseHandler([this](NetworkConnection& closed) {
+        handleConnectionClosed(closed);
+    });
+    connection->setBandwidthLimits(bandwidth);
+    scores.peerConnected(connection->getFullAddress());
+    if (!connection->connect()) {
+        return false;
+    }
+    sendHandshake(connection);
+    relay.peerConnected(connection);
+    connections.push_back(std::move(connection));
+    activeConnections++;
+    return true;
+}
+
+bool NetworkEngine::connectToPeer(const std::string& address, uint16_t port) {
+    if (!isRunning) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        if (connections.size() >= config.maxConnections) {
+            return false;
+        }
+    }
+    
+    // Tracked by the dialer whoever started it, so the outcome feeds the
+    // address book and counts against the outbound target
+    dialer.dialStarted(address, port);
+    int socket = NetworkUtils::createSocket();
+    if (socket < 0) {
+        dialer.connectionClosed(address + ":" + std::to_string(port));
+        return false;
+    }
+    // The handshake is queued and goes out once the connect completes
+    if (!registerConnection(socket, address, port)) {
+        Logger::warning("Failed to connect to " + address + ":" + std::to_string(port));
+        dialer.connectionClosed(address + ":" + std::to_string(port));
+        return false;
+    }
+    return true;
+}
+
+void NetworkEngine::handleMessage(const std::shared_ptr<NetworkConnection>& source, const NetworkMessage& message) {
+    auto peerHandler = peerMessageHandlers.find(message.type);
+    if (peerHandler != peerMessageHandlers.end()) {
+        if (source && source->isConnected()) {
+            peerHandler->second(source, message);
+        }
+        return;
+    }
+    
     auto it = messageHandlers.find(message.type);
     if (it != messageHandlers.end()) {
         it->second(message);
@@ -690,14 +1370,81 @@ void NetworkEngine::handleMessage(const NetworkMessage& message) {
     }
 }
 
-void NetworkEngine::processMessageQueue() {
-    std::lock_guard<std::mutex> lock(messageMutex);
-    
-    while (!messageQueue.empty()) {
-        NetworkMessage message = messageQueue.front();
-        messageQueue.pop();
-        
-        handleMessage(message);
+// Worker lane for each message type, chosen from the frame header before
+// the payload is parsed
+static Lane laneFor(MessageType type) {
+    switch (type) {
+        case MessageType::NEW_BLOCK:
+        case MessageType::COMPACT_BLOCK:
+        case MessageType::GET_BLOCK_TXN:
+        case MessageType::BLOCK_TXN:
+        case MessageType::BLOCKS:
+        case MessageType::CONSENSUS_REQUEST:
+        case MessageType::CONSENSUS_RESPONSE:
+            return Lane::CONSENSUS;
+        case MessageType::GET_HEADERS:
+        case MessageType::HEADERS:
+        case MessageType::GET_BLOCKS:
+            return Lane::HEADERS;
+        case MessageType::INVENTORY:
+        case MessageType::GET_TRANSACTIONS:
+        case MessageType::TRANSACTIONS:
+        case MessageType::NEW_TRANSACTION:
+            return Lane::TRANSACTIONS;
+        default:
+            return Lane::HOUSEKEEPING;
+    }
+}
+
+void NetworkEngine::handleFrame(NetworkConnection& connection, const FrameView& frame) {
+    // Runs on the reactor thread: copy the payload out of the receive buffer
+    // and leave parsing and handling to the workers
+    totalBytesReceived += FrameHeader::SIZE + frame.payload.size();
+    uint16_t type = frame.type;
+    std::string peer = connection.getFullAddress();
+    std::weak_ptr<NetworkConnection> source = connection.weak_from_this();
+    // A full lane sheds the message; gossip and sync both re-request what
+    // they miss, and a flood in one lane never delays the others
+    Lane lane = laneFor(static_cast<MessageType>(type));
+    bool queued = workers.submit([this, payload = std::string(frame.payload), type, peer, source]() {
+        NetworkMessage message = NetworkMessage::deserialize(payload);
+        if (static_cast<uint16_t>(message.type) != type || !validateMessage(message)) {
+            if (auto connection = source.lock()) {
+                penalize(connection, 10, "Invalid message");
+            }
+            return;
+        }
+        totalMessagesReceived++;
+        handleMessage(source.lock(), message);
+    }, lane);
+    if (!queued) {
+        Logger::debug("Worker lane full, dropping message type " + std::to_string(type) + " from " + peer);
+    }
+}
+
+void NetworkEngine::handleConnectionClosed(NetworkConnection& connection) {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    auto it = std::find_if(connections.begin(), connections.end(),
+                           [&connection](const std::shared_ptr<NetworkConnection>& candidate) {
+                               return candidate.get() == &connection;
+                           });
+    if (connection.hasOverflowed()) {
+        sendBufferOverflows++;
+    }
+    if (it != connections.end()) {
+        connections.erase(it);
+        activeConnections--;
+    }
+    sync.peerDisconnected(connection.getFullAddress());
+    relay.peerDisconnected(connection.getFullAddress());
+    scores.peerDisconnected(connection.getFullAddress());
+    
+    // A failed dial frees its slot for the next address now rather than
+    // at the next tick
+    bool wasDialing = dialer.isDialing(connection.getFullAddress());
+    dialer.connectionClosed(connection.getFullAddress());
+    if (wasDialing && isRunning) {
+        workers.submit([this]() { dialPeers(); }, Lane::HOUSEKEEPING);
     }
 }
 
@@ -710,49 +1457,360 @@ std::string NetworkEngine::generateNodeId() {
 }
 
 // Message handlers implementation
-void NetworkEngine::handleHandshake(const NetworkMessage& message) {
+void NetworkEngine::sendHandshake(const std::shared_ptr<NetworkConnection>& peer) {
+    NetworkMessage handshake;
+    handshake.type = MessageType::HANDSHAKE;
+    handshake.sender = generateNodeId();
+    handshake.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    handshake.data = nlohmann::json::parse(NetworkUtils::createHandshakeMessage(handshake.sender, config.protocolVersion));
+    if (config.enableCompression) {
+        handshake.data["capabilities"].push_back("compression");
+    }
+    peer->sendMessage(handshake);
+}
+
+void NetworkEngine::handleHandshake(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
     Logger::info("Handshake from " + message.sender);
-    // TODO: Implement handshake logic
+    
+    // Compress towards peers that said they can inflate; until their
+    // handshake arrives everything goes out plain
+    bool peerCompresses = false;
+    if (message.data.contains("capabilities") && message.data["capabilities"].is_array()) {
+        for (const auto& capability : message.data["capabilities"]) {
+            if (capability.is_string() && capability.get<std::string>() == "compression") {
+                peerCompresses = true;
+            }
+        }
+    }
+    peer->setCompression(config.enableCompression && peerCompresses);
+    dialer.dialSucceeded(peer->getFullAddress());
+    
+    // Measure the round trip straight away rather than at the next ping round
+    NetworkMessage ping;
+    ping.type = MessageType::PING;
+    ping.sender = generateNodeId();
+    ping.timestamp = message.timestamp;
+    ping.data = {{"timestamp", ping.timestamp}, {"nonce", scores.pingSent(peer->getFullAddress())}};
+    peer->sendMessage(ping);
+}
+
+void NetworkEngine::handlePing(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Ping from " + peer->getFullAddress());
+    NetworkMessage pong;
+    pong.type = MessageType::PONG;
+    pong.sender = generateNodeId();
+    pong.recipient = message.sender;
+    pong.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    pong.data = message.data;
+    peer->sendMessage(pong);
+}
+
+void NetworkEngine::handlePong(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Pong from " + peer->getFullAddress());
+    std::string key = peer->getFullAddress();
+    if (!scores.pongReceived(key, message.data.value("nonce", 0ULL))) {
+        return;   // Unsolicited or stale
+    }
+    
+    std::lock_guard<std::mutex> lock(peersMutex);
+    auto it = peers.find(key);
+    if (it != peers.end()) {
+        it->second.latency = static_cast<uint64_t>(scores.getRtt(key));
+        it->second.lastSeen = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
 }
 
-void NetworkEngine::handlePing(const NetworkMessage& message) {
-    Logger::debug("Ping from " + message.sender);
-    // TODO: Implement ping response
+void NetworkEngine::handleGetHeaders(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Get headers request from " + peer->getFullAddress());
+    sync.handleGetHeaders(peer, message);
 }
 
-void NetworkEngine::handlePong(const NetworkMessage& message) {
-    Logger::debug("Pong from " + message.sender);
-    // TODO: Update peer latency
+void NetworkEngine::handleHeaders(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Received headers from " + peer->getFullAddress());
+    sync.handleHeaders(peer, message);
 }
 
-void NetworkEngine::handleGetBlocks(const NetworkMessage& message) {
-    Logger::info("Get blocks request from " + message.sender);
-    // TODO: Send blocks to peer
+void NetworkEngine::handleGetBlocks(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Get blocks request from " + peer->getFullAddress());
+    sync.handleGetBlocks(peer, message);
 }
 
-void NetworkEngine::handleBlocks(const NetworkMessage& message) {
-    Logger::info("Received blocks from " + message.sender);
-    // TODO: Process received blocks
+void NetworkEngine::handleBlocks(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Received blocks from " + peer->getFullAddress());
+    sync.handleBlocks(peer, message);
 }
 
-void NetworkEngine::handleGetTransactions(const NetworkMessage& message) {
-    Logger::info("Get transactions request from " + message.sender);
-    // TODO: Send transactions to peer
+void NetworkEngine::handleCompactBlock(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    CompactBlock compact = CompactBlock::fromJson(message.data);
+    BlockHeader header = compact.getHeader();
+    compactBlocksReceived++;
+    
+    // Only a block on our tip is rebuilt here; sync fetches anything further ahead
+    uint64_t height = blockchain.getChainHeight();
+    Block tip(0, "");
+    if (header.index != height || !blockchain.getBlock(height - 1, tip) || header.previousHash != tip.getHash()) {
+        Logger::debug("Compact block " + std::to_string(header.index) + " from " + peer->getFullAddress() +
+                      " does not extend our tip");
+        return;
+    }
+    if (!header.checkProofOfWork(blockchain.getDifficulty())) {
+        penalize(peer, 100, "Compact block with invalid proof of work");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(compactMutex);
+        if (pendingCompactBlocks.count(header.hash)) {
+            return;   // Already waiting on another peer for it
+        }
+    }
+    
+    PartialBlock partial(std::move(compact));
+    std::vector<size_t> missing = partial.fillFromMempool(blockchain.getPendingTransactions());
+    if (missing.empty()) {
+        compactBlocksFromMempool++;
+        completeCompactBlock(peer, partial, false);
+    } else {
+        requestBlockTransactions(peer, std::move(partial), missing, false);
+    }
 }
 
-void NetworkEngine::handleTransactions(const NetworkMessage& message) {
-    Logger::info("Received transactions from " + message.sender);
-    // TODO: Process received transactions
+void NetworkEngine::requestBlockTransactions(const std::shared_ptr<NetworkConnection>& peer, PartialBlock block,
+                                             const std::vector<size_t>& missing, bool requestedAll) {
+    std::string hash = block.getHeader().hash;
+    {
+        std::lock_guard<std::mutex> lock(compactMutex);
+        
+        // Forget announcements whose peer never answered
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = pendingCompactBlocks.begin(); it != pendingCompactBlocks.end();) {
+            if (now - it->second.receivedAt > std::chrono::seconds(30)) {
+                it = pendingCompactBlocks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        pendingCompactBlocks.erase(hash);
+        pendingCompactBlocks.emplace(hash, PendingCompactBlock{std::move(block), peer->getFullAddress(), now, requestedAll});
+    }
+    compactTransactionsRequested += missing.size();
+    
+    NetworkMessage request;
+    request.type = MessageType::GET_BLOCK_TXN;
+    request.sender = generateNodeId();
+    request.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    request.data = {{"blockHash", hash}, {"indexes", missing}};
+    peer->sendMessage(request);
+}
+
+void NetworkEngine::completeCompactBlock(const std::shared_ptr<NetworkConnection>& peer, PartialBlock& partial,
+                                         bool requestedAll) {
+    Block block(0, "");
+    if (!partial.build(block)) {
+        if (!requestedAll) {
+            // A short ID matched the wrong pool transaction; fetch them all
+            std::vector<size_t> missing = partial.reset();
+            requestBlockTransactions(peer, std::move(partial), missing, true);
+        } else {
+            penalize(peer, 50, "Compact block that does not match its header");
+        }
+        return;
+    }
+    
+    relayAndConnect(peer, block);
 }
 
-void NetworkEngine::handleNewBlock(const NetworkMessage& message) {
-    Logger::info("New block from " + message.sender);
-    // TODO: Process new block
+// Checks a block's transactions beyond what its header commits to: each
+// must be well formed and match the hash the merkle root was built from.
+// Large blocks are split across threads.
+static bool validateBlockBody(const Block& block) {
+    const std::vector<Transaction>& transactions = block.getTransactions();
+    auto checkRange = [&transactions](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (!transactions[i].isValid() || transactions[i].calculateHash() != transactions[i].getHash()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    const size_t transactionsPerTask = 256;
+    size_t count = transactions.size();
+    size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                      (count + transactionsPerTask - 1) / transactionsPerTask);
+    if (workers <= 1) {
+        return checkRange(0, count);
+    }
+    size_t perWorker = (count + workers - 1) / workers;
+    std::vector<std::future<bool>> tasks;
+    for (size_t begin = perWorker; begin < count; begin += perWorker) {
+        tasks.push_back(std::async(std::launch::async, checkRange, begin, std::min(count, begin + perWorker)));
+    }
+    bool valid = checkRange(0, std::min(count, perWorker));
+    for (auto& task : tasks) {
+        valid = task.get() && valid;
+    }
+    return valid;
 }
 
-void NetworkEngine::handleNewTransaction(const NetworkMessage& message) {
+void NetworkEngine::relayAndConnect(const std::shared_ptr<NetworkConnection>& peer, const Block& block) {
+    // Several peers may announce the same block at once
+    if (block.getIndex() != blockchain.getChainHeight()) {
+        return;
+    }
+    
+    // Proof of work, linkage and the merkle root are already checked, so
+    // the block goes on to our peers before its transactions are: each hop
+    // then adds a link latency rather than a full validation
+    bool forward = false;
+    {
+        std::lock_guard<std::mutex> lock(compactMutex);
+        forward = relayedBlocks.emplace(block.getHash(), block).second;
+        if (forward) {
+            relayedOrder.push_back(block.getHash());
+            while (relayedOrder.size() > 16) {
+                relayedBlocks.erase(relayedOrder.front());
+                relayedOrder.pop_front();
+            }
+        }
+    }
+    if (forward) {
+        blocksCutThrough++;
+        broadcastBlock(block, peer.get());
+    }
+    
+    // An honest peer relaying cut-through can pass on one bad body before
+    // it finds out itself, so one is not enough to be dropped; repeats are
+    if (!validateBlockBody(block)) {
+        invalidBlockBodies++;
+        {
+            std::lock_guard<std::mutex> lock(compactMutex);
+            relayedBlocks.erase(block.getHash());
+        }
+        penalize(peer, 30, "Block " + std::to_string(block.getIndex()) + " with invalid transactions");
+        return;
+    }
+    if (block.getIndex() == blockchain.getChainHeight()) {
+        blockchain.addBlock(block);
+    }
+}
+
+void NetworkEngine::handleGetBlockTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    std::string hash = message.data.at("blockHash").get<std::string>();
+    
+    // Requests follow an announcement, so the block is near the tip, or
+    // was forwarded and is still being validated
+    uint64_t height = blockchain.getChainHeight();
+    Block block(0, "");
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(compactMutex);
+        auto relayed = relayedBlocks.find(hash);
+        if (relayed != relayedBlocks.end()) {
+            block = relayed->second;
+            found = true;
+        }
+    }
+    for (uint64_t i = 0; i < 16 && i < height && !found; i++) {
+        found = blockchain.getBlock(height - 1 - i, block) && block.getHash() == hash;
+    }
+    if (!found) {
+        return;
+    }
+    
+    std::vector<Transaction> transactions = block.getTransactions();
+    nlohmann::json list = nlohmann::json::array();
+    for (const auto& index : message.data.at("indexes")) {
+        size_t position = index.get<size_t>();
+        if (position >= transactions.size()) {
+            return;
+        }
+        list.push_back(transactions[position].serialize());
+    }
+    
+    NetworkMessage response;
+    response.type = MessageType::BLOCK_TXN;
+    response.sender = generateNodeId();
+    response.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    response.data = {{"blockHash", hash}, {"transactions", std::move(list)}};
+    peer->sendMessage(response);
+}
+
+void NetworkEngine::handleBlockTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    std::string hash = message.data.at("blockHash").get<std::string>();
+    std::vector<Transaction> transactions;
+    for (const auto& text : message.data.at("transactions")) {
+        transactions.push_back(Transaction::deserialize(text.get<std::string>()));
+    }
+    
+    std::unique_ptr<PendingCompactBlock> pending;
+    {
+        std::lock_guard<std::mutex> lock(compactMutex);
+        auto it = pendingCompactBlocks.find(hash);
+        if (it == pendingCompactBlocks.end() || it->second.peer != peer->getFullAddress()) {
+            return;
+        }
+        pending = std::make_unique<PendingCompactBlock>(std::move(it->second));
+        pendingCompactBlocks.erase(it);
+    }
+    
+    if (!pending->block.fillMissing(transactions)) {
+        penalize(peer, 20, "Wrong number of block transactions");
+        return;
+    }
+    completeCompactBlock(peer, pending->block, pending->requestedAll);
+}
+
+void NetworkEngine::handleInventory(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Inventory from " + peer->getFullAddress());
+    relay.handleInventory(peer, message);
+}
+
+void NetworkEngine::handleGetTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Get transactions request from " + peer->getFullAddress());
+    relay.handleGetTransactions(peer, message);
+}
+
+void NetworkEngine::handleTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::debug("Received transactions from " + peer->getFullAddress());
+    std::vector<Transaction> transactions;
+    for (const auto& json : message.data.at("transactions")) {
+        transactions.push_back(Transaction::deserialize(json.dump()));
+    }
+    relay.handleTransactions(peer, transactions);
+}
+
+void NetworkEngine::handleNewBlock(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Logger::info("New block from " + peer->getFullAddress());
+    // Full blocks come from peers with compact blocks turned off; they get
+    // the same header checks as a compact block before being forwarded
+    Block block = Block::deserialize(message.data.dump());
+    BlockHeader header = BlockHeader::fromBlock(block);
+    uint64_t height = blockchain.getChainHeight();
+    Block tip(0, "");
+    if (header.index != height || !blockchain.getBlock(height - 1, tip) || header.previousHash != tip.getHash()) {
+        return;
+    }
+    if (!header.checkProofOfWork(blockchain.getDifficulty())) {
+        penalize(peer, 100, "Block with invalid proof of work");
+        return;
+    }
+    Block check = block;
+    if (check.calculateMerkleRoot() != header.merkleRoot) {
+        penalize(peer, 50, "Block that does not match its header");
+        return;
+    }
+    relayAndConnect(peer, block);
+}
+
+void NetworkEngine::handleNewTransaction(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
     Logger::info("New transaction from " + message.sender);
-    // TODO: Process new transaction
+    // Pushed by peers that predate inventory relay; treated like a response
+    relay.handleTransactions(peer, {Transaction::deserialize(message.data.dump())});
 }
 
 void NetworkEngine::handlePeerList(const NetworkMessage& message) {
@@ -873,8 +1931,16 @@ void NetworkUtils::closeSocket(int socket) {
 }
 
 bool NetworkUtils::sendData(int socket, const std::string& data) {
-    ssize_t bytesSent = send(socket, data.c_str(), data.length(), 0);
-    return bytesSent == static_cast<ssize_t>(data.length());
+    size_t offset = 0;
+    while (offset < data.length()) {
+        ssize_t bytesSent = send(socket, data.c_str() + offset, data.length() - offset, MSG_NOSIGNAL);
+        if (bytesSent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        offset += static_cast<size_t>(bytesSent);
+    }
+    return true;
 }
 
 bool NetworkUtils::receiveData(int socket, std::string& data, size_t maxSize) {
@@ -888,17 +1954,28 @@ bool NetworkUtils::receiveData(int socket, std::string& data, size_t maxSize) {
 }
 
 bool NetworkUtils::sendMessage(int socket, const NetworkMessage& message) {
-    std::string data = message.serialize();
-    return sendData(socket, data);
+    std::string frame;
+    FrameCodec::encode(frame, FrameCodec::magicFor(NetworkConfig().networkMagic),
+                       static_cast<uint16_t>(message.type), message.serialize());
+    return sendData(socket, frame);
 }
 
 bool NetworkUtils::receiveMessage(int socket, NetworkMessage& message) {
-    std::string data;
-    if (!receiveData(socket, data)) {
+    // Blocking read of exactly one frame, never past its end
+    NetworkConfig defaults;
+    FrameDecoder decoder(defaults.networkMagic, defaults.maxMessageSize);
+    FrameView frame;
+    FrameStatus status;
+    while ((status = decoder.next(frame)) == FrameStatus::INCOMPLETE) {
+        if (decoder.fill(socket, decoder.bytesNeeded()) <= 0) {
+            return false;
+        }
+    }
+    if (status != FrameStatus::FRAME) {
         return false;
     }
     
-    message = NetworkMessage::deserialize(data);
+    message = NetworkMessage::deserialize(frame.payload);
     return message.isValid();
 }
 
@@ -959,13 +2036,21 @@ std::string NetworkUtils::decryptMessage(const std::string& encryptedMessage, co
 }
 
 std::string NetworkUtils::compressData(const std::string& data) {
-    // TODO: Implement data compression
-    return data;
+    FrameCompressor compressor;
+    std::string compressed;
+    if (!compressor.compress(data, compressed)) {
+        throw std::runtime_error("Failed to compress data");
+    }
+    return compressed;
 }
 
-std::string NetworkUtils::decompressData(const std::string& compressedData) {
-    // TODO: Implement data decompression
-    return compressedData;
+std::string NetworkUtils::decompressData(const std::string& compressedData, size_t maxSize) {
+    FrameCompressor compressor;
+    std::string data;
+    if (!compressor.decompress(compressedData, data, maxSize)) {
+        throw std::runtime_error("Invalid or oversized compressed data");
+    }
+    return data;
 }
 
 // Protocol utilities
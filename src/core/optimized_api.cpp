@@ -1,5 +1,6 @@
 #include "../include/optimized_blockchain.h"
 #include "../include/utils.h"
+#include "../include/http_parser.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -170,18 +171,42 @@ private:
         recv_timeout.tv_usec = 0;
         setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout));
 
-        char buffer[4096] = {0};
-        int bytes_read = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
-        
-        if (bytes_read <= 0) {
-            close(client_socket);
-            return;
-        }
+        HttpConnectionBuffer buffer;
+        HttpRequestParser parser;
+        bool keep_alive = true;
 
-        std::string request(buffer);
-        std::string response = process_request_optimized(request);
-        
-        send(client_socket, response.c_str(), response.length(), 0);
+        // Read until a full request is buffered; pipelined requests are served in order
+        while (!shutdown && keep_alive) {
+            HttpParseStatus status = parser.parse(buffer.data(), buffer.size());
+            if (status == HttpParseStatus::INCOMPLETE) {
+                if (buffer.fill(client_socket) <= 0) {
+                    break;
+                }
+                continue;
+            }
+
+            std::string response;
+            if (status == HttpParseStatus::ERROR) {
+                response = create_error_response(parser.getErrorStatus(), parser.getErrorMessage());
+                keep_alive = false;
+            } else {
+                keep_alive = parser.request().keepAlive;
+                response = process_request_optimized(parser.request());
+            }
+
+            size_t offset = 0;
+            while (offset < response.length()) {
+                ssize_t sent = send(client_socket, response.data() + offset, response.length() - offset, MSG_NOSIGNAL);
+                if (sent <= 0) {
+                    keep_alive = false;
+                    break;
+                }
+                offset += static_cast<size_t>(sent);
+            }
+
+            buffer.consume(parser.consumed());
+            parser.reset();
+        }
         close(client_socket);
 
         // Remove from connection pool
@@ -194,13 +219,12 @@ private:
         }
     }
 
-    std::string process_request_optimized(const std::string& request) {
+    std::string process_request_optimized(const HttpRequestView& request) {
         auto start = std::chrono::steady_clock::now();
 
-        // Parse request
-        std::istringstream request_stream(request);
-        std::string method, path, protocol;
-        request_stream >> method >> path >> protocol;
+        const std::string method(request.method);
+        const std::string path(request.target);
+        const std::string body(request.body);
 
         // Check cache first
         std::string cacheKey = method + ":" + path;
@@ -225,13 +249,13 @@ private:
         } else if (path == "/chain") {
             response = handle_chain_request();
         } else if (path == "/mine" && method == "POST") {
-            response = handle_mine_request(request);
+            response = handle_mine_request(body);
         } else if (path == "/transaction" && method == "POST") {
-            response = handle_transaction_request(request);
+            response = handle_transaction_request(body);
         } else if (path.find("/balance") == 0) {
             response = handle_balance_request(path);
         } else if (path.find("/contract/") == 0) {
-            response = handle_contract_request(path, method, request);
+            response = handle_contract_request(path, method, body);
         } else if (path == "/metrics") {
             response = handle_metrics_request();
         } else if (path == "/health") {
@@ -278,9 +302,7 @@ private:
         return create_json_response(200, response);
     }
 
-    std::string handle_mine_request(const std::string& request) {
-        // Parse request body
-        std::string body = extract_request_body(request);
+    std::string handle_mine_request(const std::string& body) {
         std::string miner_address = "system_miner";
         
         if (!body.empty()) {
@@ -314,9 +336,7 @@ private:
         }
     }
 
-    std::string handle_transaction_request(const std::string& request) {
-        std::string body = extract_request_body(request);
-        
+    std::string handle_transaction_request(const std::string& body) {
         if (body.empty()) {
             return create_error_response(400, "Request body required");
         }
@@ -365,7 +385,7 @@ private:
         }
     }
 
-    std::string handle_contract_request(const std::string& path, const std::string& method, const std::string& request) {
+    std::string handle_contract_request(const std::string& path, const std::string& method, const std::string& body) {
         // Parse contract address from path
         size_t contract_start = path.find("/contract/") + 10;
         size_t contract_end = path.find("/", contract_start);
@@ -397,6 +417,7 @@ private:
         response["transactionsProcessed"] = metrics.transactionsProcessed;
         response["blocksMined"] = metrics.blocksMined;
         response["averageResponseTime"] = metrics.averageResponseTime;
+        response["responseSamples"] = metrics.responseSamples;
         response["memoryUsage"] = metrics.memoryUsage;
         response["cpuUsage"] = metrics.cpuUsage;
         
@@ -482,14 +503,6 @@ private:
     }
 
     // Helper methods
-    std::string extract_request_body(const std::string& request) {
-        size_t body_start = request.find("\r\n\r\n");
-        if (body_start != std::string::npos) {
-            return request.substr(body_start + 4);
-        }
-        return "";
-    }
-
     std::string create_json_response(int status_code, const nlohmann::json& data) {
         std::string response = "HTTP/1.1 " + std::to_string(status_code) + " OK\r\n";
         response += "Content-Type: application/json\r\n";
@@ -0,0 +1,262 @@
+#include "peer_score.h"
+#include "networking.h"
+#include <algorithm>
+#include <cmath>
+
+// PeerScores implementation
+PeerScores::PeerScores(const PeerScoreConfig& config) : config(config), nextNonce(1) {}
+
+PeerScores::Metrics& PeerScores::metricsFor(const std::string& peer) {
+    auto inserted = peers.emplace(peer, Metrics());
+    if (inserted.second) {
+        auto now = std::chrono::steady_clock::now();
+        inserted.first->second.connectedAt = now;
+        inserted.first->second.stallUpdated = now;
+    }
+    return inserted.first->second;
+}
+
+double PeerScores::decay(double points, std::chrono::steady_clock::time_point since, std::chrono::seconds halfLife,
+                         std::chrono::steady_clock::time_point now) const {
+    double elapsed = std::chrono::duration<double>(now - since).count();
+    return points * std::exp2(-elapsed / std::max<double>(1, static_cast<double>(halfLife.count())));
+}
+
+double PeerScores::stallPointsAt(const Metrics& metrics, std::chrono::steady_clock::time_point now) const {
+    return decay(metrics.stallPoints, metrics.stallUpdated, config.stallHalfLife, now);
+}
+
+std::string PeerScores::hostOf(const std::string& peer) {
+    // Loopback carries many local nodes (the simulator, test setups), so
+    // there each port stays a host of its own
+    if (peer.compare(0, 4, "127.") == 0) {
+        return peer;
+    }
+    return peer.substr(0, peer.rfind(':'));
+}
+
+void PeerScores::trimHosts(std::chrono::steady_clock::time_point now) {
+    // Histories that have faded to nothing and serve no ban are dropped
+    for (auto it = hosts.begin(); it != hosts.end();) {
+        const HostHistory& history = it->second;
+        if (history.bannedUntil <= now &&
+            decay(history.misbehaviour, history.updated, config.historyHalfLife, now) < 1 &&
+            decay(history.stallPoints, history.updated, config.stallHalfLife, now) < 1) {
+            it = hosts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // Past the cap, forget the oldest; a flood of hosts cannot grow this
+    while (hosts.size() > config.maxHosts) {
+        auto oldest = hosts.begin();
+        for (auto it = hosts.begin(); it != hosts.end(); ++it) {
+            if (it->second.updated < oldest->second.updated) {
+                oldest = it;
+            }
+        }
+        hosts.erase(oldest);
+    }
+}
+
+double PeerScores::scoreOf(const Metrics& metrics, std::chrono::steady_clock::time_point now) const {
+    double throughputCredit = 25;
+    if (metrics.throughput > 0) {
+        throughputCredit = 50 * metrics.throughput / (metrics.throughput + config.referenceThroughput);
+    }
+    double latencyCredit = 25;
+    if (metrics.rttMillis > 0) {
+        double reference = static_cast<double>(config.referenceRtt.count());
+        latencyCredit = 50 * reference / (reference + metrics.rttMillis);
+    }
+    return throughputCredit + latencyCredit - stallPointsAt(metrics, now) - metrics.misbehaviour;
+}
+
+bool PeerScores::droppable(const Metrics& metrics, std::chrono::steady_clock::time_point now) const {
+    return metrics.misbehaviour >= config.misbehaviourLimit || stallPointsAt(metrics, now) >= config.maxStallPoints;
+}
+
+void PeerScores::peerConnected(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    peers.erase(peer);   // A reused address starts over, but not the host's record
+    Metrics& metrics = metricsFor(peer);
+    auto history = hosts.find(hostOf(peer));
+    if (history != hosts.end()) {
+        auto now = metrics.connectedAt;
+        metrics.misbehaviour = decay(history->second.misbehaviour, history->second.updated, config.historyHalfLife, now);
+        metrics.stallPoints = decay(history->second.stallPoints, history->second.updated, config.stallHalfLife, now);
+    }
+}
+
+void PeerScores::peerDisconnected(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto it = peers.find(peer);
+    if (it == peers.end()) {
+        return;
+    }
+    const Metrics& metrics = it->second;
+    auto now = std::chrono::steady_clock::now();
+    
+    // Several connections from one host leave the worst of them behind
+    HostHistory& history = hosts[hostOf(peer)];
+    history.misbehaviour = std::max(decay(history.misbehaviour, history.updated, config.historyHalfLife, now),
+                                    metrics.misbehaviour);
+    history.stallPoints = std::max(decay(history.stallPoints, history.updated, config.stallHalfLife, now),
+                                   stallPointsAt(metrics, now));
+    history.updated = now;
+    if (metrics.misbehaviour >= config.misbehaviourLimit) {
+        history.bannedUntil = std::max(history.bannedUntil, now + config.banDuration);
+    }
+    peers.erase(it);
+    trimHosts(now);
+}
+
+uint64_t PeerScores::pingSent(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    Metrics& metrics = metricsFor(peer);
+    metrics.pingNonce = nextNonce++;
+    metrics.pingSentAt = std::chrono::steady_clock::now();
+    return metrics.pingNonce;
+}
+
+bool PeerScores::pongReceived(const std::string& peer, uint64_t nonce) {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto it = peers.find(peer);
+    if (it == peers.end() || nonce == 0 || it->second.pingNonce != nonce) {
+        return false;
+    }
+    Metrics& metrics = it->second;
+    metrics.pingNonce = 0;
+    double sample = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - metrics.pingSentAt).count();
+    sample = std::max(0.01, sample);
+    metrics.rttMillis = metrics.rttMillis > 0
+        ? metrics.rttMillis * (1 - config.smoothing) + sample * config.smoothing
+        : sample;
+    return true;
+}
+
+void PeerScores::recordDelivery(const std::string& peer, size_t bytes, double seconds) {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    Metrics& metrics = metricsFor(peer);
+    double sample = bytes / std::max(0.001, seconds);
+    metrics.throughput = metrics.throughput > 0
+        ? metrics.throughput * (1 - config.smoothing) + sample * config.smoothing
+        : sample;
+    metrics.bytesDelivered += bytes;
+}
+
+void PeerScores::recordStall(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    Metrics& metrics = metricsFor(peer);
+    auto now = std::chrono::steady_clock::now();
+    metrics.stallPoints = stallPointsAt(metrics, now) + config.stallPenalty;
+    metrics.stallUpdated = now;
+    metrics.stalls++;
+    // A request that never came back says more than the last good one
+    metrics.throughput /= 2;
+}
+
+bool PeerScores::recordInvalid(const std::string& peer, double points) {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    Metrics& metrics = metricsFor(peer);
+    metrics.misbehaviour += points;
+    metrics.invalid++;
+    return metrics.misbehaviour >= config.misbehaviourLimit;
+}
+
+double PeerScores::score(const std::string& peer) const {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto it = peers.find(peer);
+    return it == peers.end() ? 50 : scoreOf(it->second, std::chrono::steady_clock::now());
+}
+
+double PeerScores::getThroughput(const std::string& peer) const {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto it = peers.find(peer);
+    return it == peers.end() ? 0 : it->second.throughput;
+}
+
+double PeerScores::getRtt(const std::string& peer) const {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto it = peers.find(peer);
+    return it == peers.end() ? 0 : it->second.rttMillis;
+}
+
+bool PeerScores::shouldDisconnect(const std::string& peer) const {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto it = peers.find(peer);
+    return it != peers.end() && droppable(it->second, std::chrono::steady_clock::now());
+}
+
+bool PeerScores::isBanned(const std::string& host) const {
+    return bannedUntil(host) > std::chrono::steady_clock::now();
+}
+
+std::chrono::steady_clock::time_point PeerScores::bannedUntil(const std::string& host) const {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto it = hosts.find(host);
+    return it == hosts.end() ? std::chrono::steady_clock::time_point() : it->second.bannedUntil;
+}
+
+void PeerScores::rank(std::vector<std::shared_ptr<NetworkConnection>>& connections) const {
+    std::vector<std::pair<double, std::shared_ptr<NetworkConnection>>> scored;
+    scored.reserve(connections.size());
+    {
+        std::lock_guard<std::mutex> lock(scoreMutex);
+        auto now = std::chrono::steady_clock::now();
+        for (auto& connection : connections) {
+            auto it = peers.find(connection->getFullAddress());
+            scored.emplace_back(it == peers.end() ? 50 : scoreOf(it->second, now), std::move(connection));
+        }
+    }
+    std::stable_sort(scored.begin(), scored.end(),
+                     [](const std::pair<double, std::shared_ptr<NetworkConnection>>& a,
+                        const std::pair<double, std::shared_ptr<NetworkConnection>>& b) {
+                         return a.first > b.first;
+                     });
+    for (size_t i = 0; i < scored.size(); i++) {
+        connections[i] = std::move(scored[i].second);
+    }
+}
+
+std::string PeerScores::selectEviction(const std::vector<std::string>& candidates) const {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto now = std::chrono::steady_clock::now();
+    std::string worst;
+    double worstScore = 0;
+    for (const auto& candidate : candidates) {
+        auto it = peers.find(candidate);
+        if (it == peers.end() || now - it->second.connectedAt < config.evictionGracePeriod) {
+            continue;
+        }
+        double value = scoreOf(it->second, now);
+        if (value >= config.evictionThreshold) {
+            continue;
+        }
+        if (worst.empty() || value < worstScore) {
+            worst = candidate;
+            worstScore = value;
+        }
+    }
+    return worst;
+}
+
+nlohmann::json PeerScores::getStats() const {
+    std::lock_guard<std::mutex> lock(scoreMutex);
+    auto now = std::chrono::steady_clock::now();
+    nlohmann::json stats = nlohmann::json::array();
+    for (const auto& pair : peers) {
+        const Metrics& metrics = pair.second;
+        stats.push_back({
+            {"address", pair.first},
+            {"score", scoreOf(metrics, now)},
+            {"rttMillis", metrics.rttMillis},
+            {"throughput", metrics.throughput},
+            {"bytesDelivered", metrics.bytesDelivered},
+            {"stalls", metrics.stalls},
+            {"invalid", metrics.invalid},
+            {"misbehaviour", metrics.misbehaviour}
+        });
+    }
+    return stats;
+}
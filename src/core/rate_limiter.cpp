@@ -0,0 +1,113 @@
+#include "rate_limiter.h"
+#include <algorithm>
+#include <functional>
+
+// TokenBucket implementation
+TokenBucket::TokenBucket(double ratePerSecond, double burst, std::chrono::steady_clock::time_point now)
+    : ratePerSecond(ratePerSecond), burst(burst), tokens(burst), lastRefill(now) {}
+
+void TokenBucket::refill(std::chrono::steady_clock::time_point now) {
+    if (now <= lastRefill) {
+        return;
+    }
+    double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+    tokens = std::min(burst, tokens + elapsed * ratePerSecond);
+    lastRefill = now;
+}
+
+bool TokenBucket::tryConsume(double cost, std::chrono::steady_clock::time_point now) {
+    refill(now);
+    if (tokens < cost) {
+        return false;
+    }
+    tokens -= cost;
+    return true;
+}
+
+void TokenBucket::charge(double cost, std::chrono::steady_clock::time_point now) {
+    refill(now);
+    tokens -= cost;
+}
+
+double TokenBucket::secondsUntilAvailable(double cost, std::chrono::steady_clock::time_point now) {
+    refill(now);
+    if (tokens >= cost) {
+        return 0.0;
+    }
+    if (ratePerSecond <= 0.0) {
+        return -1.0;
+    }
+    return (cost - tokens) / ratePerSecond;
+}
+
+void TokenBucket::setRate(double newRate, double newBurst) {
+    ratePerSecond = newRate;
+    burst = newBurst;
+    tokens = std::min(tokens, burst);
+}
+
+// RateLimiter implementation
+RateLimiter::RateLimiter(double ratePerSecond, double burst, size_t maxKeys, size_t shardCount)
+    : ratePerSecond(ratePerSecond), burst(burst) {
+    shardCount = std::max<size_t>(1, shardCount);
+    maxKeysPerShard = std::max<size_t>(1, maxKeys / shardCount);
+    for (size_t i = 0; i < shardCount; i++) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+RateLimiter::Shard& RateLimiter::shardFor(const std::string& key) {
+    return *shards[std::hash<std::string>()(key) % shards.size()];
+}
+
+bool RateLimiter::allow(const std::string& key, double cost, double* retryAfterSeconds) {
+    auto now = std::chrono::steady_clock::now();
+    double rate = ratePerSecond;
+    double capacity = burst;
+
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.shardMutex);
+
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        if (shard.entries.size() >= maxKeysPerShard) {
+            shard.entries.erase(shard.lru.back().key);
+            shard.lru.pop_back();
+            evicted++;
+        }
+        shard.lru.push_front(Entry{key, TokenBucket(rate, capacity, now)});
+        it = shard.entries.emplace(key, shard.lru.begin()).first;
+    } else {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    }
+
+    TokenBucket& bucket = it->second->bucket;
+    if (bucket.getRate() != rate || bucket.getBurst() != capacity) {
+        bucket.setRate(rate, capacity);
+    }
+
+    if (bucket.tryConsume(cost, now)) {
+        allowed++;
+        return true;
+    }
+
+    limited++;
+    if (retryAfterSeconds) {
+        *retryAfterSeconds = bucket.secondsUntilAvailable(cost, now);
+    }
+    return false;
+}
+
+void RateLimiter::setRate(double newRate, double newBurst) {
+    ratePerSecond = newRate;
+    burst = newBurst;
+}
+
+size_t RateLimiter::size() {
+    size_t total = 0;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->shardMutex);
+        total += shard->entries.size();
+    }
+    return total;
+}
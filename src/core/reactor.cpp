@@ -0,0 +1,332 @@
+#include "reactor.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+// Reactor implementation
+Reactor::Reactor() : running(false), nextGeneration(1), nextTimerId(1) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = 0;   // Generation 0 is reserved for the wakeup fd
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+}
+
+Reactor::~Reactor() {
+    stop();
+    close(wakeFd);
+    close(epollFd);
+}
+
+void Reactor::start() {
+    if (running) return;
+    running = true;
+    loopThread = std::thread(&Reactor::loop, this);
+}
+
+void Reactor::stop() {
+    if (!running) return;
+    running = false;
+    wake();
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+    loopThreadId = std::thread::id();
+}
+
+void Reactor::wake() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+bool Reactor::add(int fd, uint32_t events, IoHandler handler) {
+    std::lock_guard<std::mutex> lock(handlersMutex);
+    uint32_t generation = nextGeneration++;
+    if (nextGeneration == 0) {
+        nextGeneration = 1;
+    }
+
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.u64 = (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        Logger::error("epoll_ctl ADD failed: " + std::string(std::strerror(errno)));
+        return false;
+    }
+    handlers[fd] = {generation, std::make_shared<IoHandler>(std::move(handler))};
+    return true;
+}
+
+bool Reactor::modify(int fd, uint32_t events) {
+    std::lock_guard<std::mutex> lock(handlersMutex);
+    auto it = handlers.find(fd);
+    if (it == handlers.end()) {
+        return false;
+    }
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.u64 = (static_cast<uint64_t>(it->second.generation) << 32) | static_cast<uint32_t>(fd);
+    return epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void Reactor::remove(int fd) {
+    std::lock_guard<std::mutex> lock(handlersMutex);
+    if (handlers.erase(fd) > 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+void Reactor::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        posted.push_back(std::move(task));
+    }
+    wake();
+}
+
+Reactor::TimerId Reactor::runAfter(std::chrono::milliseconds delay, Task task) {
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(timersMutex);
+        id = nextTimerId++;
+        timers[id] = {std::chrono::milliseconds(0), std::move(task)};
+        timerHeap.push_back({std::chrono::steady_clock::now() + delay, id});
+        std::push_heap(timerHeap.begin(), timerHeap.end(), std::greater<Timer>());
+    }
+    wake();
+    return id;
+}
+
+Reactor::TimerId Reactor::runEvery(std::chrono::milliseconds interval, Task task) {
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(timersMutex);
+        id = nextTimerId++;
+        timers[id] = {std::max(interval, std::chrono::milliseconds(1)), std::move(task)};
+        timerHeap.push_back({std::chrono::steady_clock::now() + interval, id});
+        std::push_heap(timerHeap.begin(), timerHeap.end(), std::greater<Timer>());
+    }
+    wake();
+    return id;
+}
+
+void Reactor::cancelTimer(TimerId id) {
+    // The heap entry is skipped when it comes due
+    std::lock_guard<std::mutex> lock(timersMutex);
+    timers.erase(id);
+}
+
+int Reactor::runDueTimers() {
+    while (true) {
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(timersMutex);
+            if (timerHeap.empty()) {
+                return -1;
+            }
+            auto now = std::chrono::steady_clock::now();
+            Timer next = timerHeap.front();
+            if (next.deadline > now) {
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next.deadline - now).count();
+                return static_cast<int>(std::min<int64_t>(wait + 1, 60000));
+            }
+
+            std::pop_heap(timerHeap.begin(), timerHeap.end(), std::greater<Timer>());
+            timerHeap.pop_back();
+            auto it = timers.find(next.id);
+            if (it == timers.end()) {
+                continue;   // Cancelled
+            }
+            task = it->second.task;
+            if (it->second.interval.count() > 0) {
+                timerHeap.push_back({now + it->second.interval, next.id});
+                std::push_heap(timerHeap.begin(), timerHeap.end(), std::greater<Timer>());
+            } else {
+                timers.erase(it);
+            }
+        }
+        task();
+    }
+}
+
+void Reactor::runPosted() {
+    std::deque<Task> batch;
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        batch.swap(posted);
+    }
+    for (auto& task : batch) {
+        task();
+    }
+}
+
+void Reactor::loop() {
+    loopThreadId = std::this_thread::get_id();
+    std::vector<struct epoll_event> events(256);
+
+    while (running) {
+        int timeout = runDueTimers();
+        int ready = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            Logger::error("epoll_wait failed: " + std::string(std::strerror(errno)));
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            uint64_t data = events[i].data.u64;
+            uint32_t generation = static_cast<uint32_t>(data >> 32);
+            int fd = static_cast<int>(data & 0xffffffff);
+
+            if (generation == 0) {
+                uint64_t count;
+                ssize_t drained = read(wakeFd, &count, sizeof(count));
+                (void)drained;
+                continue;
+            }
+
+            std::shared_ptr<IoHandler> handler;
+            {
+                std::lock_guard<std::mutex> lock(handlersMutex);
+                auto it = handlers.find(fd);
+                if (it != handlers.end() && it->second.generation == generation) {
+                    handler = it->second.handler;
+                }
+            }
+            if (handler) {
+                (*handler)(events[i].events);
+            }
+        }
+
+        runPosted();
+    }
+
+    // Tasks posted during shutdown still run so their resources are released
+    runPosted();
+}
+
+// WorkerPool implementation
+WorkerPool::WorkerPool() : pending(0), stopping(false) {
+    // Deep enough to absorb a burst from every peer; weights give blocks
+    // the bulk of a busy pool without starving anything
+    configureLane(Lane::CONSENSUS, 4096, 8);
+    configureLane(Lane::HEADERS, 1024, 4);
+    configureLane(Lane::TRANSACTIONS, 16384, 2);
+    configureLane(Lane::HOUSEKEEPING, 1024, 1);
+}
+
+void WorkerPool::configureLane(Lane lane, size_t capacity, unsigned weight) {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    LaneQueue& queue = lanes[static_cast<size_t>(lane)];
+    queue.capacity = std::max<size_t>(1, capacity);
+    queue.weight = std::max(1u, weight);
+    queue.credits = queue.weight;
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start(size_t threadCount) {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    if (!workers.empty()) return;
+    stopping = false;
+    for (size_t i = 0; i < std::max<size_t>(1, threadCount); i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        stopping = true;
+    }
+    tasksCV.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+bool WorkerPool::submit(std::function<void()> task, Lane lane) {
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        LaneQueue& queue = lanes[static_cast<size_t>(lane)];
+        if (queue.tasks.size() >= queue.capacity) {
+            queue.dropped++;
+            return false;
+        }
+        queue.tasks.push_back(Task{std::move(task), std::chrono::steady_clock::now()});
+        pending++;
+    }
+    tasksCV.notify_one();
+    return true;
+}
+
+size_t WorkerPool::pickLane() {
+    // Called with tasks pending, so the second pass always finds one
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < LANE_COUNT; i++) {
+            if (!lanes[i].tasks.empty() && lanes[i].credits > 0) {
+                lanes[i].credits--;
+                return i;
+            }
+        }
+        // Every backlogged lane has had its share; start a new round
+        for (auto& queue : lanes) {
+            queue.credits = queue.weight;
+        }
+    }
+    return 0;
+}
+
+LaneStats WorkerPool::getLaneStats(Lane lane) const {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    const LaneQueue& queue = lanes[static_cast<size_t>(lane)];
+    LaneStats stats;
+    stats.queued = queue.tasks.size();
+    stats.processed = queue.processed;
+    stats.dropped = queue.dropped;
+    stats.meanWaitMillis = queue.processed > 0 ? queue.totalWaitMillis / queue.processed : 0;
+    stats.maxWaitMillis = queue.maxWaitMillis;
+    return stats;
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(tasksMutex);
+            tasksCV.wait(lock, [this] { return stopping || pending > 0; });
+            if (pending == 0) {
+                return;   // Stopping and drained
+            }
+            LaneQueue& queue = lanes[pickLane()];
+            double waited = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - queue.tasks.front().queuedAt).count();
+            queue.totalWaitMillis += waited;
+            queue.maxWaitMillis = std::max(queue.maxWaitMillis, waited);
+            queue.processed++;
+            task = std::move(queue.tasks.front().run);
+            queue.tasks.pop_front();
+            pending--;
+        }
+        try {
+            task();
+        } catch (const std::exception& e) {
+            Logger::error("Worker task failed: " + std::string(e.what()));
+        }
+    }
+}
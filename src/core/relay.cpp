@@ -0,0 +1,250 @@
+#include "relay.h"
+#include "networking.h"
+#include "logger.h"
+#include <algorithm>
+
+// TransactionRelay::RollingSet implementation
+bool TransactionRelay::RollingSet::insert(const std::string& hash, size_t limit) {
+    if (!entries.insert(hash).second) {
+        return false;
+    }
+    order.push_back(hash);
+    while (order.size() > limit) {
+        entries.erase(order.front());
+        order.pop_front();
+    }
+    return true;
+}
+
+// TransactionRelay implementation
+TransactionRelay::TransactionRelay(Blockchain& blockchain, const RelayConfig& config)
+    : blockchain(blockchain), config(config), nodeId(NetworkUtils::generateNodeId()),
+      rng(std::random_device()()), transactionsRelayed(0), announcementsSent(0), announcementsReceived(0),
+      announcementsDropped(0), transactionsRequested(0), transactionsServed(0) {}
+
+NetworkMessage TransactionRelay::makeMessage(MessageType type, nlohmann::json data) const {
+    NetworkMessage message;
+    message.type = type;
+    message.sender = nodeId;
+    message.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    message.data = std::move(data);
+    return message;
+}
+
+void TransactionRelay::send(Outbox& outbox) {
+    for (auto& entry : outbox) {
+        entry.first->sendMessage(entry.second);
+    }
+    outbox.clear();
+}
+
+std::chrono::steady_clock::time_point TransactionRelay::nextFlushTime(std::chrono::steady_clock::time_point now) {
+    std::exponential_distribution<double> delay(1.0 / std::max<int64_t>(1, config.meanAnnounceInterval.count()));
+    return now + std::chrono::milliseconds(static_cast<int64_t>(delay(rng)));
+}
+
+TransactionRelay::PeerState& TransactionRelay::peerFor(const std::shared_ptr<NetworkConnection>& connection) {
+    auto inserted = peers.emplace(connection->getFullAddress(), PeerState());
+    PeerState& state = inserted.first->second;
+    if (inserted.second) {
+        state.nextFlush = nextFlushTime(std::chrono::steady_clock::now());
+    }
+    state.connection = connection;
+    return state;
+}
+
+bool TransactionRelay::queueLocked(const Transaction& transaction, const std::string& source) {
+    const std::string hash = transaction.getHash();
+    if (relayPool.count(hash)) {
+        return false;
+    }
+    seen.insert(hash, config.maxSeen);
+
+    relayPool.emplace(hash, transaction);
+    relayOrder.push_back(hash);
+    while (relayOrder.size() > config.maxRelayPool) {
+        relayPool.erase(relayOrder.front());
+        relayOrder.pop_front();
+    }
+
+    for (auto& pair : peers) {
+        if (pair.first == source || pair.second.known.contains(hash)) {
+            continue;
+        }
+        // A peer that cannot keep up misses announcements rather than
+        // holding unbounded memory; other peers will still announce them
+        if (pair.second.queued.size() >= config.maxQueuedPerPeer) {
+            announcementsDropped++;
+            continue;
+        }
+        pair.second.queued.push_back(hash);
+    }
+    transactionsRelayed++;
+    return true;
+}
+
+bool TransactionRelay::relay(const Transaction& transaction, const std::string& sourcePeer) {
+    std::lock_guard<std::mutex> lock(relayMutex);
+    return queueLocked(transaction, sourcePeer);
+}
+
+void TransactionRelay::tick(const std::vector<std::shared_ptr<NetworkConnection>>& connections) {
+    Outbox outbox;
+    {
+        std::lock_guard<std::mutex> lock(relayMutex);
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto it = peers.begin(); it != peers.end();) {
+            auto connection = it->second.connection.lock();
+            if (!connection || !connection->isConnected()) {
+                it = peers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // Walk connections in the order given so better peers hear first
+        for (const auto& connection : connections) {
+            if (!connection->isConnected()) {
+                continue;
+            }
+            PeerState& state = peerFor(connection);
+            // A congested peer keeps accumulating, and gets the backlog
+            // coalesced into full INVENTORY messages once it drains
+            if (now >= state.nextFlush && !connection->isCongested()) {
+                state.nextFlush = nextFlushTime(now);
+                for (size_t start = 0; start < state.queued.size(); start += config.maxAnnouncementsPerMessage) {
+                    size_t end = std::min(state.queued.size(), start + config.maxAnnouncementsPerMessage);
+                    nlohmann::json hashes = nlohmann::json::array();
+                    for (size_t i = start; i < end; i++) {
+                        // Skip anything the peer announced to us while it sat in the queue
+                        if (state.known.insert(state.queued[i], config.maxKnownPerPeer)) {
+                            hashes.push_back(state.queued[i]);
+                        }
+                    }
+                    if (!hashes.empty()) {
+                        announcementsSent += hashes.size();
+                        outbox.emplace_back(connection, makeMessage(MessageType::INVENTORY, {
+                            {"transactionIds", std::move(hashes)}
+                        }));
+                    }
+                }
+                state.queued.clear();
+            }
+        }
+
+        // A request that went unanswered may be retried on the next announcement
+        for (auto it = requested.begin(); it != requested.end();) {
+            if (now - it->second.sentAt > config.requestTimeout) {
+                it = requested.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    send(outbox);
+}
+
+void TransactionRelay::handleInventory(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    Outbox outbox;
+    {
+        std::lock_guard<std::mutex> lock(relayMutex);
+        PeerState& state = peerFor(peer);
+        auto now = std::chrono::steady_clock::now();
+
+        std::vector<std::string> wanted;
+        for (const auto& entry : message.data.at("transactionIds")) {
+            const std::string& hash = entry.get_ref<const std::string&>();
+            announcementsReceived++;
+            state.known.insert(hash, config.maxKnownPerPeer);
+            if (seen.contains(hash) || requested.count(hash)) {
+                continue;
+            }
+            requested[hash] = Request{peer->getFullAddress(), now};
+            wanted.push_back(hash);
+        }
+
+        if (!wanted.empty()) {
+            transactionsRequested += wanted.size();
+            outbox.emplace_back(peer, makeMessage(MessageType::GET_TRANSACTIONS, {
+                {"transactionIds", std::move(wanted)}
+            }));
+        }
+    }
+    send(outbox);
+}
+
+void TransactionRelay::handleGetTransactions(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    nlohmann::json transactions = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lock(relayMutex);
+        PeerState& state = peerFor(peer);
+        for (const auto& entry : message.data.at("transactionIds")) {
+            const std::string& hash = entry.get_ref<const std::string&>();
+            auto it = relayPool.find(hash);
+            if (it == relayPool.end()) {
+                continue;
+            }
+            state.known.insert(hash, config.maxKnownPerPeer);
+            transactions.push_back(nlohmann::json::parse(it->second.serialize()));
+        }
+        transactionsServed += transactions.size();
+    }
+    if (!transactions.empty()) {
+        peer->sendMessage(makeMessage(MessageType::TRANSACTIONS, {{"transactions", std::move(transactions)}}));
+    }
+}
+
+void TransactionRelay::handleTransactions(const std::shared_ptr<NetworkConnection>& peer,
+                                          const std::vector<Transaction>& transactions) {
+    std::string source = peer->getFullAddress();
+    for (const Transaction& transaction : transactions) {
+        const std::string hash = transaction.getHash();
+        {
+            std::lock_guard<std::mutex> lock(relayMutex);
+            peerFor(peer).known.insert(hash, config.maxKnownPerPeer);
+            requested.erase(hash);
+            if (!seen.insert(hash, config.maxSeen)) {
+                continue;
+            }
+        }
+
+        // The pool does its own validation; only what it accepts goes onward
+        if (blockchain.addTransaction(transaction)) {
+            std::lock_guard<std::mutex> lock(relayMutex);
+            queueLocked(transaction, source);
+        }
+    }
+}
+
+void TransactionRelay::peerConnected(const std::shared_ptr<NetworkConnection>& peer) {
+    std::lock_guard<std::mutex> lock(relayMutex);
+    peerFor(peer);
+}
+
+void TransactionRelay::peerDisconnected(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(relayMutex);
+    peers.erase(peer);
+    for (auto it = requested.begin(); it != requested.end();) {
+        if (it->second.peer == peer) {
+            it = requested.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+nlohmann::json TransactionRelay::getStats() const {
+    std::lock_guard<std::mutex> lock(relayMutex);
+    nlohmann::json stats;
+    stats["transactionsRelayed"] = transactionsRelayed;
+    stats["announcementsSent"] = announcementsSent;
+    stats["announcementsReceived"] = announcementsReceived;
+    stats["announcementsDropped"] = announcementsDropped;
+    stats["transactionsRequested"] = transactionsRequested;
+    stats["transactionsServed"] = transactionsServed;
+    stats["requestsInFlight"] = requested.size();
+    stats["relayPoolSize"] = relayPool.size();
+    return stats;
+}
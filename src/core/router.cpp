@@ -0,0 +1,294 @@
+#include "router.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+// LatencyHistogram implementation
+LatencyHistogram::LatencyHistogram() {
+    for (auto& count : counts) {
+        count = 0;
+    }
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t micros) {
+    if (micros < 2 * SUB_BUCKETS) {
+        return static_cast<size_t>(micros);
+    }
+    // Keep the top four significant bits: the position of the leading one
+    // picks the power of two, the next three bits the linear sub-bucket
+    int msb = 63 - __builtin_clzll(micros);
+    int shift = msb - 3;
+    size_t top = static_cast<size_t>(micros >> shift);   // 8..15
+    return 2 * SUB_BUCKETS + static_cast<size_t>(msb - 4) * SUB_BUCKETS + (top - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < 2 * SUB_BUCKETS) {
+        return index;
+    }
+    size_t msb = (index - 2 * SUB_BUCKETS) / SUB_BUCKETS + 4;
+    uint64_t top = (index - 2 * SUB_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS;
+    int shift = static_cast<int>(msb) - 3;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    counts[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sumMicros.fetch_add(micros, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double quantile) const {
+    uint64_t count = total.load(std::memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(quantile * count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(BUCKET_COUNT - 1);
+}
+
+uint64_t LatencyHistogram::countAtOrBelow(uint64_t micros) const {
+    // Buckets straddling the bound are excluded, so this can undercount by
+    // at most one sub-bucket's worth of samples
+    uint64_t result = 0;
+    for (size_t i = 0; i < BUCKET_COUNT && bucketUpperBound(i) <= micros; i++) {
+        result += counts[i].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+// Router implementation
+Router::Router() {
+    notFound.method = "*";
+    notFound.pattern = "unmatched";
+}
+
+void Router::addRoute(const std::string& method, const std::string& pattern, Handler handler) {
+    auto route = std::make_unique<Route>();
+    route->method = method;
+    route->pattern = pattern;
+    route->handler = std::move(handler);
+
+    if (pattern.find('{') == std::string::npos) {
+        staticRoutes[method + " " + pattern] = route.get();
+    } else {
+        TrieNode* node = &root;
+        size_t pos = 1;
+        while (pos <= pattern.size()) {
+            size_t slash = pattern.find('/', pos);
+            if (slash == std::string::npos) {
+                slash = pattern.size();
+            }
+            std::string segment = pattern.substr(pos, slash - pos);
+            if (!segment.empty() && segment.front() == '{') {
+                if (!node->param) {
+                    node->param = std::make_unique<TrieNode>();
+                }
+                node = node->param.get();
+            } else {
+                auto& child = node->children[segment];
+                if (!child) {
+                    child = std::make_unique<TrieNode>();
+                }
+                node = child.get();
+            }
+            pos = slash + 1;
+        }
+        node->routes[method] = route.get();
+    }
+    routes.push_back(std::move(route));
+}
+
+void Router::setNotFoundHandler(Handler handler) {
+    notFound.handler = std::move(handler);
+}
+
+Router::Route* Router::matchTrie(const TrieNode& node, std::string_view method, std::string_view path,
+                                 std::vector<std::string_view>& params) const {
+    if (path.empty()) {
+        auto it = node.routes.find(std::string(method));
+        if (it == node.routes.end()) {
+            it = node.routes.find("*");
+        }
+        return it != node.routes.end() ? it->second : nullptr;
+    }
+
+    // path is "/segment[/rest]"
+    size_t slash = path.find('/', 1);
+    std::string_view segment = path.substr(1, slash == std::string_view::npos ? std::string_view::npos : slash - 1);
+    std::string_view rest = slash == std::string_view::npos ? std::string_view() : path.substr(slash);
+
+    // Literal segments take precedence over parameters
+    auto child = node.children.find(std::string(segment));
+    if (child != node.children.end()) {
+        Route* route = matchTrie(*child->second, method, rest, params);
+        if (route) {
+            return route;
+        }
+    }
+    if (node.param && !segment.empty()) {
+        params.push_back(segment);
+        Route* route = matchTrie(*node.param, method, rest, params);
+        if (route) {
+            return route;
+        }
+        params.pop_back();
+    }
+    return nullptr;
+}
+
+Router::Route* Router::match(std::string_view method, std::string_view path,
+                             std::vector<std::string_view>& params) const {
+    std::string key;
+    key.reserve(method.size() + path.size() + 1);
+    key.append(method).append(" ").append(path);
+    auto it = staticRoutes.find(key);
+    if (it != staticRoutes.end()) {
+        return it->second;
+    }
+    it = staticRoutes.find("* " + std::string(path));
+    if (it != staticRoutes.end()) {
+        return it->second;
+    }
+    if (path.empty() || path.front() != '/') {
+        return nullptr;
+    }
+    return matchTrie(root, method, path, params);
+}
+
+void Router::recordResult(Route& route, RouteContext& context, const std::string& response, uint64_t micros) {
+    // Buffered responses carry their status line; streams report it themselves
+    if (!response.empty()) {
+        context.bytesSent = response.size();
+        if (response.size() > 12 && response.compare(0, 5, "HTTP/") == 0) {
+            context.status = std::atoi(response.c_str() + 9);
+        }
+    }
+    if (context.status == 0) {
+        context.status = 200;
+    }
+
+    route.stats.requests.fetch_add(1, std::memory_order_relaxed);
+    if (context.status >= 400) {
+        route.stats.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    route.stats.bytesIn.fetch_add(context.request.body.size(), std::memory_order_relaxed);
+    route.stats.bytesOut.fetch_add(context.bytesSent, std::memory_order_relaxed);
+    route.stats.latency.record(micros);
+}
+
+std::string Router::dispatch(RouteContext& context) {
+    auto start = std::chrono::steady_clock::now();
+
+    Route* route = match(context.request.method, context.request.path, context.params);
+    if (!route) {
+        route = &notFound;
+    }
+
+    std::string response;
+    try {
+        response = route->handler ? route->handler(context) : std::string();
+    } catch (...) {
+        // Count the failure, then let the caller turn it into a response
+        context.status = 500;
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        recordResult(*route, context, response, static_cast<uint64_t>(micros));
+        throw;
+    }
+
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    recordResult(*route, context, response, static_cast<uint64_t>(micros));
+    return response;
+}
+
+std::string Router::renderMetrics() const {
+    // Bucket bounds exported to Prometheus, in seconds
+    static const double BOUNDS[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                    0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+
+    // Stable output order, with the catch-all route last
+    std::map<std::string, const Route*> ordered;
+    for (const auto& route : routes) {
+        ordered[route->pattern + " " + route->method] = route.get();
+    }
+
+    std::vector<const Route*> all;
+    for (const auto& pair : ordered) {
+        all.push_back(pair.second);
+    }
+    all.push_back(&notFound);
+
+    auto labels = [](const Route* route) {
+        return "method=\"" + route->method + "\",route=\"" + route->pattern + "\"";
+    };
+
+    std::ostringstream out;
+    out << "# HELP nilotic_http_requests_total HTTP requests handled, by route.\n";
+    out << "# TYPE nilotic_http_requests_total counter\n";
+    for (const Route* route : all) {
+        out << "nilotic_http_requests_total{" << labels(route) << "} " << route->stats.requests << "\n";
+    }
+
+    out << "# HELP nilotic_http_request_errors_total HTTP responses with status >= 400, by route.\n";
+    out << "# TYPE nilotic_http_request_errors_total counter\n";
+    for (const Route* route : all) {
+        out << "nilotic_http_request_errors_total{" << labels(route) << "} " << route->stats.errors << "\n";
+    }
+
+    out << "# HELP nilotic_http_request_bytes_total Request body bytes received, by route.\n";
+    out << "# TYPE nilotic_http_request_bytes_total counter\n";
+    for (const Route* route : all) {
+        out << "nilotic_http_request_bytes_total{" << labels(route) << "} " << route->stats.bytesIn << "\n";
+    }
+
+    out << "# HELP nilotic_http_response_bytes_total Response bytes sent, by route.\n";
+    out << "# TYPE nilotic_http_response_bytes_total counter\n";
+    for (const Route* route : all) {
+        out << "nilotic_http_response_bytes_total{" << labels(route) << "} " << route->stats.bytesOut << "\n";
+    }
+
+    out << "# HELP nilotic_http_request_duration_seconds Time spent handling requests, by route.\n";
+    out << "# TYPE nilotic_http_request_duration_seconds histogram\n";
+    char value[32];
+    for (const Route* route : all) {
+        const LatencyHistogram& latency = route->stats.latency;
+        uint64_t count = latency.getCount();
+        for (double bound : BOUNDS) {
+            snprintf(value, sizeof(value), "%g", bound);
+            out << "nilotic_http_request_duration_seconds_bucket{" << labels(route) << ",le=\"" << value << "\"} "
+                << latency.countAtOrBelow(static_cast<uint64_t>(bound * 1e6)) << "\n";
+        }
+        out << "nilotic_http_request_duration_seconds_bucket{" << labels(route) << ",le=\"+Inf\"} " << count << "\n";
+        snprintf(value, sizeof(value), "%.6f", latency.getSumMicros() / 1e6);
+        out << "nilotic_http_request_duration_seconds_sum{" << labels(route) << "} " << value << "\n";
+        out << "nilotic_http_request_duration_seconds_count{" << labels(route) << "} " << count << "\n";
+    }
+
+    // Quantiles from the full-resolution histogram, which the coarse
+    // Prometheus buckets above cannot reproduce
+    out << "# HELP nilotic_http_request_duration_quantile_seconds Request latency quantiles, by route.\n";
+    out << "# TYPE nilotic_http_request_duration_quantile_seconds gauge\n";
+    for (const Route* route : all) {
+        for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+            snprintf(value, sizeof(value), "%.6f", route->stats.latency.percentile(quantile) / 1e6);
+            out << "nilotic_http_request_duration_quantile_seconds{" << labels(route)
+                << ",quantile=\"" << quantile << "\"} " << value << "\n";
+        }
+    }
+    return out.str();
+}
@@ -0,0 +1,238 @@
+#include "rpc.h"
+#include <future>
+#include <thread>
+#include <algorithm>
+
+namespace {
+
+// Thrown by method implementations to report a JSON-RPC error
+struct RpcError {
+    int code;
+    std::string message;
+};
+
+// Positional ([x]) or named ({"name": x}) parameter lookup
+const nlohmann::json& param(const nlohmann::json& call, size_t position, const char* name) {
+    static const nlohmann::json missing;
+    if (!call.contains("params")) {
+        return missing;
+    }
+    const nlohmann::json& params = call["params"];
+    if (params.is_array() && position < params.size()) {
+        return params[position];
+    }
+    if (params.is_object() && params.contains(name)) {
+        return params[name];
+    }
+    return missing;
+}
+
+std::string stringParam(const nlohmann::json& call, size_t position, const char* name) {
+    const nlohmann::json& value = param(call, position, name);
+    if (!value.is_string()) {
+        throw RpcError{JsonRpcServer::INVALID_PARAMS, std::string("Expected string parameter '") + name + "'"};
+    }
+    return value.get<std::string>();
+}
+
+uint64_t indexParam(const nlohmann::json& call, size_t position, const char* name) {
+    const nlohmann::json& value = param(call, position, name);
+    if (!value.is_number_unsigned() && !(value.is_number_integer() && value.get<int64_t>() >= 0)) {
+        throw RpcError{JsonRpcServer::INVALID_PARAMS, std::string("Expected non-negative integer '") + name + "'"};
+    }
+    return value.get<uint64_t>();
+}
+
+// Compact transaction JSON (Transaction::serialize is indented)
+std::string transactionJson(const Transaction& tx) {
+    std::string out;
+    JsonWriter json(out);
+    tx.writeJson(json);
+    return out;
+}
+
+} // namespace
+
+JsonRpcServer::JsonRpcServer(Blockchain& blockchain, BlockResponseCache& blockCache, size_t maxBatchSize)
+    : blockchain(blockchain), blockCache(blockCache), maxBatchSize(maxBatchSize) {}
+
+// Serialized block from the cache when it matches the snapshot, so readers
+// never see a block from a chain that has since been replaced
+std::string JsonRpcServer::blockResult(const ChainView& view, uint64_t index) {
+    if (index >= view.chain.size()) {
+        throw RpcError{INVALID_PARAMS, "Block index out of range"};
+    }
+    const Block& block = view.chain[index];
+    auto entry = blockCache.get(index);
+    if (!entry || entry->hash != block.getHash()) {
+        entry = BlockResponseCache::build(block, false);
+    }
+    return entry->body;
+}
+
+void JsonRpcServer::execute(const nlohmann::json& call, const ChainView& view, CallResult& out) {
+    if (!call.is_object() || !call.contains("jsonrpc") || !call["jsonrpc"].is_string() ||
+        call["jsonrpc"] != "2.0" || !call.contains("method") ||
+        !call["method"].is_string() ||
+        (call.contains("params") && !call["params"].is_array() && !call["params"].is_object())) {
+        out.errorCode = INVALID_REQUEST;
+        out.errorMessage = "Invalid Request";
+        if (call.is_object() && call.contains("id")) {
+            out.id = call["id"];
+        }
+        return;
+    }
+
+    out.isNotification = !call.contains("id");
+    if (!out.isNotification) {
+        out.id = call["id"];
+    }
+
+    const std::string& method = call["method"].get_ref<const std::string&>();
+    try {
+        if (method == "getChainHeight") {
+            out.result = std::to_string(view.chain.size());
+        } else if (method == "getBalance") {
+            std::string address = stringParam(call, 0, "address");
+            auto it = view.balances.find(address);
+            out.result = nlohmann::json(it != view.balances.end() ? it->second : 0.0).dump();
+        } else if (method == "getBlock") {
+            out.result = blockResult(view, indexParam(call, 0, "index"));
+        } else if (method == "getLatestBlock") {
+            if (view.chain.empty()) {
+                throw RpcError{INTERNAL_ERROR, "Chain is empty"};
+            }
+            out.result = blockResult(view, view.chain.size() - 1);
+        } else if (method == "getTransaction") {
+            std::string hash = stringParam(call, 0, "hash");
+            out.result = "null";
+            for (const Transaction& tx : view.pendingTransactions) {
+                if (tx.getHash() == hash) {
+                    out.result = "{\"block\":null,\"transaction\":" + transactionJson(tx) + "}";
+                    break;
+                }
+            }
+            // Confirmed transactions come from the chain's hash index, so a
+            // batch of lookups never scans blocks while the locks are held
+            auto it = view.transactionIndex.find(hash);
+            if (out.result == "null" && it != view.transactionIndex.end()) {
+                size_t height = it->second.first;
+                const Transaction& tx = view.chain[height].getTransactions()[it->second.second];
+                out.result = "{\"block\":" + std::to_string(height) + ",\"transaction\":" +
+                             transactionJson(tx) + "}";
+            }
+        } else if (method == "getPendingTransactions") {
+            out.result = "[";
+            for (size_t i = 0; i < view.pendingTransactions.size(); i++) {
+                if (i > 0) {
+                    out.result += ',';
+                }
+                out.result += transactionJson(view.pendingTransactions[i]);
+            }
+            out.result += "]";
+        } else if (method == "getDifficulty") {
+            out.result = std::to_string(view.difficulty);
+        } else if (method == "getMiningReward") {
+            out.result = nlohmann::json(view.miningReward).dump();
+        } else {
+            throw RpcError{METHOD_NOT_FOUND, "Method not found"};
+        }
+        out.ok = true;
+    } catch (const RpcError& e) {
+        out.errorCode = e.code;
+        out.errorMessage = e.message;
+    } catch (const std::exception& e) {
+        out.errorCode = INTERNAL_ERROR;
+        out.errorMessage = e.what();
+    }
+}
+
+std::string JsonRpcServer::serializeResult(const CallResult& result) {
+    std::string out = "{\"jsonrpc\":\"2.0\",";
+    if (result.ok) {
+        out += "\"result\":" + result.result;
+    } else {
+        nlohmann::json error;
+        error["code"] = result.errorCode;
+        error["message"] = result.errorMessage;
+        out += "\"error\":" + error.dump();
+    }
+    out += ",\"id\":" + result.id.dump() + "}";
+    return out;
+}
+
+std::string JsonRpcServer::handle(std::string_view body) {
+    static const size_t CALLS_PER_TASK = 32;
+
+    nlohmann::json request;
+    try {
+        request = nlohmann::json::parse(body);
+    } catch (const std::exception& e) {
+        CallResult result;
+        result.errorCode = PARSE_ERROR;
+        result.errorMessage = "Parse error";
+        return serializeResult(result);
+    }
+
+    bool batch = request.is_array();
+    if (batch && (request.empty() || request.size() > maxBatchSize)) {
+        CallResult result;
+        result.errorCode = INVALID_REQUEST;
+        result.errorMessage = request.empty() ? "Empty batch" :
+                              "Batch larger than " + std::to_string(maxBatchSize) + " calls";
+        return serializeResult(result);
+    }
+
+    const size_t count = batch ? request.size() : 1;
+    std::vector<CallResult> results(count);
+
+    blockchain.readConsistent([&](const ChainView& view) {
+        auto runRange = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                execute(batch ? request[i] : request, view, results[i]);
+            }
+        };
+
+        // Calls are read-only against the same snapshot, so they can run
+        // side by side; small batches are not worth a thread hand-off
+        size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                          (count + CALLS_PER_TASK - 1) / CALLS_PER_TASK);
+        if (workers <= 1) {
+            runRange(0, count);
+            return;
+        }
+
+        size_t perWorker = (count + workers - 1) / workers;
+        std::vector<std::future<void>> tasks;
+        for (size_t begin = perWorker; begin < count; begin += perWorker) {
+            tasks.push_back(std::async(std::launch::async, runRange, begin, std::min(count, begin + perWorker)));
+        }
+        runRange(0, std::min(count, perWorker));
+        for (auto& task : tasks) {
+            task.get();
+        }
+    });
+
+    std::string out;
+    if (batch) {
+        out += '[';
+    }
+    bool first = true;
+    for (const CallResult& result : results) {
+        if (result.isNotification) {
+            continue;
+        }
+        if (!first) {
+            out += ',';
+        }
+        out += serializeResult(result);
+        first = false;
+    }
+    if (batch) {
+        if (first) {
+            return "";
+        }
+        out += ']';
+    }
+    return out;
+}
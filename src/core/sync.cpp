@@ -0,0 +1,566 @@
+#include "sync.h"
+#include "networking.h"
+#include "logger.h"
+#include <algorithm>
+#include <sstream>
+
+// BlockHeader implementation
+BlockHeader BlockHeader::fromBlock(const Block& block) {
+    BlockHeader header;
+    header.index = block.getIndex();
+    header.previousHash = block.getPreviousHash();
+    header.timestamp = block.getTimestamp();
+    header.merkleRoot = block.getMerkleRoot();
+    header.nonce = block.getNonce();
+    header.validator = block.getValidator();
+    header.hash = block.getHash();
+    return header;
+}
+
+nlohmann::json BlockHeader::toJson() const {
+    nlohmann::json json;
+    json["index"] = index;
+    json["previousHash"] = previousHash;
+    json["timestamp"] = timestamp;
+    json["merkleRoot"] = merkleRoot;
+    json["nonce"] = nonce;
+    json["validator"] = validator;
+    json["hash"] = hash;
+    return json;
+}
+
+BlockHeader BlockHeader::fromJson(const nlohmann::json& json) {
+    BlockHeader header;
+    header.index = json.at("index").get<uint64_t>();
+    header.previousHash = json.at("previousHash").get<std::string>();
+    header.timestamp = json.at("timestamp").get<time_t>();
+    header.merkleRoot = json.at("merkleRoot").get<std::string>();
+    header.nonce = json.at("nonce").get<uint64_t>();
+    header.validator = json.value("validator", "");
+    header.hash = json.at("hash").get<std::string>();
+    return header;
+}
+
+std::string BlockHeader::calculateHash() const {
+    std::stringstream ss;
+    ss << index << previousHash << timestamp << merkleRoot << nonce;
+    if (!validator.empty()) {
+        ss << validator;
+    }
+    return Utils::calculateSHA256(ss.str());
+}
+
+bool BlockHeader::checkProofOfWork(uint64_t difficulty) const {
+    if (hash.size() < difficulty || hash.compare(0, difficulty, std::string(difficulty, '0')) != 0) {
+        return false;
+    }
+    return calculateHash() == hash;
+}
+
+// SyncManager implementation
+SyncManager::SyncManager(Blockchain& blockchain, PeerScores& scores, const SyncConfig& config)
+    : blockchain(blockchain), scores(scores), config(config), nodeId(NetworkUtils::generateNodeId()), nextWindowHeight(0),
+      blocksConnected(0), blocksRejected(0), windowsReassigned(0) {}
+
+NetworkMessage SyncManager::makeMessage(MessageType type, nlohmann::json data) const {
+    NetworkMessage message;
+    message.type = type;
+    message.sender = nodeId;
+    message.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    message.data = std::move(data);
+    return message;
+}
+
+void SyncManager::send(Outbox& outbox) {
+    for (auto& request : outbox) {
+        request.first->sendMessage(request.second);
+    }
+    outbox.clear();
+}
+
+SyncManager::PeerState& SyncManager::peerFor(const std::shared_ptr<NetworkConnection>& connection) {
+    PeerState& state = peers[connection->getFullAddress()];
+    state.connection = connection;
+    return state;
+}
+
+bool SyncManager::findHeader(uint64_t height, BlockHeader& out) const {
+    auto it = headers.find(height);
+    if (it != headers.end()) {
+        out = it->second;
+        return true;
+    }
+    Block block(0, "");
+    if (!blockchain.getBlock(height, block)) {
+        return false;
+    }
+    out = BlockHeader::fromBlock(block);
+    return true;
+}
+
+void SyncManager::planWindows() {
+    uint64_t chainHeight = blockchain.getChainHeight();
+
+    // Drop anything the chain has already moved past (e.g. a block we mined)
+    headers.erase(headers.begin(), headers.lower_bound(chainHeight));
+    downloaded.erase(downloaded.begin(), downloaded.lower_bound(chainHeight));
+    for (auto it = windows.begin(); it != windows.end() && it->first + it->second.count <= chainHeight;) {
+        if (!it->second.peer.empty()) {
+            auto peer = peers.find(it->second.peer);
+            if (peer != peers.end() && peer->second.windowsInFlight > 0) {
+                peer->second.windowsInFlight--;
+            }
+        }
+        it = windows.erase(it);
+    }
+
+    if (headers.empty()) {
+        nextWindowHeight = chainHeight;
+        return;
+    }
+    nextWindowHeight = std::max<uint64_t>(nextWindowHeight, chainHeight);
+    uint64_t limit = std::min<uint64_t>(headers.rbegin()->first, chainHeight + config.maxBlocksAhead - 1);
+    while (nextWindowHeight <= limit) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(config.windowSize, limit - nextWindowHeight + 1));
+        windows[nextWindowHeight] = Window{count, "", {}, ""};
+        nextWindowHeight += count;
+    }
+}
+
+void SyncManager::assignWindows(Outbox& outbox) {
+    // Window slots scale with a peer's share of the best measured
+    // throughput; unmeasured peers get two so they can be measured
+    std::map<std::string, std::pair<double, double>> quality;   // peer -> (throughput, score)
+    double fastest = 0;
+    for (const auto& pair : peers) {
+        double throughput = scores.getThroughput(pair.first);
+        quality[pair.first] = {throughput, scores.score(pair.first)};
+        fastest = std::max(fastest, throughput);
+    }
+    auto slotsFor = [&](const std::string& peer) -> size_t {
+        double throughput = quality[peer].first;
+        if (throughput <= 0 || fastest <= 0) {
+            return std::min<size_t>(2, config.maxWindowsPerPeer);
+        }
+        double share = throughput / fastest;
+        return std::max<size_t>(1, static_cast<size_t>(config.maxWindowsPerPeer * share + 0.5));
+    };
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto& pair : windows) {
+        Window& window = pair.second;
+        if (!window.peer.empty()) {
+            continue;
+        }
+        uint64_t last = pair.first + window.count - 1;
+
+        // Lowest windows first, to the best-scoring peer, discounted by
+        // what it already has in flight
+        std::string best;
+        double bestScore = -1;
+        std::shared_ptr<NetworkConnection> bestConnection;
+        for (auto& candidate : peers) {
+            PeerState& state = candidate.second;
+            if (state.bestHeight < last || state.windowsInFlight >= slotsFor(candidate.first)) {
+                continue;
+            }
+            auto connection = state.connection.lock();
+            if (!connection || !connection->isConnected()) {
+                continue;
+            }
+            // Scores can go negative; shift so the discount still ranks them
+            double score = std::max(1.0, quality[candidate.first].second + 100) / (state.windowsInFlight + 1);
+            if (candidate.first == window.lastPeer) {
+                score = score / 1e6;   // Only if nobody else can serve it
+            }
+            if (score > bestScore) {
+                bestScore = score;
+                best = candidate.first;
+                bestConnection = connection;
+            }
+        }
+        if (!bestConnection) {
+            continue;
+        }
+
+        window.peer = best;
+        window.requestedAt = now;
+        peers[best].windowsInFlight++;
+        outbox.emplace_back(bestConnection, makeMessage(MessageType::GET_BLOCKS, {
+            {"startHeight", pair.first},
+            {"endHeight", last}
+        }));
+    }
+}
+
+void SyncManager::releaseWindows(const std::string& peer) {
+    for (auto& pair : windows) {
+        if (pair.second.peer == peer) {
+            pair.second.peer.clear();
+            pair.second.lastPeer = peer;
+        }
+    }
+}
+
+void SyncManager::discardFrom(uint64_t height) {
+    // Everything at and above height was built on a block the chain refused
+    for (auto it = windows.begin(); it != windows.end();) {
+        if (it->first + it->second.count > height) {
+            auto peer = peers.find(it->second.peer);
+            if (peer != peers.end() && peer->second.windowsInFlight > 0) {
+                peer->second.windowsInFlight--;
+            }
+            it = windows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    headers.erase(headers.lower_bound(height), headers.end());
+    downloaded.erase(downloaded.lower_bound(height), downloaded.end());
+    nextWindowHeight = height;
+}
+
+void SyncManager::connectReady() {
+    std::lock_guard<std::mutex> connectLock(connectMutex);
+    while (true) {
+        Block block(0, "");
+        {
+            std::lock_guard<std::mutex> lock(syncMutex);
+            auto it = downloaded.find(blockchain.getChainHeight());
+            if (it == downloaded.end()) {
+                return;
+            }
+            block = std::move(it->second);
+            downloaded.erase(it);
+        }
+
+        uint64_t index = block.getIndex();
+        bool connected = blockchain.addBlock(block);
+
+        std::lock_guard<std::mutex> lock(syncMutex);
+        if (connected) {
+            blocksConnected++;
+            headers.erase(index);
+        } else {
+            blocksRejected++;
+            Logger::warning("Sync: block " + std::to_string(index) + " did not connect, discarding headers above it");
+            discardFrom(index);
+        }
+    }
+}
+
+void SyncManager::tick(const std::vector<std::shared_ptr<NetworkConnection>>& connections) {
+    Outbox outbox;
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        auto now = std::chrono::steady_clock::now();
+
+        for (const auto& connection : connections) {
+            if (connection->isConnected()) {
+                peerFor(connection);
+            }
+        }
+
+        uint64_t headerHeight = headers.empty() ? blockchain.getChainHeight() - 1 : headers.rbegin()->first;
+        for (auto it = peers.begin(); it != peers.end();) {
+            auto connection = it->second.connection.lock();
+            if (!connection || !connection->isConnected()) {
+                releaseWindows(it->first);
+                it = peers.erase(it);
+                continue;
+            }
+
+            // Poll for new headers; a lost request is retried after the stall timeout
+            PeerState& state = it->second;
+            auto since = now - state.headersRequestedAt;
+            if ((!state.headersInFlight && since >= config.headerPollInterval) ||
+                (state.headersInFlight && since >= config.stallTimeout)) {
+                state.headersInFlight = true;
+                state.headersRequestedAt = now;
+                outbox.emplace_back(connection, makeMessage(MessageType::GET_HEADERS, {
+                    {"startHeight", headerHeight + 1},
+                    {"count", config.maxHeadersPerMessage}
+                }));
+            }
+            ++it;
+        }
+
+        // Hand stalled windows to someone else and mark the peer down
+        for (auto& pair : windows) {
+            Window& window = pair.second;
+            if (window.peer.empty() || now - window.requestedAt < config.stallTimeout) {
+                continue;
+            }
+            auto peer = peers.find(window.peer);
+            if (peer != peers.end() && peer->second.windowsInFlight > 0) {
+                peer->second.windowsInFlight--;
+            }
+            scores.recordStall(window.peer);
+            Logger::debug("Sync: window at " + std::to_string(pair.first) + " stalled on " + window.peer);
+            window.lastPeer = window.peer;
+            window.peer.clear();
+            windowsReassigned++;
+        }
+
+        planWindows();
+        assignWindows(outbox);
+    }
+    send(outbox);
+    connectReady();
+}
+
+void SyncManager::handleGetHeaders(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    uint64_t start = message.data.value("startHeight", 0ULL);
+    size_t count = std::min<size_t>(message.data.value("count", config.maxHeadersPerMessage),
+                                    config.maxHeadersPerMessage);
+
+    nlohmann::json headerList = nlohmann::json::array();
+    uint64_t height = 0;
+    blockchain.readConsistent([&](const ChainView& view) {
+        height = view.chain.empty() ? 0 : view.chain.size() - 1;
+        for (uint64_t i = start; i < view.chain.size() && headerList.size() < count; i++) {
+            headerList.push_back(BlockHeader::fromBlock(view.chain[i]).toJson());
+        }
+    });
+
+    peer->sendMessage(makeMessage(MessageType::HEADERS, {
+        {"startHeight", start},
+        {"height", height},
+        {"headers", std::move(headerList)}
+    }));
+}
+
+void SyncManager::handleGetBlocks(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    uint64_t start = message.data.value("startHeight", 0ULL);
+    uint64_t end = message.data.value("endHeight", start);
+    uint64_t chainHeight = blockchain.getChainHeight();
+    end = std::min<uint64_t>({end, start + config.windowSize * 4 - 1, chainHeight - 1});
+
+    // Stop at the response budget; the requester re-asks for the rest
+    nlohmann::json blocks = nlohmann::json::array();
+    size_t bytes = 0;
+    for (uint64_t height = start; height <= end && height < chainHeight; height++) {
+        Block block(0, "");
+        if (!blockchain.getBlock(height, block)) {
+            break;
+        }
+        std::string text = block.serialize();
+        if (!blocks.empty() && bytes + text.size() > config.maxResponseBytes) {
+            break;
+        }
+        bytes += text.size();
+        blocks.push_back(nlohmann::json::parse(text));
+    }
+
+    peer->sendMessage(makeMessage(MessageType::BLOCKS, {
+        {"startHeight", start},
+        {"height", chainHeight - 1},
+        {"blocks", std::move(blocks)}
+    }));
+}
+
+void SyncManager::handleHeaders(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    std::vector<BlockHeader> received;
+    for (const auto& json : message.data.at("headers")) {
+        received.push_back(BlockHeader::fromJson(json));
+    }
+
+    Outbox outbox;
+    bool invalid = false;
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        PeerState& state = peerFor(peer);
+        state.headersInFlight = false;
+        state.bestHeight = std::max<uint64_t>(state.bestHeight, message.data.value("height", 0ULL));
+
+        uint64_t chainHeight = blockchain.getChainHeight();
+        uint64_t difficulty = blockchain.getDifficulty();
+        size_t added = 0;
+        for (const BlockHeader& header : received) {
+            if (header.index < chainHeight) {
+                continue;
+            }
+            auto known = headers.find(header.index);
+            if (known != headers.end()) {
+                if (known->second.hash == header.hash) {
+                    continue;
+                }
+                Logger::warning("Sync: " + peer->getFullAddress() + " is on a different branch at height " +
+                                std::to_string(header.index));
+                break;
+            }
+
+            // Must extend our best header and carry valid proof of work
+            BlockHeader parent;
+            if (header.index == 0 || !findHeader(header.index - 1, parent) || parent.hash != header.previousHash) {
+                break;
+            }
+            if (!header.checkProofOfWork(difficulty)) {
+                invalid = true;
+                break;
+            }
+            headers[header.index] = header;
+            added++;
+        }
+
+        if (!received.empty()) {
+            state.bestHeight = std::max<uint64_t>(state.bestHeight, received.back().index);
+        }
+
+        // A full batch means the peer has more; keep going without waiting for the poll
+        if (!invalid && added > 0 && received.size() >= config.maxHeadersPerMessage) {
+            state.headersInFlight = true;
+            state.headersRequestedAt = std::chrono::steady_clock::now();
+            outbox.emplace_back(peer, makeMessage(MessageType::GET_HEADERS, {
+                {"startHeight", headers.rbegin()->first + 1},
+                {"count", config.maxHeadersPerMessage}
+            }));
+        }
+        if (added > 0) {
+            Logger::info("Sync: " + std::to_string(added) + " headers from " + peer->getFullAddress() +
+                         ", best header " + std::to_string(headers.rbegin()->first));
+        }
+
+        planWindows();
+        assignWindows(outbox);
+    }
+
+    if (invalid) {
+        scores.recordInvalid(peer->getFullAddress(), 100);
+        Logger::warning("Sync: header with invalid proof of work from " + peer->getFullAddress());
+        peer->disconnect();
+        return;
+    }
+    send(outbox);
+}
+
+void SyncManager::handleBlocks(const std::shared_ptr<NetworkConnection>& peer, const NetworkMessage& message) {
+    std::vector<Block> received;
+    size_t bytes = 0;
+    for (const auto& json : message.data.at("blocks")) {
+        std::string text = json.dump();
+        bytes += text.size();
+        received.push_back(Block::deserialize(text));
+    }
+    uint64_t start = message.data.value("startHeight", 0ULL);
+
+    Outbox outbox;
+    bool invalid = false;
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        std::string key = peer->getFullAddress();
+        PeerState& state = peerFor(peer);
+        state.bestHeight = std::max<uint64_t>(state.bestHeight, message.data.value("height", 0ULL));
+
+        // Bodies must match the header chain we already validated
+        for (Block& block : received) {
+            auto header = headers.find(block.getIndex());
+            if (header == headers.end()) {
+                continue;   // Unrequested, or already connected
+            }
+            if (block.getHash() != header->second.hash || block.calculateHash() != block.getHash()) {
+                invalid = true;
+                break;
+            }
+            // The hash only commits to the merkle root, so the transactions
+            // must be checked against it or any list could ride on a header
+            Block check = block;
+            if (check.calculateMerkleRoot() != header->second.merkleRoot) {
+                invalid = true;
+                break;
+            }
+            downloaded.emplace(block.getIndex(), std::move(block));
+        }
+
+        auto window = windows.find(start);
+        if (window != windows.end()) {
+            auto now = std::chrono::steady_clock::now();
+            if (window->second.peer == key) {
+                state.windowsInFlight = state.windowsInFlight > 0 ? state.windowsInFlight - 1 : 0;
+                if (!received.empty()) {
+                    scores.recordDelivery(key, bytes, std::chrono::duration<double>(now - window->second.requestedAt).count());
+                }
+            } else if (!window->second.peer.empty()) {
+                // Answered by a peer we had given up on; free the new owner's slot
+                auto owner = peers.find(window->second.peer);
+                if (owner != peers.end() && owner->second.windowsInFlight > 0) {
+                    owner->second.windowsInFlight--;
+                }
+            }
+
+            // Whatever the response left out (size cap, or the peer lacks
+            // it) goes back into the queue as a smaller window
+            uint64_t chainHeight = blockchain.getChainHeight();
+            uint64_t end = window->first + window->second.count;
+            uint64_t missing = window->first;
+            while (missing < end && (missing < chainHeight || downloaded.count(missing))) {
+                missing++;
+            }
+            windows.erase(window);
+            if (missing < end) {
+                Window rest{static_cast<size_t>(end - missing), "", {}, received.empty() ? key : ""};
+                windows[missing] = rest;
+            }
+        }
+
+        planWindows();
+        assignWindows(outbox);
+    }
+
+    if (invalid) {
+        {
+            std::lock_guard<std::mutex> lock(syncMutex);
+            blocksRejected++;
+        }
+        scores.recordInvalid(peer->getFullAddress(), 100);
+        Logger::warning("Sync: block body does not match its header from " + peer->getFullAddress());
+        peer->disconnect();
+    }
+    send(outbox);
+    connectReady();
+}
+
+void SyncManager::peerDisconnected(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    releaseWindows(peer);
+    peers.erase(peer);
+}
+
+uint64_t SyncManager::getHeaderHeight() const {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    return headers.empty() ? blockchain.getChainHeight() - 1 : headers.rbegin()->first;
+}
+
+bool SyncManager::isSyncing() const {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    return !headers.empty();
+}
+
+nlohmann::json SyncManager::getStats() const {
+    std::lock_guard<std::mutex> lock(syncMutex);
+    nlohmann::json stats;
+    stats["headerHeight"] = headers.empty() ? blockchain.getChainHeight() - 1 : headers.rbegin()->first;
+    stats["chainHeight"] = blockchain.getChainHeight() - 1;
+    stats["blocksBuffered"] = downloaded.size();
+    stats["blocksConnected"] = blocksConnected;
+    stats["blocksRejected"] = blocksRejected;
+    stats["windowsReassigned"] = windowsReassigned;
+
+    size_t inFlight = 0;
+    for (const auto& pair : windows) {
+        inFlight += pair.second.peer.empty() ? 0 : 1;
+    }
+    stats["windowsInFlight"] = inFlight;
+    stats["windowsQueued"] = windows.size() - inFlight;
+
+    stats["peers"] = nlohmann::json::array();
+    for (const auto& pair : peers) {
+        stats["peers"].push_back({
+            {"address", pair.first},
+            {"bestHeight", pair.second.bestHeight},
+            {"windowsInFlight", pair.second.windowsInFlight}
+        });
+    }
+    return stats;
+}
@@ -68,12 +68,37 @@ class NiloticMiner:
                 result = response.json()
                 self.blocks_mined += 1
                 return result
+            elif response.status_code == 202:
+                # Mining runs as a background job on the node; wait for it to finish
+                result = self.wait_for_job(response.json()["job_id"])
+                if result.get("state") == "completed":
+                    self.blocks_mined += 1
+                    result["status"] = "success"
+                else:
+                    result["status"] = "error"
+                    result["message"] = result.get("error", "Mining job " + result.get("state", "failed"))
+                return result
             else:
                 raise Exception(f"Mining failed with status {response.status_code}: {response.text}")
                 
         except requests.RequestException as e:
             raise ConnectionError(f"Failed to mine block: {e}")
     
+    def wait_for_job(self, job_id: str, poll_interval: float = 0.5, timeout: float = 600) -> Dict[str, Any]:
+        """Poll a mining job until it completes, fails or is cancelled"""
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            response = requests.get(f"{self.blockchain_url}/jobs/{job_id}")
+            if response.status_code != 200:
+                raise Exception(f"Job lookup failed with status {response.status_code}: {response.text}")
+            job = response.json()
+            if job.get("state") in ("completed", "failed", "cancelled"):
+                return job
+            time.sleep(poll_interval)
+        
+        requests.delete(f"{self.blockchain_url}/jobs/{job_id}")
+        raise TimeoutError(f"Mining job {job_id} did not finish within {timeout} seconds")
+    
     def start_mining(self, interval: int = 10) -> None:
         """Start continuous mining with specified interval"""
         if not self.miner_address:
@@ -111,7 +136,7 @@ class NiloticMiner:
                         result = self.mine_block()
                         
                         if result.get('success') or result.get('status') == 'success':
-                            block_hash = result.get('block', {}).get('hash', 'unknown')
+                            block_hash = result.get('block_hash') or result.get('block', {}).get('hash', 'unknown')
                             print(f"✅ {datetime.now().strftime('%H:%M:%S')} - Block mined successfully! Hash: {block_hash[:16]}...")
                         else:
                             print(f"❌ {datetime.now().strftime('%H:%M:%S')} - Mining failed: {result.get('message', 'Unknown error')}")